@@ -0,0 +1,284 @@
+/** @file aes-mmo-benchmark.c
+ *  @brief AES-MMO hash test and benchmark - checks the host's AES-MMO hash
+ *  against known answers, with and without the processor's AES
+ *  instructions, and measures how fast an OTA image is hashed
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.        *80*-->
+ */
+
+#include PLATFORM_HEADER
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stack/include/ember-types.h"
+#include "stack/include/error.h"
+#include "app/util/ezsp/ezsp-protocol.h"
+#include "app/util/ezsp/ezsp.h"
+#include "hal/micro/aes.h"
+
+#define IMAGE_LEN     (512L * 1024L)    // bytes in a typical OTA image
+#define MIN_SECONDS   0.5               // minimum time to run each test
+#define NCP_HASH_LEN  240               // most an EZSP update can carry
+#define OTA_HASH_LEN  96                // what the OTA client hashes at once
+
+// Declared here as in the OTA client; the host has no header for these.
+void emberAesMmoHashInit(EmberAesMmoHashContext *context);
+EmberStatus emberAesMmoHashUpdate(EmberAesMmoHashContext *context,
+                                  int32u length,
+                                  int8u *data);
+EmberStatus emberAesMmoHashFinal(EmberAesMmoHashContext *context,
+                                 int32u length,
+                                 int8u *data);
+
+static int8u image[IMAGE_LEN];
+
+// The first two are from the ZigBee specification, annex C.5, which the
+// NCP reproduces.  The others cover both forms of the length padding.
+static const struct {
+  const char *name;
+  int32u length;
+  int8u first;                  // the data counts up from this byte
+  int8u hash[16];
+} knownAnswers[] = {
+  { "1 byte", 1, 0xC0,
+    { 0xAE, 0x3A, 0x10, 0x2A, 0x28, 0xD4, 0x3E, 0xE0,
+      0xD4, 0xA0, 0x9E, 0x22, 0x78, 0x8B, 0x20, 0x6C } },
+  { "16 bytes", 16, 0xC0,
+    { 0xA7, 0x97, 0x7E, 0x88, 0xBC, 0x0B, 0x61, 0xE8,
+      0x21, 0x08, 0x27, 0x10, 0x9A, 0x22, 0x8F, 0x2D } },
+  { "8191 bytes", 8191, 0x00,
+    { 0x24, 0xEC, 0x2F, 0xE7, 0x5B, 0xBF, 0xFC, 0xB3,
+      0x47, 0x89, 0xBC, 0x06, 0x10, 0xE7, 0xF1, 0x65 } },
+  { "8192 bytes", 8192, 0x00,
+    { 0xDC, 0x6B, 0x06, 0x87, 0xF0, 0x9F, 0x86, 0x07,
+      0x13, 0x1C, 0x17, 0x0B, 0x3B, 0xD3, 0x15, 0x91 } },
+  { "512 KB", IMAGE_LEN, 0x00,
+    { 0xA1, 0xF4, 0xA8, 0x4E, 0x7E, 0x71, 0x2D, 0xDC,
+      0x20, 0x22, 0x52, 0x65, 0xDA, 0xD9, 0x9B, 0xCA } },
+};
+
+#define KNOWN_ANSWER_COUNT (sizeof(knownAnswers) / sizeof(knownAnswers[0]))
+
+// FIPS-197, appendix C.1.
+static const int8u fipsKey[16] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+static const int8u fipsPlaintext[16] = {
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+  0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+static const int8u fipsCiphertext[16] = {
+  0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30,
+  0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A
+};
+
+// Hashes the data in updates of the given size, which must be a multiple of
+// the block size, and passes the rest to the final call.  A size of 0 hashes
+// everything in the final call.
+static EmberStatus hash(const int8u *data,
+                        int32u length,
+                        int32u updateLength,
+                        int8u *result)
+{
+  EmberAesMmoHashContext context;
+  EmberStatus status;
+  emberAesMmoHashInit(&context);
+  if (updateLength != 0) {
+    while (length > updateLength) {
+      status = emberAesMmoHashUpdate(&context, updateLength, (int8u *)data);
+      if (status != EMBER_SUCCESS) {
+        return status;
+      }
+      data += updateLength;
+      length -= updateLength;
+    }
+  }
+  status = emberAesMmoHashFinal(&context, length, (int8u *)data);
+  memcpy(result, context.result, 16);
+  return status;
+}
+
+static void printHash(const int8u *hash)
+{
+  int8u ii;
+  for (ii = 0; ii < 16; ii++) {
+    printf("%02X", hash[ii]);
+  }
+}
+
+static int checkKnownAnswers(void)
+{
+  static const int32u updateLengths[] = { 0, OTA_HASH_LEN, NCP_HASH_LEN };
+  static int8u data[IMAGE_LEN];
+  int8u result[16];
+  int8u ii;
+  int8u jj;
+  int32u kk;
+  int failures = 0;
+
+  halCommonAesEncrypt(fipsKey, fipsPlaintext, result);
+  if (memcmp(result, fipsCiphertext, 16) != 0) {
+    printf("FIPS-197 AES-128 gave ");
+    printHash(result);
+    printf("\n");
+    failures++;
+  }
+
+  for (ii = 0; ii < KNOWN_ANSWER_COUNT; ii++) {
+    for (kk = 0; kk < knownAnswers[ii].length; kk++) {
+      data[kk] = (int8u)(knownAnswers[ii].first + kk);
+    }
+    for (jj = 0; jj < sizeof(updateLengths) / sizeof(updateLengths[0]); jj++) {
+      EmberStatus status = hash(data,
+                                knownAnswers[ii].length,
+                                updateLengths[jj],
+                                result);
+      if (status != EMBER_SUCCESS
+          || memcmp(result, knownAnswers[ii].hash, 16) != 0) {
+        printf("%s, update size %ld: status 0x%02X, hash ",
+               knownAnswers[ii].name,
+               (long)updateLengths[jj],
+               status);
+        printHash(result);
+        printf("\n");
+        failures++;
+      }
+    }
+    if (knownAnswers[ii].length <= 255) {
+      emberAesHashSimple((int8u)knownAnswers[ii].length, data, result);
+      if (memcmp(result, knownAnswers[ii].hash, 16) != 0) {
+        printf("%s with emberAesHashSimple() does not match\n",
+               knownAnswers[ii].name);
+        failures++;
+      }
+    }
+  }
+  return failures;
+}
+
+// The NCP refuses these, so the host must too.
+static int checkErrors(void)
+{
+  EmberAesMmoHashContext context;
+  int failures = 0;
+  EmberStatus status;
+
+  emberAesMmoHashInit(&context);
+  status = emberAesMmoHashUpdate(&context, 17, image);
+  if (status != EMBER_INVALID_CALL) {
+    printf("update of a partial block returned 0x%02X\n", status);
+    failures++;
+  }
+
+  emberAesMmoHashInit(&context);
+  context.length = 0x1FFFFFF0UL;
+  status = emberAesMmoHashFinal(&context, 16, image);
+  if (status != EMBER_INDEX_OUT_OF_RANGE) {
+    printf("hash of 2^32 bits returned 0x%02X\n", status);
+    failures++;
+  }
+  return failures;
+}
+
+static double benchmark(int8u *result)
+{
+  int32u passes = 0;
+  clock_t start = clock();
+  double seconds;
+  do {
+    hash(image, IMAGE_LEN, 0, result);
+    passes++;
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  } while (seconds < MIN_SECONDS);
+  return (passes * (double)IMAGE_LEN) / (seconds * 1024 * 1024);
+}
+
+int main( int argc, char *argv[] )
+{
+  int8u softwareHash[16];
+  int8u hardwareHash[16];
+  double software;
+  double hardware;
+  int32u ii;
+  int failures;
+  boolean haveHardware;
+
+  for (ii = 0; ii < IMAGE_LEN; ii++) {
+    image[ii] = (int8u)ii;
+  }
+
+  haveHardware = halCommonAesEnableHardware(FALSE);
+  failures = checkKnownAnswers() + checkErrors();
+  haveHardware = halCommonAesEnableHardware(TRUE);
+  if (haveHardware) {
+    failures += checkKnownAnswers();
+  }
+  printf("known answers: %s\n", failures == 0 ? "pass" : "FAIL");
+
+  printf("%-26s %10s %8s\n", "512 KB image hash", "MB/s", "speedup");
+  halCommonAesEnableHardware(FALSE);
+  software = benchmark(softwareHash);
+  printf("%-26s %10.1f %7.1fx\n", "lookup tables", software, 1.0);
+  if (haveHardware) {
+    halCommonAesEnableHardware(TRUE);
+    hardware = benchmark(hardwareHash);
+    printf("%-26s %10.1f %7.1fx\n", "AES instructions", hardware,
+           hardware / software);
+    if (memcmp(softwareHash, hardwareHash, 16) != 0) {
+      printf("AES instruction hash does not match the lookup tables\n");
+      failures++;
+    }
+  } else {
+    printf("%-26s %10s\n", "AES instructions", "n/a");
+  }
+  printf("EZSP round trips avoided:  %ld\n",
+         (IMAGE_LEN + NCP_HASH_LEN - 1) / NCP_HASH_LEN);
+
+  return (failures == 0 ? 0 : 1);
+}
+
+//------------------------------------------------------------------------------
+// EZSP callback function stubs
+
+void ezspErrorHandler(EzspStatus status)
+{}
+
+void ezspTimerHandler(int8u timerId)
+{}
+
+void ezspStackStatusHandler(
+      EmberStatus status)
+{}
+
+void ezspNetworkFoundHandler(EmberZigbeeNetwork *networkFound,
+                             int8u lastHopLqi,
+                             int8s lastHopRssi)
+{}
+
+void ezspScanCompleteHandler(
+      int8u channel,
+      EmberStatus status)
+{}
+
+void ezspMessageSentHandler(
+      EmberOutgoingMessageType type,
+      int16u indexOrDestination,
+      EmberApsFrame *apsFrame,
+      int8u messageTag,
+      EmberStatus status,
+      int8u messageLength,
+      int8u *messageContents)
+{}
+
+void ezspIncomingMessageHandler(
+      EmberIncomingMessageType type,
+      EmberApsFrame *apsFrame,
+      int8u lastHopLqi,
+      int8s lastHopRssi,
+      EmberNodeId sender,
+      int8u bindingIndex,
+      int8u addressIndex,
+      int8u messageLength,
+      int8u *messageContents)
+{}
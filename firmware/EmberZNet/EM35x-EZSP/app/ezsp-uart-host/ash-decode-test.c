@@ -0,0 +1,271 @@
+/** @file ash-decode-test.c
+ *  @brief ASH block decoder test - checks that ashDecodeBlock() returns
+ *  exactly the same frames and status codes as ashDecodeByte()
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.        *80*-->
+ */
+
+#include PLATFORM_HEADER
+#include <stdio.h>
+#include <stdlib.h>
+#include "stack/include/ember-types.h"
+#include "hal/micro/generic/ash-protocol.h"
+#include "hal/micro/generic/ash-common.h"
+#include "app/ezsp-uart-host/ash-host.h"
+
+#define STREAM_LEN    200000      // bytes of encoded test data
+#define MAX_EVENTS    STREAM_LEN  // at most one frame event per byte
+
+// A frame event is recorded whenever the decoder returns a status other
+// than EZSP_ASH_IN_PROGRESS.
+typedef struct {
+  int32u position;                // offset in stream of the terminating byte
+  EzspStatus status;
+  int8u len;
+  int8u data[ASH_MAX_FRAME_LEN];
+} FrameEvent;
+
+static int8u stream[STREAM_LEN];
+static FrameEvent byteEvents[MAX_EVENTS];
+static FrameEvent blockEvents[MAX_EVENTS];
+
+static const int8u reservedBytes[] =
+  { ASH_FLAG, ASH_ESC, ASH_XON, ASH_XOFF, ASH_SUB, ASH_CAN };
+
+static int32u makeStream(void);
+static int32u decodeBytes(int32u streamLen);
+static int32u decodeBlocks(int32u streamLen, boolean discard);
+static boolean compareEvents(int32u count, boolean compareData);
+
+int main( int argc, char *argv[] )
+{
+  int8u pass;
+  int32u streamLen;
+  int32u byteCount;
+  int32u blockCount;
+
+  for (pass = 0; pass < 8; pass++) {
+    srand(pass);
+    ashWriteConfig(rtsCts, (pass & 1) ? FALSE : TRUE);
+    streamLen = makeStream();
+    byteCount = decodeBytes(streamLen);
+
+    blockCount = decodeBlocks(streamLen, FALSE);
+    if (blockCount != byteCount || !compareEvents(byteCount, TRUE)) {
+      printf("Pass %d: block decoder output differs (%d vs %d events).\n",
+             pass, blockCount, byteCount);
+      return 1;
+    }
+
+    blockCount = decodeBlocks(streamLen, TRUE);
+    if (blockCount != byteCount || !compareEvents(byteCount, FALSE)) {
+      printf("Pass %d: discarding block decoder differs (%d vs %d events).\n",
+             pass, blockCount, byteCount);
+      return 1;
+    }
+    printf("Pass %d: %d bytes, %d frame events match.\n",
+           pass, streamLen, byteCount);
+  }
+  printf("ASH block decoder test succeeded.\n");
+  return 0;
+}
+
+// Fills stream[] with encoded frames of random length and content, some of
+// them damaged, interspersed with stray reserved bytes.
+static int32u makeStream(void)
+{
+  int8u frame[ASH_MAX_FRAME_LEN + 8];
+  int8u len;
+  int8u offset;
+  int8u i;
+  int32u pos = 0;
+
+  while (pos < STREAM_LEN - 2 * (sizeof(frame) + 4)) {
+    len = 1 + rand() % sizeof(frame);
+    for (i = 0; i < len; i++) {
+      if (rand() % 4) {
+        frame[i] = reservedBytes[0] + 1 + rand() % 0x70;  // mostly plain
+      } else {
+        frame[i] = rand();
+      }
+    }
+    stream[pos++] = ashEncodeByte(len, frame[0], &offset);
+    while (offset != 0xFF) {
+      stream[pos++] = ashEncodeByte(0, frame[offset], &offset);
+    }
+
+    switch (rand() % 16) {
+    case 0:                         // corrupt a byte of the frame
+      stream[pos - 1 - rand() % (len + 3)] ^= (1 << (rand() % 8));
+      break;
+    case 1:                         // replace a byte with a reserved byte
+      stream[pos - 1 - rand() % (len + 3)] =
+        reservedBytes[rand() % sizeof(reservedBytes)];
+      break;
+    case 2:                         // insert a stray reserved byte
+      stream[pos++] = reservedBytes[rand() % sizeof(reservedBytes)];
+      break;
+    case 3:                         // drop the end flag
+      pos--;
+      break;
+    case 4:                         // a few random bytes
+      for (i = rand() % 8; i > 0; i--) {
+        stream[pos++] = rand();
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return pos;
+}
+
+static void recordEvent(FrameEvent *event,
+                        int32u position,
+                        EzspStatus status,
+                        int8u *frame,
+                        int8u len)
+{
+  event->position = position;
+  event->status = status;
+  event->len = len;
+  MEMCOPY(event->data, frame, ASH_MAX_FRAME_LEN);
+}
+
+// Decodes stream[] one byte at a time with ashDecodeByte().
+static int32u decodeBytes(int32u streamLen)
+{
+  int8u frame[ASH_MAX_FRAME_LEN];
+  int8u out;
+  int8u len = 0;
+  int8u index;
+  int32u pos;
+  int32u count = 0;
+  EzspStatus status;
+
+  MEMSET(frame, 0, sizeof(frame));
+  ashDecodeInProgress = FALSE;
+  for (pos = 0; pos < streamLen; pos++) {
+    if (!ashDecodeInProgress) {
+      len = 0;
+      MEMSET(frame, 0, sizeof(frame));
+    }
+    index = len;
+    status = ashDecodeByte(stream[pos], &out, &len);
+    if (len != index) {
+      frame[index] = out;
+    }
+    if (status != EZSP_ASH_IN_PROGRESS) {
+      recordEvent(&byteEvents[count++], pos, status, frame, len);
+    }
+  }
+  return count;
+}
+
+// Decodes stream[] in blocks of random length with ashDecodeBlock(), giving
+// it output space in random amounts, or discarding the output.
+static int32u decodeBlocks(int32u streamLen, boolean discard)
+{
+  int8u frame[ASH_MAX_FRAME_LEN];
+  int8u len = 0;
+  int16u blockLen;
+  int16u space;
+  int16u used;
+  int32u pos = 0;
+  int32u count = 0;
+  EzspStatus status;
+
+  MEMSET(frame, 0, sizeof(frame));
+  ashDecodeInProgress = FALSE;
+  while (pos < streamLen) {
+    if (!ashDecodeInProgress) {
+      len = 0;
+      MEMSET(frame, 0, sizeof(frame));
+    }
+    blockLen = 1 + rand() % 64;
+    if (blockLen > streamLen - pos) {
+      blockLen = streamLen - pos;
+    }
+    space = rand() % (ASH_MAX_FRAME_LEN - len + 1);
+    status = ashDecodeBlock(stream + pos,
+                            blockLen,
+                            &used,
+                            discard ? NULL : frame + len,
+                            space,
+                            &len);
+    pos += used;
+    if (status != EZSP_ASH_IN_PROGRESS) {
+      recordEvent(&blockEvents[count++], pos - 1, status, frame, len);
+    }
+  }
+  return count;
+}
+
+static boolean compareEvents(int32u count, boolean compareData)
+{
+  int32u i;
+
+  for (i = 0; i < count; i++) {
+    if ( (byteEvents[i].position != blockEvents[i].position)
+         || (byteEvents[i].status != blockEvents[i].status)
+         || (byteEvents[i].len != blockEvents[i].len)
+         || ( compareData
+              && (byteEvents[i].status == EZSP_SUCCESS)
+              && memcmp(byteEvents[i].data,
+                        blockEvents[i].data,
+                        byteEvents[i].len) ) ) {
+      printf("Event %d at offset %d: byte decoder status 0x%02X len %d, "
+             "block decoder status 0x%02X len %d at offset %d\n",
+             i, byteEvents[i].position, byteEvents[i].status,
+             byteEvents[i].len, blockEvents[i].status, blockEvents[i].len,
+             blockEvents[i].position);
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+// EZSP callback function stubs
+
+void ezspErrorHandler(EzspStatus status)
+{}
+
+void ezspTimerHandler(int8u timerId)
+{}
+
+void ezspStackStatusHandler(
+      EmberStatus status) 
+{}
+
+void ezspNetworkFoundHandler(EmberZigbeeNetwork *networkFound,
+                             int8u lastHopLqi,
+                             int8s lastHopRssi)
+{}
+
+void ezspScanCompleteHandler(
+      int8u channel,
+      EmberStatus status) 
+{}
+
+void ezspMessageSentHandler(
+      EmberOutgoingMessageType type,
+      int16u indexOrDestination,
+      EmberApsFrame *apsFrame,
+      int8u messageTag,
+      EmberStatus status,
+      int8u messageLength,
+      int8u *messageContents)
+{}
+
+void ezspIncomingMessageHandler(
+      EmberIncomingMessageType type,
+      EmberApsFrame *apsFrame,
+      int8u lastHopLqi,
+      int8s lastHopRssi,
+      EmberNodeId sender,
+      int8u bindingIndex,
+      int8u addressIndex,
+      int8u messageLength,
+      int8u *messageContents) 
+{}
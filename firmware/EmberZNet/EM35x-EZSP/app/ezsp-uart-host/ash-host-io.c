@@ -96,6 +96,14 @@ static int8u *inBufRd;                      // inBuffer read pointer
 static int8u *inBufWr;                      // inBuffer write pointer
 static int16u inBlockLen;                   // bytes to read ahead
 
+#ifdef ENABLE_HOSTIO_DEBUG
+static int8u peekByte;                      // byte returned by ashSerialReadPeek
+static boolean peekValid;                   // TRUE if peekByte not consumed
+#endif
+
+// Called with serialFd whenever the serial port is closed.
+static void (*serialCloseHandler)(int fd) = NULL;
+
 #ifdef ENABLE_HOSTIO_DEBUG
 #ifdef IO_LOG
 int logCount = 0;
@@ -339,6 +347,9 @@ static EzspStatus ashInternalSerialInit(boolean ignoreErrors)
   }
   inBufRd = inBuffer;
   inBufWr = inBuffer;
+#ifdef ENABLE_HOSTIO_DEBUG
+  peekValid = FALSE;
+#endif
   inBlockLen = ashReadConfig(inBlockLen);
   if (inBlockLen > MAX_IN_BLOCK_LEN) {
     inBlockLen = MAX_IN_BLOCK_LEN;
@@ -367,10 +378,18 @@ void ashSerialClose(void)
   if (serialFd != NULL_FILE_DESCRIPTOR) {
     tcflush(serialFd, TCIOFLUSH);
     close(serialFd);
+    if (serialCloseHandler != NULL) {
+      serialCloseHandler(serialFd);
+    }
     serialFd = NULL_FILE_DESCRIPTOR;
   }
 }
 
+void ashSetSerialCloseHandler(void (*handler)(int fd))
+{
+  serialCloseHandler = handler;
+}
+
 // This function assumes that the ncp can be reset by deasserting DTR.
 // Using the POSIX API, this is handled clumsily by closing and reopening
 // the serial port. An OS-specific API, such ioctl() under Linux, will do
@@ -413,6 +432,21 @@ EzspStatus ashSerialReadByte(int8u *byte)
   return status;
 }
 
+EzspStatus ashSerialReadPeek(const int8u **data, int16u *count)
+{
+  EzspStatus status;
+
+  status = ashSerialReadAvailable(count);
+  *data = inBufRd;
+  return status;
+}
+
+void ashSerialReadSkip(int16u count)
+{
+  inBufRd += count;
+  ADD_HOST_COUNTER(count, rxBytes);
+}
+
 #endif    // #ifndef ENABLE_HOSTIO_DEBUG
 
 EzspStatus ashSerialReadAvailable(int16u *count)
@@ -465,6 +499,9 @@ void ashSerialWriteFlush(void)
 void ashSerialReadFlush(void)
 {
   int8u byte;
+#ifdef ENABLE_HOSTIO_DEBUG
+  peekValid = FALSE;
+#endif
   while (ashSerialReadByte(&byte) == EZSP_SUCCESS)
       ;
 } 
@@ -627,4 +664,27 @@ EzspStatus ashSerialReadByte(int8u *byte)
   return EZSP_SUCCESS;
 }
 
+// The debug version hands out one byte at a time so that every byte still
+// passes through the logging and corruption code in ashSerialReadByte().
+EzspStatus ashSerialReadPeek(const int8u **data, int16u *count)
+{
+  if (!peekValid) {
+    if (ashSerialReadByte(&peekByte) != EZSP_SUCCESS) {
+      *count = 0;
+      return EZSP_ASH_NO_RX_DATA;
+    }
+    peekValid = TRUE;
+  }
+  *data = &peekByte;
+  *count = 1;
+  return EZSP_SUCCESS;
+}
+
+void ashSerialReadSkip(int16u count)
+{
+  if (count) {
+    peekValid = FALSE;
+  }
+}
+
 #endif  // #ifdef ENABLE_HOSTIO_DEBUG
@@ -85,6 +85,27 @@ EzspStatus ashSerialReadByte(int8u *byte);
  */
 EzspStatus ashSerialReadAvailable(int16u *count);
 
+/** @brief Returns the block of bytes available to read from the serial
+ *  port without consuming them. Reads more data from the port if none is
+ *  buffered.
+ *
+ * @param data  pointer to a variable where a pointer to the bytes will be
+ *              written
+ *
+ * @param count pointer to a variable where the byte count will be written
+ *
+ * @return  
+ * - ::EZSP_SUCCESS
+ * - ::EZSP_ASH_NO_RX_DATA
+ */
+EzspStatus ashSerialReadPeek(const int8u **data, int16u *count);
+
+/** @brief Consumes bytes returned by ashSerialReadPeek().
+ *
+ * @param count number of bytes consumed, not more than were returned
+ */
+void ashSerialReadSkip(int16u count);
+
 /** @brief Discards input data from the serial port until there
  *  is none left.
  */
@@ -112,6 +133,14 @@ void ashDebugFlush(void);
 
 int ashSerialGetFd(void);
 
+/** @brief Sets a function to be called each time the serial port is closed,
+ *  with the file descriptor it had.  A gateway uses this to stop watching
+ *  the descriptor, since the port may be reopened under the same number.
+ *
+ * @param handler the function to call, or NULL for none
+ */
+void ashSetSerialCloseHandler(void (*handler)(int fd));
+
 
 /** @brief tests to see if all serial transmit data has actually been shifted
  *  out the host's serial port transmit data pin.
@@ -44,6 +44,8 @@ static AshBuffer ashRxPool[EZSP_HOST_ASH_RX_POOL_SIZE];
 //------------------------------------------------------------------------------
 // Forward Declarations
 
+static void ashInitQueue(AshQueue *queue);
+
 //#define ASH_QUEUE_TEST
 #ifdef ASH_QUEUE_TEST
 static void ashQueueTest(void);
@@ -58,14 +60,16 @@ void ashInitQueues(void)
 {
   AshBuffer *buffer;
 
-  txQueue.tail = NULL;
-  reTxQueue.tail = NULL;
+  ashInitQueue(&txQueue);
+  ashInitQueue(&reTxQueue);
   txFree.link = NULL;
+  txFree.length = 0;
   for (buffer = ashTxPool; buffer < &ashTxPool[TX_POOL_BUFFERS]; buffer++)
     ashFreeBuffer(&txFree, buffer);
 
-  rxQueue.tail = NULL;
+  ashInitQueue(&rxQueue);
   rxFree.link = NULL;
+  rxFree.length = 0;
   for (buffer = ashRxPool; 
        buffer < &ashRxPool[EZSP_HOST_ASH_RX_POOL_SIZE]; 
        buffer++)
@@ -77,6 +81,14 @@ void ashInitQueues(void)
 
 }
 
+// Set a queue to empty
+static void ashInitQueue(AshQueue *queue)
+{
+  queue->tail = NULL;
+  queue->head = NULL;
+  queue->length = 0;
+}
+
 // Add a buffer to a free list
 void ashFreeBuffer(AshFreeList *list, AshBuffer *buffer)
 {
@@ -86,6 +98,7 @@ void ashFreeBuffer(AshFreeList *list, AshBuffer *buffer)
   }
   buffer->link = list->link;
   list->link = buffer;
+  list->length++;
 }
 
 // Get a buffer from the free list
@@ -96,6 +109,7 @@ AshBuffer *ashAllocBuffer(AshFreeList *list)
   buffer = list->link;
   if (buffer != NULL) {
     list->link = buffer->link;
+    list->length--;
     buffer->len = 0;
     memset(buffer->data, 0, ASH_MAX_DATA_FIELD_LEN);
   }
@@ -105,59 +119,53 @@ AshBuffer *ashAllocBuffer(AshFreeList *list)
 // Remove the buffer at the head of a queue
 AshBuffer *ashRemoveQueueHead(AshQueue *queue)
 {
-  AshBuffer *head, *prev;
+  AshBuffer *head;
 
-  head = queue->tail;
+  head = queue->head;
   if (head == NULL) {
     ashTraceEvent("Tried to remove head from an empty queue\r\n");
     assert(FALSE);
   }
-  if (head->link == NULL)
-    queue->tail = NULL;
-  else {
-    do {
-      prev = head;
-      head = head->link;
-    } while (head->link != NULL);
-  prev->link = NULL;
-  }
+  (void)ashRemoveQueueEntry(queue, head);
   return head;
 }
 
 // Get a pointer to the buffer at the head of a queue
 AshBuffer *ashQueueHead(AshQueue *queue)
 {
-  AshBuffer *head;
-
-  head = queue->tail;
-  if (head == NULL) {
+  if (queue->head == NULL) {
     ashTraceEvent("Tried to access head in an empty queue\r\n");
     assert(FALSE);
   }
-  if(head != NULL) {
-    while (head->link != NULL)
-      head = head->link;
-  }
-  return head;
+  return queue->head;
 }
 
-// Get a pointer to the Nth entry in a queue (the tail corresponds to N = 1)
-AshBuffer *ashQueueNthEntry(AshQueue *queue, int8u n)
+// Get a pointer to the Nth entry in a queue (the tail corresponds to N = 1),
+// walking from whichever end of the queue is nearer.
+AshBuffer *ashQueueNthEntry(AshQueue *queue, int16u n)
 {
   AshBuffer *buffer;
+  int16u count;
 
   if (n == 0) {
     ashTraceEvent("Asked for 0th element in queue\r\n");
     assert(FALSE);
   }
-  buffer = queue->tail;
-  while (--n) {
-    if (buffer == NULL) {
-      ashTraceEvent("Less than N entries in queue\r\n");
-      assert(FALSE);
+  if (n > queue->length) {
+    ashTraceEvent("Less than N entries in queue\r\n");
+    assert(FALSE);
+  }
+  if (n <= queue->length / 2) {
+    buffer = queue->tail;
+    while (--n) {
+      buffer = buffer->link;
     }
-    buffer = buffer->link;
-  } 
+  } else {
+    buffer = queue->head;
+    for (count = queue->length; count > n; count--) {
+      buffer = buffer->preceding;
+    }
+  }
   return buffer;  
 }
 
@@ -166,61 +174,45 @@ AshBuffer *ashQueueNthEntry(AshQueue *queue, int8u n)
 // If the buffer specified is the tail, NULL is returned;
 AshBuffer *ashQueuePrecedingEntry(AshQueue *queue, AshBuffer *buffer)
 {
-  AshBuffer *ptr;
-
-  ptr = queue->tail;
-  if (ptr == buffer) {
-    return NULL;
-  } else {
-    do {
-      if (ptr->link == buffer) {      
-        return ptr;
-      }
-      ptr = ptr->link;
-    } while(ptr != NULL);
-    ashTraceEvent("Buffer not in queue\r\n");
-    assert(FALSE);
-    return NULL;
+  if (buffer == NULL) {
+    return queue->head;
   }
+  return buffer->preceding;
 }
 
 // Remove the specified entry from a queue, return a pointer to the preceding
 // entry (if any).
 AshBuffer *ashRemoveQueueEntry(AshQueue *queue, AshBuffer *buffer)
 {
-  AshBuffer *ptr;
+  AshBuffer *preceding = buffer->preceding;
+  AshBuffer *next = buffer->link;
 
-  ptr = ashQueuePrecedingEntry(queue, buffer);
-  if (ptr != NULL) {
-    ptr->link = buffer->link;
+  if (preceding != NULL) {
+    preceding->link = next;
   } else {
-    queue->tail = buffer->link;
+    queue->tail = next;
   }
-  return ptr;
+  if (next != NULL) {
+    next->preceding = preceding;
+  } else {
+    queue->head = preceding;
+  }
+  buffer->link = NULL;
+  buffer->preceding = NULL;
+  queue->length--;
+  return preceding;
 }
 
 // Get the number of buffers in a queue
-int8u ashQueueLength(AshQueue *queue)
+int16u ashQueueLength(AshQueue *queue)
 {
-  AshBuffer *head;
-  int8u count;
-
-  head = queue->tail;
-  for (count = 0; head != NULL; count++)
-    head = head->link;
-  return count;
+  return queue->length;
 }
 
 // Get the number of buffers in a free list
-int8u ashFreeListLength(AshFreeList *list)
+int16u ashFreeListLength(AshFreeList *list)
 {
-  AshBuffer *next;
-  int8u count;
-
-  next = list->link;
-  for (count = 0; next != NULL; count++)
-    next = next->link;
-  return count;
+  return list->length;
 }
 
 // Add a buffer to the tail of a queue
@@ -231,7 +223,14 @@ void ashAddQueueTail(AshQueue *queue, AshBuffer *buffer)
     assert(FALSE);
   }
   buffer->link = queue->tail;
+  buffer->preceding = NULL;
+  if (queue->tail != NULL) {
+    queue->tail->preceding = buffer;
+  } else {
+    queue->head = buffer;
+  }
   queue->tail = buffer;
+  queue->length++;
 }
 
 // Return whether or not the queue is empty
@@ -265,7 +264,7 @@ void ashQueueTest(void)
 // Returns 0 if all tests pass, otherwise the number of the first test to fail.
 static int32u ashInternalQueueTest(void)
 {
-  int8u i;
+  int16u i;
   AshBuffer *buf, *bufx;
 
   ashInitQueues();
@@ -368,8 +367,9 @@ static int32u ashInternalQueueTest(void)
   ashFreeBuffer(&txFree, buf);
   bufx = buf;
 
-  txQueue.tail = NULL;
+  ashInitQueue(&txQueue);
   txFree.link = NULL;
+  txFree.length = 0;
   for (buf = ashTxPool; buf < &ashTxPool[TX_POOL_BUFFERS]; buf++)
     ashFreeBuffer(&txFree, buf);
   for (i = 1; ; i++) {
@@ -32,21 +32,27 @@
 /** @brief Buffer to hold a DATA frame.
 */
 typedef struct ashBuffer {
-  struct ashBuffer *link; 
+  struct ashBuffer *link;       // next entry toward the head, or free list link
+  struct ashBuffer *preceding;  // next entry toward the tail
   int8u len; 
   int8u data[ASH_MAX_DATA_FIELD_LEN];
 } AshBuffer;
 
-/** @brief Simple queue (singly-linked list)
+/** @brief Queue (doubly-linked list) with its length. The head, the tail,
+*  the length and any entry's neighbours can all be found without walking 
+*  the list.
 */
 typedef struct {
   AshBuffer *tail;
+  AshBuffer *head;
+  int16u length;
 } AshQueue;
 
-/** @brief Simple free list (singly-linked list)
+/** @brief Simple free list (singly-linked list) with its length
 */
 typedef struct {
   AshBuffer *link;
+  int16u length;
 } AshFreeList;
 
 /** @brief Initializes all queues and free lists. 
@@ -98,7 +104,7 @@ AshBuffer *ashQueueHead(AshQueue *queue);
  *
  * @return        pointer to the Nth queue entry
  */
-AshBuffer *ashQueueNthEntry(AshQueue *queue, int8u n);
+AshBuffer *ashQueueNthEntry(AshQueue *queue, int16u n);
 
 /** @brief  Get a pointer to the queue entry before (closer to the tail)
  *  than the specified entry. 
@@ -128,7 +134,7 @@ AshBuffer *ashRemoveQueueEntry(AshQueue *queue, AshBuffer *buffer);
  *
  * @return        number of entries in the queue
  */
-int8u ashQueueLength(AshQueue *queue);
+int16u ashQueueLength(AshQueue *queue);
 
 
 /** @brief  Returns the number of entries in the free list.
@@ -137,7 +143,7 @@ int8u ashQueueLength(AshQueue *queue);
  *  
  * @return        number of entries in the free list
  */
-int8u ashFreeListLength(AshFreeList *list);
+int16u ashFreeListLength(AshFreeList *list);
 
 /** @brief Add a buffer to the tail of the queue.
  *
@@ -0,0 +1,387 @@
+/** @file ash-host-thread.c
+ *  @brief  ASH host serial I/O thread
+ *
+ * The I/O thread runs the ASH protocol: it writes frames taken from txRing,
+ * reads the serial port, sends ACKs and NAKs, retransmits, and moves
+ * received DATA frames from rxQueue to rxRing. The application thread is
+ * the only producer for txRing and the only consumer for rxRing, so the
+ * rings need no locks, only acquire and release ordering on their indexes.
+ *
+ * Each thread has a pipe that the other writes to when it adds to a ring
+ * that was empty, so that neither thread has to poll.
+ *
+ * After each pass the I/O thread publishes the depths of its queues and a
+ * copy of ashCount for the application thread's statistics.
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.        *80*-->
+ */
+
+#ifdef ASH_HOST_THREAD
+
+#include PLATFORM_HEADER
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include "stack/include/ember-types.h"
+#include "hal/micro/generic/ash-protocol.h"
+#include "hal/micro/generic/ash-common.h"
+#include "app/util/ezsp/ezsp-host-configuration-defaults.h"
+#include "app/ezsp-uart-host/ash-host.h"
+#include "app/ezsp-uart-host/ash-host-io.h"
+#include "app/ezsp-uart-host/ash-host-queues.h"
+#include "app/ezsp-uart-host/ash-host-thread.h"
+
+#if (ASH_THREAD_RING_SIZE & (ASH_THREAD_RING_SIZE - 1)) != 0
+  #error "ASH_THREAD_RING_SIZE must be a power of 2"
+#endif
+
+//------------------------------------------------------------------------------
+// Preprocessor definitions
+
+// The longest the I/O thread sleeps while it has work it cannot finish
+// without the application thread: frames it could not yet send, or
+// received frames that do not fit in rxRing.
+#define BUSY_POLL_MS    10
+
+#define atomicLoad(ptr)         __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define atomicStore(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+
+//------------------------------------------------------------------------------
+// Local Variables
+
+static AshRing txRing;                  // application thread -> I/O thread
+static AshRing rxRing;                  // I/O thread -> application thread
+static pthread_t ioThread;
+static boolean running = FALSE;         // written only by application thread
+static boolean stopRequested;
+static boolean connected;               // written only by I/O thread
+static int ioWakePipe[2] = { -1, -1 };  // readable when txRing has frames
+static int appWakePipe[2] = { -1, -1 }; // readable when rxRing has frames
+
+// Published by the I/O thread after each pass.
+static int16u txQueueDepth;
+static int16u reTxQueueDepth;
+static AshCount publishedCount;
+static pthread_mutex_t countLock = PTHREAD_MUTEX_INITIALIZER;
+
+//------------------------------------------------------------------------------
+// Forward Declarations
+
+static void *ashThreadMain(void *arg);
+static void ashThreadRunAsh(void);
+static void ashThreadPushError(EzspStatus status);
+static void ashThreadPublish(void);
+static void wake(int fd);
+static void drain(int fd);
+static void closePipe(int *fds);
+
+//------------------------------------------------------------------------------
+// Ring buffer functions
+
+void ashRingInit(AshRing *ring)
+{
+  ring->head = 0;
+  ring->tail = 0;
+}
+
+AshThreadFrame *ashRingWriteSlot(AshRing *ring)
+{
+  int32u tail = ring->tail;
+  if (tail - atomicLoad(&ring->head) >= ASH_THREAD_RING_SIZE) {
+    return NULL;
+  }
+  return &ring->frames[tail & (ASH_THREAD_RING_SIZE - 1)];
+}
+
+void ashRingPush(AshRing *ring)
+{
+  atomicStore(&ring->tail, ring->tail + 1);
+}
+
+AshThreadFrame *ashRingReadSlot(AshRing *ring)
+{
+  int32u head = ring->head;
+  if (head == atomicLoad(&ring->tail)) {
+    return NULL;
+  }
+  return &ring->frames[head & (ASH_THREAD_RING_SIZE - 1)];
+}
+
+void ashRingPop(AshRing *ring)
+{
+  atomicStore(&ring->head, ring->head + 1);
+}
+
+int16u ashRingLength(AshRing *ring)
+{
+  return (int16u)(atomicLoad(&ring->tail) - atomicLoad(&ring->head));
+}
+
+//------------------------------------------------------------------------------
+// Application thread functions
+
+EzspStatus ashThreadStart(void)
+{
+  if (running) {
+    return EZSP_SUCCESS;
+  }
+  if (pipe(ioWakePipe) < 0) {
+    return EZSP_ASH_HOST_FATAL_ERROR;
+  }
+  if (pipe(appWakePipe) < 0) {
+    closePipe(ioWakePipe);
+    return EZSP_ASH_HOST_FATAL_ERROR;
+  }
+  fcntl(ioWakePipe[0], F_SETFL, O_NONBLOCK);
+  fcntl(ioWakePipe[1], F_SETFL, O_NONBLOCK);
+  fcntl(appWakePipe[0], F_SETFL, O_NONBLOCK);
+  fcntl(appWakePipe[1], F_SETFL, O_NONBLOCK);
+  ashRingInit(&txRing);
+  ashRingInit(&rxRing);
+  stopRequested = FALSE;
+  connected = ashIsConnected();
+  ashThreadPublish();
+  if (pthread_create(&ioThread, NULL, ashThreadMain, NULL) != 0) {
+    closePipe(ioWakePipe);
+    closePipe(appWakePipe);
+    return EZSP_ASH_HOST_FATAL_ERROR;
+  }
+  running = TRUE;
+  return EZSP_SUCCESS;
+}
+
+void ashThreadStop(void)
+{
+  if (!running) {
+    return;
+  }
+  atomicStore(&stopRequested, TRUE);
+  wake(ioWakePipe[1]);
+  pthread_join(ioThread, NULL);
+  running = FALSE;
+  connected = FALSE;
+  closePipe(ioWakePipe);
+  closePipe(appWakePipe);
+}
+
+EzspStatus ashThreadSend(int8u len, const int8u *data)
+{
+  AshThreadFrame *frame;
+
+  if (len < ASH_MIN_DATA_FIELD_LEN ) {
+    return EZSP_ASH_DATA_FRAME_TOO_SHORT;
+  } else if (len > ASH_MAX_DATA_FIELD_LEN) {
+    return EZSP_ASH_DATA_FRAME_TOO_LONG;
+  }
+  if (!ashThreadIsConnected()) {
+    return EZSP_ASH_NOT_CONNECTED;
+  }
+  frame = ashRingWriteSlot(&txRing);
+  if (frame == NULL) {
+    return EZSP_ASH_NO_TX_SPACE;
+  }
+  frame->status = EZSP_SUCCESS;
+  frame->len = len;
+  MEMCOPY(frame->data, data, len);
+  ashRingPush(&txRing);
+  wake(ioWakePipe[1]);
+  return EZSP_SUCCESS;
+}
+
+EzspStatus ashThreadReceive(int8u *len, int8u *data)
+{
+  AshThreadFrame *frame;
+  EzspStatus status;
+
+  *len = 0;
+  if (!running) {
+    return EZSP_ASH_NOT_CONNECTED;
+  }
+  frame = ashRingReadSlot(&rxRing);
+  if (frame == NULL) {
+    // Clear the wakeup before looking again, so that a frame added in
+    // between leaves the pipe readable rather than being missed.
+    drain(appWakePipe[0]);
+    frame = ashRingReadSlot(&rxRing);
+    if (frame == NULL) {
+      return EZSP_ASH_NO_RX_DATA;
+    }
+  }
+  status = frame->status;
+  if (status == EZSP_SUCCESS) {
+    MEMCOPY(data, frame->data, frame->len);
+    *len = frame->len;
+  }
+  ashRingPop(&rxRing);
+  return status;
+}
+
+int16u ashThreadReceiveCount(void)
+{
+  return running ? ashRingLength(&rxRing) : 0;
+}
+
+boolean ashThreadIsConnected(void)
+{
+  return running && atomicLoad(&connected);
+}
+
+int ashThreadGetFd(void)
+{
+  return running ? appWakePipe[0] : ashSerialGetFd();
+}
+
+int16u ashThreadTxQueueLength(void)
+{
+  if (!running) {
+    return ashQueueLength(&txQueue);
+  }
+  return ashRingLength(&txRing) + atomicLoad(&txQueueDepth);
+}
+
+int16u ashThreadReTxQueueLength(void)
+{
+  if (!running) {
+    return ashQueueLength(&reTxQueue);
+  }
+  return atomicLoad(&reTxQueueDepth);
+}
+
+void ashThreadReadCounters(AshCount *counters)
+{
+  if (!running) {
+    MEMCOPY(counters, &ashCount, sizeof(AshCount));
+    return;
+  }
+  pthread_mutex_lock(&countLock);
+  MEMCOPY(counters, &publishedCount, sizeof(AshCount));
+  pthread_mutex_unlock(&countLock);
+}
+
+//------------------------------------------------------------------------------
+// I/O thread functions
+
+static void *ashThreadMain(void *arg)
+{
+  struct pollfd fds[2];
+  int16u timeout;
+
+  fds[0].fd = ashSerialGetFd();
+  fds[0].events = POLLIN;
+  fds[1].fd = ioWakePipe[0];
+  fds[1].events = POLLIN;
+
+  while (!atomicLoad(&stopRequested)) {
+    drain(ioWakePipe[0]);
+    ashThreadRunAsh();
+
+    timeout = ashMsToNextTimeout();
+    if ( (!ashQueueIsEmpty(&txQueue) || !ashQueueIsEmpty(&rxQueue))
+         && timeout > BUSY_POLL_MS) {
+      timeout = BUSY_POLL_MS;
+    }
+    (void)poll(fds, 2, (timeout == 0xFFFF) ? -1 : timeout);
+  }
+  return NULL;
+}
+
+// One pass of the ASH protocol: queues the application's frames for
+// transmission, reads and acknowledges received frames, and passes them on.
+static void ashThreadRunAsh(void)
+{
+  AshThreadFrame *frame;
+  EzspStatus status;
+  boolean wasEmpty;
+
+  while ((frame = ashRingReadSlot(&txRing)) != NULL) {
+    status = ashSend(frame->len, frame->data);
+    if (status == EZSP_ASH_NO_TX_SPACE) {
+      break;                            // try again when ACKs free buffers
+    }
+    ashRingPop(&txRing);
+    if (status != EZSP_SUCCESS) {
+      ashThreadPushError(status);
+    }
+  }
+
+  ashSendExec();
+  // ashReceiveExec() returns after each frame, and the rest of a block read
+  // from the port would not wake poll(), so read until there is no more.
+  do {
+    status = ashReceiveExec();
+    if (status != EZSP_SUCCESS
+        && status != EZSP_ASH_IN_PROGRESS
+        && status != EZSP_ASH_NO_RX_DATA) {
+      ashThreadPushError(status);
+    }
+  } while (status == EZSP_SUCCESS);
+
+  // Frames that do not fit in rxRing stay in rxQueue, where they count
+  // against rxFree and so hold off the NCP with ASH flow control.
+  wasEmpty = (ashRingLength(&rxRing) == 0);
+  while (!ashQueueIsEmpty(&rxQueue)
+         && (frame = ashRingWriteSlot(&rxRing)) != NULL) {
+    frame->status = ashReceive(&frame->len, frame->data);
+    if (frame->status != EZSP_SUCCESS) {
+      break;
+    }
+    ashRingPush(&rxRing);
+  }
+  if (wasEmpty && ashRingLength(&rxRing) != 0) {
+    wake(appWakePipe[1]);
+  }
+
+  // Send the ACKs for the frames just received without waiting.
+  ashSendExec();
+  atomicStore(&connected, ashIsConnected());
+  ashThreadPublish();
+}
+
+// Makes the queue depths and counters available to the application thread.
+static void ashThreadPublish(void)
+{
+  atomicStore(&txQueueDepth, ashQueueLength(&txQueue));
+  atomicStore(&reTxQueueDepth, ashQueueLength(&reTxQueue));
+  pthread_mutex_lock(&countLock);
+  MEMCOPY(&publishedCount, &ashCount, sizeof(AshCount));
+  pthread_mutex_unlock(&countLock);
+}
+
+// Passes an error status to the application thread, in order with the
+// received frames. The status is lost if rxRing is full.
+static void ashThreadPushError(EzspStatus status)
+{
+  AshThreadFrame *frame = ashRingWriteSlot(&rxRing);
+  if (frame != NULL) {
+    frame->status = status;
+    frame->len = 0;
+    ashRingPush(&rxRing);
+    wake(appWakePipe[1]);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Utility functions
+
+static void wake(int fd)
+{
+  int8u byte = 0;
+  (void)write(fd, &byte, 1);  // if the pipe is full the reader is awake anyway
+}
+
+static void drain(int fd)
+{
+  int8u bytes[64];
+  while (read(fd, bytes, sizeof(bytes)) > 0)
+    ;
+}
+
+static void closePipe(int *fds)
+{
+  close(fds[0]);
+  close(fds[1]);
+  fds[0] = fds[1] = -1;
+}
+
+#endif //ASH_HOST_THREAD
@@ -0,0 +1,155 @@
+/** @file ash-host-thread.h
+ * @brief Header for the optional ASH host serial I/O thread
+ *
+ * When the host is built with ASH_HOST_THREAD defined, a dedicated thread
+ * owns the serial port and runs ashSendExec() and ashReceiveExec(), so ACKs,
+ * NAKs and retransmissions are handled on time however long the application
+ * spends in its callbacks. The thread exchanges complete EZSP frames with
+ * the application thread through two single-producer, single-consumer ring
+ * buffers that need no locks.
+ *
+ * Only serial-interface-uart.c uses these functions. All other ASH
+ * functions, and the ASH queues, belong to the I/O thread while it is
+ * running. Threaded mode does not support putting the NCP to sleep.
+ *
+ * See @ref ash_util for documentation.
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.        *80*-->
+ */
+
+#ifndef __ASH_HOST_THREAD_H__
+#define __ASH_HOST_THREAD_H__
+
+/** @addtogroup ash_util
+ *
+ * See ash-host-thread.h.
+ *
+ *@{
+ */
+
+/** @brief The number of frames each ring buffer holds. Must be a power
+ *  of 2.
+ */
+#ifndef ASH_THREAD_RING_SIZE
+  #define ASH_THREAD_RING_SIZE 32
+#endif
+
+/** @brief An EZSP frame passed between the threads. If status is not
+ *  EZSP_SUCCESS the entry carries an error reported by the I/O thread
+ *  instead of a frame.
+ */
+typedef struct {
+  EzspStatus status;
+  int8u len;
+  int8u data[ASH_MAX_DATA_FIELD_LEN];
+} AshThreadFrame;
+
+/** @brief A single-producer, single-consumer ring of frames. head is only
+ *  written by the consumer and tail only by the producer.
+ */
+typedef struct {
+  int32u head;
+  int32u tail;
+  AshThreadFrame frames[ASH_THREAD_RING_SIZE];
+} AshRing;
+
+/** @brief Empties a ring. Neither thread may be using it.
+ */
+void ashRingInit(AshRing *ring);
+
+/** @brief Returns the free entry at the tail of the ring for the producer
+ *  to fill in, or NULL if the ring is full. The entry is not seen by the
+ *  consumer until ashRingPush() is called.
+ */
+AshThreadFrame *ashRingWriteSlot(AshRing *ring);
+
+/** @brief Adds the entry returned by ashRingWriteSlot() to the ring.
+ */
+void ashRingPush(AshRing *ring);
+
+/** @brief Returns the entry at the head of the ring for the consumer to
+ *  read, or NULL if the ring is empty.
+ */
+AshThreadFrame *ashRingReadSlot(AshRing *ring);
+
+/** @brief Removes the entry returned by ashRingReadSlot() from the ring.
+ */
+void ashRingPop(AshRing *ring);
+
+/** @brief Returns the number of entries in the ring.
+ */
+int16u ashRingLength(AshRing *ring);
+
+/** @brief Starts the I/O thread. ASH must already be connected to the NCP
+ *  (see ashStart()).
+ *
+ * @return
+ * - ::EZSP_SUCCESS
+ * - ::EZSP_ASH_HOST_FATAL_ERROR
+ */
+EzspStatus ashThreadStart(void);
+
+/** @brief Stops the I/O thread and waits for it to exit. Any frames still
+ *  in the ring buffers are discarded. Does nothing if the thread is not
+ *  running.
+ */
+void ashThreadStop(void);
+
+/** @brief Passes an EZSP frame to the I/O thread to send.
+ *
+ * @return
+ * - ::EZSP_SUCCESS
+ * - ::EZSP_ASH_NO_TX_SPACE
+ * - ::EZSP_ASH_DATA_FRAME_TOO_SHORT
+ * - ::EZSP_ASH_DATA_FRAME_TOO_LONG
+ * - ::EZSP_ASH_NOT_CONNECTED
+ */
+EzspStatus ashThreadSend(int8u len, const int8u *data);
+
+/** @brief Copies the next EZSP frame received by the I/O thread into data.
+ *
+ * @return
+ * - ::EZSP_SUCCESS
+ * - ::EZSP_ASH_NO_RX_DATA
+ * - any error status reported by ashReceiveExec() in the I/O thread
+ */
+EzspStatus ashThreadReceive(int8u *len, int8u *data);
+
+/** @brief Returns the number of frames the I/O thread has received that
+ *  ashThreadReceive() has not yet returned.
+ */
+int16u ashThreadReceiveCount(void);
+
+/** @brief Returns the number of frames waiting to be sent: those passed to
+ *  ashThreadSend() that the I/O thread has not yet taken, and those in the
+ *  ASH transmit queue as of its last pass through the protocol.
+ */
+int16u ashThreadTxQueueLength(void);
+
+/** @brief Returns the number of frames in the ASH retransmit queue as of the
+ *  I/O thread's last pass through the protocol.
+ */
+int16u ashThreadReTxQueueLength(void);
+
+/** @brief Copies the ASH counters as of the I/O thread's last pass through
+ *  the protocol. The application thread must use this rather than reading
+ *  ashCount, which the I/O thread updates. If the thread is not running
+ *  ashCount is copied directly.
+ */
+void ashThreadReadCounters(AshCount *counters);
+
+/** @brief Returns TRUE if the I/O thread is running and ASH is in the
+ *  Connected state.
+ */
+boolean ashThreadIsConnected(void);
+
+/** @brief Returns a file descriptor that becomes readable when the I/O
+ *  thread has received a frame. The application can wait on this instead
+ *  of the serial port.
+ */
+int ashThreadGetFd(void);
+
+/** @} // END addtogroup
+ */
+
+#endif //__ASH_HOST_THREAD_H__
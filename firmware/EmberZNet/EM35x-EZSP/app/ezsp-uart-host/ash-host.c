@@ -680,6 +680,28 @@ boolean ashOkToSleep(void)
     );   
 }
 
+int16u ashMsToNextTimeout(void)
+{
+  int16u now = halCommonGetInt16uMillisecondTick();
+  int16u elapsed;
+  int16u ms = 0xFFFF;
+  int8s nrUnits;
+
+  if (ashAckTimerIsRunning()) {
+    elapsed = now - ashAckTimer;
+    ms = (elapsed < ashAckPeriod) ? ashAckPeriod - elapsed : 0;
+  }
+  if (ashNrTimer) {
+    nrUnits = (int8s)(ashNrTimer - (int8u)(now >> ASH_NR_TIMER_BIT));
+    if (nrUnits <= 0) {
+      ms = 0;
+    } else if (((int16u)nrUnits << ASH_NR_TIMER_BIT) < ms) {
+      ms = (int16u)nrUnits << ASH_NR_TIMER_BIT;
+    }
+  }
+  return ms;
+}
+
 //------------------------------------------------------------------------------
 // Utility functions
 
@@ -709,7 +731,7 @@ static void ashInitVariables()
 // ACKs and NAKs. Note that not ready status must be refreshed if it persists
 // beyond a maximum time limit.
 static void ashDataFrameFlowControl(void) {
-  int8u freeRxBuffers;
+  int16u freeRxBuffers;
 
   if (ashFlags & FLG_CONNECTED) {
     freeRxBuffers = ashFreeListLength(&rxFree);
@@ -801,9 +823,12 @@ static EzspStatus ashNcpDisconnect(int8u error)
 
 static EzspStatus ashReadFrame(void)
 {
-  int8u index;
-  int8u in;
-  int8u out;
+  const int8u *in;
+  int16u count;
+  int16u used;
+  int16u more;
+  int8u *out;
+  int16u space;
   EzspStatus status;
 
   if (!ashDecodeInProgress) {
@@ -812,51 +837,67 @@ static EzspStatus ashReadFrame(void)
   }
 
   do {
-    // Get next byte from serial port, return if no data
-    status = ashSerialReadByte(&in);
+    // Get next block of bytes from serial port, return if no data
+    status = ashSerialReadPeek(&in, &count);
     if (status == EZSP_ASH_NO_RX_DATA) {
       break;
     }
 
     // 0xFF byte signals a callback is pending when between frames
     // in synchronous (polled) callback mode.
-    if (!ashDecodeInProgress && (in == ASH_WAKE)) {
+    if (!ashDecodeInProgress && (*in == ASH_WAKE)) {
       if (ncpSleepEnabled) {
         ncpHasCallbacks = TRUE;
       }
+      ashSerialReadSkip(1);
       status = EZSP_ASH_IN_PROGRESS;
       continue;
     }
 
-    // Decode next input byte - note that many input bytes do not produce
-    // an output byte. Return on any error in decoding.
-    index = rxLen;
-    status = ashDecodeByte(in, &out, &rxLen);
+    // Decode as much of the block as possible - a short frame is returned
+    // in rxBuffer, and a longer DATA frame in an AshBuffer. (Note the control
+    // byte is always returned in rxControl. Even if no buffer can be
+    // allocated, the control's ackNum must be processed.)
+    if (rxDataBuffer != NULL) {
+      out = rxDataBuffer->data + rxLen - 1;   // -1 since control is omitted
+      space = ASH_MAX_DATA_FIELD_LEN - (rxLen - 1);
+    } else if (rxLen <= RX_BUFFER_LEN) {
+      out = rxBuffer + rxLen;
+      space = RX_BUFFER_LEN - rxLen;
+    } else {
+      out = NULL;
+      space = 0;
+    }
+    status = ashDecodeBlock(in, count, &used, out, space, &rxLen);
+
+    // If decoding stopped because rxBuffer is full, allocate an AshBuffer,
+    // copy the prior data and carry on decoding into it
+    if ((status == EZSP_ASH_IN_PROGRESS) && (used < count)) {
+      rxDataBuffer = ashAllocBuffer(&rxFree);
+      ashTraceEzspVerbose("ashReadFrame(): ashAllocBuffer(): %u", rxDataBuffer);
+      out = NULL;
+      if (rxDataBuffer != NULL) {
+        memcpy(rxDataBuffer->data, rxBuffer + 1, RX_BUFFER_LEN - 1);
+        rxDataBuffer->len = RX_BUFFER_LEN - 1;
+        out = rxDataBuffer->data + RX_BUFFER_LEN - 1;
+      }
+      status = ashDecodeBlock(in + used,
+                              count - used,
+                              &more,
+                              out,
+                              ASH_MAX_DATA_FIELD_LEN - (RX_BUFFER_LEN - 1),
+                              &rxLen);
+      used += more;
+    }
+    ashSerialReadSkip(used);
+
+    // Return on any error in decoding.
     if ( (status != EZSP_ASH_IN_PROGRESS) && (status != EZSP_SUCCESS) ) {
       ashFreeNonNullRxBuffer();
       break;                  // discard an invalid frame
     }
-
-    if (rxLen != index) {           // if input byte produced an output byte
-      if (rxLen <= RX_BUFFER_LEN) { // if a short frame, return in rxBuffer
-        rxBuffer[index] = out;
-      // If a longer DATA frame, allocate an AshBuffer for it.
-      // (Note the control byte is always returned in rxControl. Even if
-      // no buffer can be allocated, the control's ackNum must be processed.)
-      } else {
-        if (rxLen == RX_BUFFER_LEN + 1)  {  // alloc buffer, copy prior data
-          rxDataBuffer = ashAllocBuffer(&rxFree);
-          ashTraceEzspVerbose("ashReadFrame(): ashAllocBuffer(): %u", rxDataBuffer);
-          if (rxDataBuffer != NULL) {
-            memcpy(rxDataBuffer->data, rxBuffer + 1, RX_BUFFER_LEN - 1);
-            rxDataBuffer->len = RX_BUFFER_LEN - 1;
-          }
-        }
-        if (rxDataBuffer != NULL) {     // copy next byte to buffer
-          rxDataBuffer->data[index-1] = out;  // -1 since control is omitted
-          rxDataBuffer->len = index;
-        }
-      }
+    if ((rxDataBuffer != NULL) && (rxLen > RX_BUFFER_LEN)) {
+      rxDataBuffer->len = rxLen - 1;
     }
   } while (status == EZSP_ASH_IN_PROGRESS);
   return status;
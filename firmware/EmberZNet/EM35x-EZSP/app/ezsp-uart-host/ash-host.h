@@ -249,6 +249,13 @@ EzspStatus ashReceive(int8u *len, int8u *buffer);
  */
 boolean ashOkToSleep(void);
 
+/** @brief Returns the number of milliseconds until the acknowledgement or
+ *  Not Ready timer expires, or 0xFFFF if neither is running. The host must
+ *  call ashSendExec() and ashReceiveExec() by then, even if nothing has been
+ *  received from the NCP.
+ */
+int16u ashMsToNextTimeout(void);
+
 #endif //__ASH_HOST_H___
 
 /** @} // END addtogroup
@@ -0,0 +1,168 @@
+/** @file ash-thread-test.c
+ *  @brief ASH I/O thread ring buffer test - passes frames between two
+ *  threads through an AshRing and checks that every frame arrives once,
+ *  in order and intact
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.        *80*-->
+ */
+
+#include PLATFORM_HEADER
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "stack/include/ember-types.h"
+#include "hal/micro/generic/ash-protocol.h"
+#include "app/ezsp-uart-host/ash-host.h"
+#include "app/ezsp-uart-host/ash-host-thread.h"
+
+#define FRAME_COUNT   500000L     // frames passed through the ring per pass
+
+static AshRing ring;
+
+static void *producer(void *arg);
+static void fillFrame(AshThreadFrame *frame, int32u sequence);
+
+int main( int argc, char *argv[] )
+{
+  pthread_t thread;
+  AshThreadFrame *frame;
+  AshThreadFrame expected;
+  int32u sequence;
+  int32u emptyReads;
+  int8u pass;
+
+  for (pass = 0; pass < 2; pass++) {
+    ashRingInit(&ring);
+    if (pthread_create(&thread, NULL, producer, NULL) != 0) {
+      printf("Could not start producer thread.\n");
+      return 1;
+    }
+    emptyReads = 0;
+    for (sequence = 0; sequence < FRAME_COUNT; sequence++) {
+      while ((frame = ashRingReadSlot(&ring)) == NULL) {
+        // The first pass lets the producer run ahead to fill the ring, the
+        // second keeps it nearly empty.
+        emptyReads++;
+        if (pass == 0 || (emptyReads % 64) == 0) {
+          sched_yield();
+        }
+      }
+      fillFrame(&expected, sequence);
+      if (frame->len != expected.len
+          || memcmp(frame->data, expected.data, expected.len) != 0) {
+        printf("Pass %d: frame %d is wrong (len %d, first byte 0x%02X).\n",
+               pass, sequence, frame->len, frame->data[0]);
+        return 1;
+      }
+      ashRingPop(&ring);
+    }
+    pthread_join(thread, NULL);
+    if (ashRingLength(&ring) != 0 || ashRingReadSlot(&ring) != NULL) {
+      printf("Pass %d: ring not empty at end.\n", pass);
+      return 1;
+    }
+    printf("Pass %d: %ld frames received in order, consumer found the ring "
+           "empty %d times.\n", pass, FRAME_COUNT, emptyReads);
+  }
+
+  // A full ring refuses further frames until one is removed.
+  ashRingInit(&ring);
+  for (sequence = 0; sequence < ASH_THREAD_RING_SIZE; sequence++) {
+    if (ashRingWriteSlot(&ring) == NULL) {
+      printf("Ring full after %d frames.\n", sequence);
+      return 1;
+    }
+    ashRingPush(&ring);
+  }
+  if (ashRingWriteSlot(&ring) != NULL
+      || ashRingLength(&ring) != ASH_THREAD_RING_SIZE) {
+    printf("Full ring accepted another frame.\n");
+    return 1;
+  }
+  (void)ashRingReadSlot(&ring);
+  ashRingPop(&ring);
+  if (ashRingWriteSlot(&ring) == NULL) {
+    printf("Ring still full after a frame was removed.\n");
+    return 1;
+  }
+  printf("ASH thread ring test succeeded.\n");
+  return 0;
+}
+
+static void *producer(void *arg)
+{
+  AshThreadFrame *frame;
+  int32u sequence;
+
+  for (sequence = 0; sequence < FRAME_COUNT; sequence++) {
+    while ((frame = ashRingWriteSlot(&ring)) == NULL) {
+      sched_yield();
+    }
+    fillFrame(frame, sequence);
+    ashRingPush(&ring);
+  }
+  return NULL;
+}
+
+// Each frame's length and contents are derived from its sequence number, so
+// a frame read before it was completely written is detected.
+static void fillFrame(AshThreadFrame *frame, int32u sequence)
+{
+  int8u i;
+
+  frame->status = EZSP_SUCCESS;
+  frame->len = ASH_MIN_DATA_FIELD_LEN
+               + sequence % (ASH_MAX_DATA_FIELD_LEN - ASH_MIN_DATA_FIELD_LEN + 1);
+  for (i = 0; i < frame->len; i++) {
+    frame->data[i] = (int8u)(sequence + i * 7);
+  }
+  frame->data[0] = (int8u)sequence;
+  frame->data[1] = (int8u)(sequence >> 8);
+  frame->data[2] = (int8u)(sequence >> 16);
+}
+
+//------------------------------------------------------------------------------
+// EZSP callback function stubs
+
+void ezspErrorHandler(EzspStatus status)
+{}
+
+void ezspTimerHandler(int8u timerId)
+{}
+
+void ezspStackStatusHandler(
+      EmberStatus status) 
+{}
+
+void ezspNetworkFoundHandler(EmberZigbeeNetwork *networkFound,
+                             int8u lastHopLqi,
+                             int8s lastHopRssi)
+{}
+
+void ezspScanCompleteHandler(
+      int8u channel,
+      EmberStatus status) 
+{}
+
+void ezspMessageSentHandler(
+      EmberOutgoingMessageType type,
+      int16u indexOrDestination,
+      EmberApsFrame *apsFrame,
+      int8u messageTag,
+      EmberStatus status,
+      int8u messageLength,
+      int8u *messageContents)
+{}
+
+void ezspIncomingMessageHandler(
+      EmberIncomingMessageType type,
+      EmberApsFrame *apsFrame,
+      int8u lastHopLqi,
+      int8s lastHopRssi,
+      EmberNodeId sender,
+      int8u bindingIndex,
+      int8u addressIndex,
+      int8u messageLength,
+      int8u *messageContents) 
+{}
@@ -0,0 +1,167 @@
+/** @file crc-benchmark.c
+ *  @brief CRC throughput benchmark - compares the table-driven and block
+ *  CRC functions with the original bitwise code, and checks that they all
+ *  give the same results
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.        *80*-->
+ */
+
+#include PLATFORM_HEADER
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "stack/include/ember-types.h"
+#include "hal/micro/crc.h"
+
+#define BUFFER_LEN    (1024L * 1024L)   // bytes per pass
+#define MIN_SECONDS   0.5               // minimum time to run each test
+
+static int8u buffer[BUFFER_LEN];
+
+// The original bitwise implementations, for reference.
+static int16u bitwiseCrc16(int8u newByte, int16u prevResult)
+{
+  prevResult = ((int16u) (prevResult >> 8)) | ((int16u) (prevResult << 8));
+  prevResult ^= newByte;
+  prevResult ^= (prevResult & 0xff) >> 4;
+  prevResult ^= (int16u) (((int16u) (prevResult << 8)) << 4);
+  prevResult ^= ((int8u) (((int8u) (prevResult & 0xff)) << 5)) |
+    ((int16u) ((int16u) ((int8u) (((int8u) (prevResult & 0xff)) >> 3)) << 8));
+  return prevResult;
+}
+
+static int32u bitwiseCrc32(int8u newByte, int32u prevResult)
+{
+  int8u jj;
+  int32u previous;
+  int32u oper;
+
+  previous = (prevResult >> 8) & 0x00FFFFFFL;
+  oper = (prevResult ^ newByte) & 0xFF;
+  for (jj = 0; jj < 8; jj++) {
+    oper = ((oper & 0x01)
+                ? ((oper >> 1) ^ 0xEDB88320L)
+                : (oper >> 1));
+  }
+  return (previous ^ oper);
+}
+
+// Each test computes the CRC of the whole buffer.
+
+static int32u testBitwiseCrc16(void)
+{
+  int32u ii;
+  int16u crc = 0xFFFF;
+  for (ii = 0; ii < BUFFER_LEN; ii++) {
+    crc = bitwiseCrc16(buffer[ii], crc);
+  }
+  return crc;
+}
+
+static int32u testCrc16(void)
+{
+  int32u ii;
+  int16u crc = 0xFFFF;
+  for (ii = 0; ii < BUFFER_LEN; ii++) {
+    crc = halCommonCrc16(buffer[ii], crc);
+  }
+  return crc;
+}
+
+static int32u testCrc16Block(void)
+{
+  int32u ii;
+  int16u crc = 0xFFFF;
+  // ASH frames are at most a few hundred bytes, so use frame-sized blocks
+  for (ii = 0; ii < BUFFER_LEN; ii += 128) {
+    crc = halCommonCrc16Block(buffer + ii, 128, crc);
+  }
+  return crc;
+}
+
+static int32u testBitwiseCrc32(void)
+{
+  int32u ii;
+  int32u crc = INITIAL_CRC;
+  for (ii = 0; ii < BUFFER_LEN; ii++) {
+    crc = bitwiseCrc32(buffer[ii], crc);
+  }
+  return crc;
+}
+
+static int32u testCrc32(void)
+{
+  int32u ii;
+  int32u crc = INITIAL_CRC;
+  for (ii = 0; ii < BUFFER_LEN; ii++) {
+    crc = halCommonCrc32(buffer[ii], crc);
+  }
+  return crc;
+}
+
+static int32u testCrc32Block(void)
+{
+  int32u ii;
+  int32u length;
+  int32u crc = INITIAL_CRC;
+  // Odd-sized blocks, as when an image is read in pieces
+  for (ii = 0; ii < BUFFER_LEN; ii += length) {
+    length = (BUFFER_LEN - ii < 1021) ? BUFFER_LEN - ii : 1021;
+    crc = halCommonCrc32Block(buffer + ii, length, crc);
+  }
+  return crc;
+}
+
+static const struct {
+  const char *name;
+  int32u (*test)(void);
+  int8u reference;            // index of the test whose result must match
+} tests[] = {
+  { "halCommonCrc16 (bitwise)", testBitwiseCrc16, 0 },
+  { "halCommonCrc16",           testCrc16,        0 },
+  { "halCommonCrc16Block",      testCrc16Block,   0 },
+  { "halCommonCrc32 (bitwise)", testBitwiseCrc32, 3 },
+  { "halCommonCrc32",           testCrc32,        3 },
+  { "halCommonCrc32Block",      testCrc32Block,   3 },
+};
+
+#define TEST_COUNT (sizeof(tests) / sizeof(tests[0]))
+
+int main( int argc, char *argv[] )
+{
+  int32u results[TEST_COUNT];
+  int32u ii;
+  int32u passes;
+  clock_t start;
+  double seconds;
+  double baseline = 0;
+  double mbPerSec;
+
+  srand(1);
+  for (ii = 0; ii < BUFFER_LEN; ii++) {
+    buffer[ii] = rand();
+  }
+
+  printf("%-26s %10s %8s\n", "function", "MB/s", "speedup");
+  for (ii = 0; ii < TEST_COUNT; ii++) {
+    passes = 0;
+    start = clock();
+    do {
+      results[ii] = tests[ii].test();
+      passes++;
+      seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    } while (seconds < MIN_SECONDS);
+    mbPerSec = (passes * (double)BUFFER_LEN) / (seconds * 1024 * 1024);
+    if (tests[ii].reference == ii) {
+      baseline = mbPerSec;
+    }
+    printf("%-26s %10.1f %7.1fx\n", tests[ii].name, mbPerSec,
+           mbPerSec / baseline);
+    if (results[ii] != results[tests[ii].reference]) {
+      printf("%s result 0x%08X does not match 0x%08X\n", tests[ii].name,
+             results[ii], results[tests[ii].reference]);
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,768 @@
+/** @file ezsp-benchmark.c
+ *  @brief EZSP-UART and ASH throughput and latency benchmark
+ *
+ * Runs a mix of tests against an NCP, or against ncp-sim, and writes the
+ * results as JSON so that they can be compared between host builds. For
+ * each test it reports commands per second, round trip latency percentiles
+ * for the EZSP frame IDs involved, ASH retransmissions and NAKs, and the
+ * host CPU time used.
+ *
+ * The tests are:
+ *   nop        ezspNop() commands, one at a time
+ *   echo       ezspEcho() commands, one at a time
+ *   async      ezspEcho() commands kept in flight with ezspSendAsyncCommand()
+ *   unicast    ezspSendUnicast() in bursts, each message timed until its
+ *              ezspMessageSentHandler() callback
+ *   callbacks  a timer callback every millisecond, counting how many arrive
+ *   flood      unsolicited callbacks, as fast as the NCP sends them, for
+ *              measuring the host CPU time spent on each (with ncp-sim -c
+ *              and incoming message callbacks from its script)
+ *
+ * The mix is a comma separated list of test:count, for example
+ *   ezsp-benchmark -p /dev/pts/3 -m nop:1000,echo:1000,callbacks:2000
+ * With -s, every callback takes the given time, as one that writes to a
+ * file or a slow terminal would. Comparing ezsp-benchmark and
+ * ezsp-benchmark-thread this way shows the ACK timeouts and retransmissions
+ * that slow callbacks cause when ASH shares their thread.
+ * All ASH host options (see ash-host-ui.c) may also be given.
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.        *80*-->
+ */
+
+#include PLATFORM_HEADER
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "stack/include/ember-types.h"
+#include "stack/include/error.h"
+#include "app/util/ezsp/ezsp-protocol.h"
+#include "app/util/ezsp/ezsp.h"
+#include "app/util/ezsp/ezsp-frame-utilities.h"
+#include "app/util/ezsp/ezsp-enum-decode.h"
+#include "app/util/ezsp/ezsp-host-configuration-defaults.h"
+#include "hal/micro/generic/ash-protocol.h"
+#include "app/ezsp-uart-host/ash-host.h"
+#include "app/ezsp-uart-host/ash-host-ui.h"
+#ifdef ASH_HOST_THREAD
+  #include "app/ezsp-uart-host/ash-host-thread.h"
+#endif
+
+//------------------------------------------------------------------------------
+// Preprocessor definitions
+
+#define MAX_TESTS           16
+#define MAX_ERRORS          100   // a test stops after this many EZSP errors
+#define UNICAST_BURST       8     // messages sent before waiting for callbacks
+#define CALLBACK_TIMER      0
+#define RESPONSE_TIMEOUT_US 5000000L
+#define FAILED_SAMPLE       0xFFFFFFFFL   // an async command that failed
+#define DEFAULT_MIX "nop:1000,echo:1000,async:2000,unicast:1000,callbacks:1000"
+
+//------------------------------------------------------------------------------
+// Types
+
+typedef enum {
+  TEST_NOP,
+  TEST_ECHO,
+  TEST_ASYNC,
+  TEST_UNICAST,
+  TEST_CALLBACKS,
+  TEST_FLOOD,
+  TEST_TYPE_COUNT
+} TestType;
+
+// Round trip times, in microseconds, for one EZSP frame ID.
+typedef struct {
+  int8u frameId;
+  int32u count;
+  int32u size;
+  int32u *samples;
+} Latency;
+
+typedef struct {
+  TestType type;
+  int32u count;                 // commands (or callbacks) to run
+  int32u completed;
+  int32u errors;
+  int32u elapsedUs;
+  int32u cpuUs;
+  AshCount ash;                 // ASH counters for this test alone
+  Latency latency[2];
+  int8u latencyCount;
+} Test;
+
+//------------------------------------------------------------------------------
+// Local Variables
+
+static const char * const testNames[TEST_TYPE_COUNT] =
+  { "nop", "echo", "async", "unicast", "callbacks", "flood" };
+
+static Test tests[MAX_TESTS];
+static int8u testCount;
+static int8u payloadLength = 32;
+static EmberNodeId unicastDestination = 0x0001;
+static char *jsonFileName = NULL;
+static int32u callbackDelayUs = 0;
+static struct timespec startTime;
+
+// Updated by the callbacks
+static int32u errorCount;
+static int32u timerCallbacks;
+static int32u messageSentCallbacks;
+static int32u otherCallbacks;
+static int32u incomingMessageCallbacks;
+static int8u incomingMessageSum;          // so that the payload is read
+static int32u unicastSentUs[256];         // send time by message tag
+static Latency *messageSentLatency;
+
+static const char usage[] =
+"    -d <node id>      unicast destination in hex (default 0001)\n"
+"    -e <bytes>        echo and unicast payload length (default 32)\n"
+"    -j <file>         write the JSON results to a file (default stdout)\n"
+"    -m <mix>          tests to run, as test:count,... (default\n"
+"                      " DEFAULT_MIX ")\n"
+"                      tests: nop, echo, async, unicast, callbacks, flood\n"
+"    -s <us>           time each callback takes (default 0)\n";
+
+//------------------------------------------------------------------------------
+// Forward Declarations
+
+static int splitOptions(int argc, char *argv[], char *ashArgv[]);
+static boolean parseMix(const char *mix);
+static void runTest(Test *test);
+static void runCommandTest(Test *test, Latency *latency);
+static void runAsyncTest(Test *test, Latency *latency);
+static void asyncEchoHandler(EzspStatus status, int8u frameId, void *context);
+static void runUnicastTest(Test *test, Latency *latency);
+static void runCallbackTest(Test *test);
+static void runFloodTest(Test *test);
+static void addLatency(Latency *latency, int8u frameId, int32u samples);
+static int32u percentile(Latency *latency, int32u perThousand);
+static void readCounts(AshCount *counts);
+static void subtractCounts(AshCount *result, AshCount *end, AshCount *start);
+static void slowCallback(void);
+static void writeJson(FILE *out, int32u totalUs);
+static int32u nowUs(void);
+static int32u cpuUs(void);
+static int compareInt32u(const void *a, const void *b);
+
+//------------------------------------------------------------------------------
+// Test functions
+
+int main( int argc, char *argv[] )
+{
+  char **ashArgv = malloc((argc + 1) * sizeof(char *));
+  int ashArgc;
+  EzspStatus status;
+  int8u protocolVersion;
+  int8u stackType;
+  int16u stackVersion;
+  int32u totalUs;
+  FILE *out;
+  int8u i;
+
+  ashArgc = splitOptions(argc, argv, ashArgv);
+  if (ashArgc < 0 || !ashProcessCommandOptions(ashArgc, ashArgv)) {
+    fprintf(stderr, "Benchmark options:\n%s", usage);
+    return 1;
+  }
+  if (testCount == 0 && !parseMix(DEFAULT_MIX)) {
+    return 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &startTime);
+  status = ezspInit();
+  if (status != EZSP_SUCCESS) {
+    fprintf(stderr, "EZSP error: 0x%02X = %s.\n",
+            status, ashEzspErrorString(status));
+    ezspClose();
+    return 1;
+  }
+  protocolVersion = ezspVersion(EZSP_PROTOCOL_VERSION,
+                                &stackType,
+                                &stackVersion);
+  if (protocolVersion != EZSP_PROTOCOL_VERSION) {
+    fprintf(stderr, "Expected NCP EZSP version %d, but read %d.\n",
+            EZSP_PROTOCOL_VERSION, protocolVersion);
+    ezspClose();
+    return 1;
+  }
+
+  totalUs = nowUs();
+  for (i = 0; i < testCount; i++) {
+    fprintf(stderr, "Running %s x %u... ",
+            testNames[tests[i].type], tests[i].count);
+    runTest(&tests[i]);
+    fprintf(stderr, "%u done, %u errors.\n",
+            tests[i].completed, tests[i].errors);
+  }
+  totalUs = nowUs() - totalUs;
+  ezspClose();
+
+  out = stdout;
+  if (jsonFileName != NULL) {
+    out = fopen(jsonFileName, "w");
+    if (out == NULL) {
+      fprintf(stderr, "Cannot open %s.\n", jsonFileName);
+      return 1;
+    }
+  }
+  writeJson(out, totalUs);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
+
+// Takes out the benchmark's own options and returns the rest, to be given to
+// ashProcessCommandOptions(). Returns -1 if an option is invalid.
+static int splitOptions(int argc, char *argv[], char *ashArgv[])
+{
+  int ashArgc = 0;
+  int i;
+  unsigned int value;
+  char option;
+
+  for (i = 0; i < argc; i++) {
+    option = (i > 0 && argv[i][0] == '-' && argv[i][1] != '\0'
+              && argv[i][2] == '\0') ? argv[i][1] : '\0';
+    if (option != 'd' && option != 'e' && option != 'j' && option != 'm'
+        && option != 's') {
+      ashArgv[ashArgc++] = argv[i];
+      continue;
+    }
+    if (++i == argc) {
+      fprintf(stderr, "Option -%c needs a value.\n", option);
+      return -1;
+    }
+    switch (option) {
+    case 'd':
+      if (sscanf(argv[i], "%x", &value) != 1 || value > 0xFFFF) {
+        fprintf(stderr, "Invalid destination %s.\n", argv[i]);
+        return -1;
+      }
+      unicastDestination = value;
+      break;
+    case 'e':
+      if (sscanf(argv[i], "%u", &value) != 1 || value > 100) {
+        fprintf(stderr, "Invalid payload length %s.\n", argv[i]);
+        return -1;
+      }
+      payloadLength = value;
+      break;
+    case 'j':
+      jsonFileName = argv[i];
+      break;
+    case 'm':
+      if (!parseMix(argv[i])) {
+        return -1;
+      }
+      break;
+    case 's':
+      if (sscanf(argv[i], "%u", &value) != 1 || value > 1000000) {
+        fprintf(stderr, "Invalid callback time %s.\n", argv[i]);
+        return -1;
+      }
+      callbackDelayUs = value;
+      break;
+    }
+  }
+  ashArgv[ashArgc] = NULL;
+  return ashArgc;
+}
+
+static boolean parseMix(const char *mix)
+{
+  char name[16];
+  unsigned int count;
+  int length;
+  TestType type;
+
+  testCount = 0;
+  while (*mix != '\0') {
+    if (sscanf(mix, "%15[a-z]:%u%n", name, &count, &length) != 2
+        || count == 0) {
+      fprintf(stderr, "Invalid test mix at \"%s\".\n", mix);
+      return FALSE;
+    }
+    for (type = 0; type < TEST_TYPE_COUNT; type++) {
+      if (strcmp(name, testNames[type]) == 0) {
+        break;
+      }
+    }
+    if (type == TEST_TYPE_COUNT || testCount == MAX_TESTS) {
+      fprintf(stderr, "Unknown test %s, or too many tests.\n", name);
+      return FALSE;
+    }
+    tests[testCount].type = type;
+    tests[testCount].count = count;
+    testCount++;
+    mix += length;
+    if (*mix == ',') {
+      mix++;
+    }
+  }
+  return TRUE;
+}
+
+static void runTest(Test *test)
+{
+  AshCount startCount;
+  AshCount endCount;
+  int32u startUs = nowUs();
+  int32u startCpu = cpuUs();
+
+  readCounts(&startCount);
+  errorCount = 0;
+  switch (test->type) {
+  case TEST_NOP:
+    addLatency(&test->latency[0], EZSP_NOP, test->count);
+    test->latencyCount = 1;
+    runCommandTest(test, &test->latency[0]);
+    break;
+  case TEST_ECHO:
+    addLatency(&test->latency[0], EZSP_ECHO, test->count);
+    test->latencyCount = 1;
+    runCommandTest(test, &test->latency[0]);
+    break;
+  case TEST_ASYNC:
+    addLatency(&test->latency[0], EZSP_ECHO, test->count);
+    test->latencyCount = 1;
+    runAsyncTest(test, &test->latency[0]);
+    break;
+  case TEST_UNICAST:
+    addLatency(&test->latency[0], EZSP_SEND_UNICAST, test->count);
+    addLatency(&test->latency[1], EZSP_MESSAGE_SENT_HANDLER, test->count);
+    test->latencyCount = 2;
+    runUnicastTest(test, &test->latency[0]);
+    break;
+  case TEST_CALLBACKS:
+    test->latencyCount = 0;
+    runCallbackTest(test);
+    break;
+  default:
+    test->latencyCount = 0;
+    runFloodTest(test);
+    break;
+  }
+  test->elapsedUs = nowUs() - startUs;
+  test->cpuUs = cpuUs() - startCpu;
+  test->errors = errorCount;
+  readCounts(&endCount);
+  subtractCounts(&test->ash, &endCount, &startCount);
+}
+
+// Blocking commands, timed from just before the call to its return.
+static void runCommandTest(Test *test, Latency *latency)
+{
+  int8u data[EZSP_MAX_FRAME_LENGTH];
+  int8u echo[EZSP_MAX_FRAME_LENGTH];
+  int32u sent;
+  int32u i;
+
+  for (i = 0; i < payloadLength; i++) {
+    data[i] = (int8u)i;
+  }
+  for (i = 0; i < test->count && errorCount < MAX_ERRORS; i++) {
+    sent = nowUs();
+    if (test->type == TEST_NOP) {
+      ezspNop();
+    } else if (ezspEcho(payloadLength, data, echo) != payloadLength
+               || MEMCOMPARE(data, echo, payloadLength) != 0) {
+      errorCount++;
+      continue;
+    }
+    latency->samples[latency->count++] = nowUs() - sent;
+    test->completed++;
+    ezspTick();
+  }
+}
+
+// Echo commands pipelined up to EZSP_HOST_MAX_PENDING_COMMANDS deep. Each
+// command's context points to its sample, which holds the time it was sent
+// until the handler replaces that with the round trip time.
+static void runAsyncTest(Test *test, Latency *latency)
+{
+  int8u data[EZSP_MAX_FRAME_LENGTH];
+  int32u i;
+
+  for (i = 0; i < payloadLength; i++) {
+    data[i] = (int8u)i;
+  }
+  for (i = 0; i < test->count && errorCount < MAX_ERRORS; i++) {
+    ezspStartAsyncCommand(EZSP_ECHO);
+    appendInt8u(payloadLength);
+    appendInt8uArray(payloadLength, data);
+    latency->samples[i] = nowUs();
+    if (ezspSendAsyncCommand(asyncEchoHandler, &latency->samples[i])
+        != EZSP_SUCCESS) {
+      latency->samples[i] = FAILED_SAMPLE;
+      errorCount++;
+    }
+    ezspTick();
+  }
+  while (ezspPendingCommandCount() > 0) {
+    ezspTick();
+  }
+  // Keep only the samples of commands that completed.
+  latency->count = 0;
+  for (i = 0; i < test->count; i++) {
+    if (latency->samples[i] != FAILED_SAMPLE) {
+      latency->samples[latency->count++] = latency->samples[i];
+    }
+  }
+  test->completed = latency->count;
+}
+
+static void asyncEchoHandler(EzspStatus status, int8u frameId, void *context)
+{
+  int32u *sample = context;
+  int8u echo[EZSP_MAX_FRAME_LENGTH];
+  int8u length;
+  int8u i;
+
+  if (status == EZSP_SUCCESS && frameId == EZSP_ECHO) {
+    length = fetchInt8u();
+    fetchInt8uArray(length, echo);
+    for (i = 0; i < length && echo[i] == i; i++)
+      ;
+    if (length == payloadLength && i == length) {
+      *sample = nowUs() - *sample;
+      return;
+    }
+    errorCount++;
+  }
+  *sample = FAILED_SAMPLE;
+}
+
+// Unicasts in bursts of UNICAST_BURST. The sendUnicast latency is the
+// command's round trip; the messageSent latency runs from sending the
+// command to the callback for the same message tag.
+static void runUnicastTest(Test *test, Latency *latency)
+{
+  EmberApsFrame apsFrame;
+  int8u data[EZSP_MAX_FRAME_LENGTH];
+  int8u sequence;
+  int8u tag;
+  int32u expected = 0;
+  int32u sent;
+  int32u waitStart;
+  int32u i;
+
+  MEMSET(&apsFrame, 0, sizeof(apsFrame));
+  apsFrame.profileId = 0x0104;
+  apsFrame.clusterId = 0x0006;
+  apsFrame.sourceEndpoint = 1;
+  apsFrame.destinationEndpoint = 1;
+  apsFrame.options = EMBER_APS_OPTION_RETRY;
+  for (i = 0; i < payloadLength; i++) {
+    data[i] = (int8u)i;
+  }
+  messageSentCallbacks = 0;
+  messageSentLatency = latency + 1;
+  for (i = 0; i < test->count && errorCount < MAX_ERRORS; i++) {
+    tag = (int8u)i;
+    sent = nowUs();
+    unicastSentUs[tag] = sent;
+    if (ezspSendUnicast(EMBER_OUTGOING_DIRECT, unicastDestination, &apsFrame,
+                        tag, payloadLength, data, &sequence)
+        != EMBER_SUCCESS) {
+      errorCount++;
+      continue;
+    }
+    latency->samples[latency->count++] = nowUs() - sent;
+    test->completed++;
+    expected++;
+    ezspTick();
+    if (expected % UNICAST_BURST == 0 || i + 1 == test->count) {
+      waitStart = nowUs();
+      while (messageSentCallbacks < expected
+             && nowUs() - waitStart < RESPONSE_TIMEOUT_US) {
+        ezspTick();
+      }
+      expected = messageSentCallbacks;
+    }
+  }
+  messageSentLatency = NULL;
+}
+
+// Counts timer callbacks from a one millisecond repeating NCP timer.
+static void runCallbackTest(Test *test)
+{
+  int32u lastCallbackUs;
+  int32u lastCount = 0;
+
+  timerCallbacks = 0;
+  if (ezspSetTimer(CALLBACK_TIMER, 1, EMBER_EVENT_MS_TIME, TRUE)
+      != EMBER_SUCCESS) {
+    errorCount++;
+    return;
+  }
+  lastCallbackUs = nowUs();
+  while (timerCallbacks < test->count
+         && nowUs() - lastCallbackUs < RESPONSE_TIMEOUT_US) {
+    ezspTick();
+    if (timerCallbacks != lastCount) {
+      lastCount = timerCallbacks;
+      lastCallbackUs = nowUs();
+    }
+  }
+  test->completed = timerCallbacks;
+  ezspSetTimer(CALLBACK_TIMER, 0, EMBER_EVENT_MS_TIME, FALSE);
+}
+
+// Counts callbacks that were not asked for, which the NCP must be sending
+// already.
+static void runFloodTest(Test *test)
+{
+  int32u start = otherCallbacks + incomingMessageCallbacks;
+  int32u received = 0;
+  int32u lastCallbackUs = nowUs();
+  int32u lastCount = 0;
+
+  while (received < test->count
+         && nowUs() - lastCallbackUs < RESPONSE_TIMEOUT_US) {
+    ezspTick();
+    received = otherCallbacks + incomingMessageCallbacks - start;
+    if (received != lastCount) {
+      lastCount = received;
+      lastCallbackUs = nowUs();
+    }
+  }
+  test->completed = received;
+}
+
+//------------------------------------------------------------------------------
+// Results
+
+static void addLatency(Latency *latency, int8u frameId, int32u samples)
+{
+  latency->frameId = frameId;
+  latency->count = 0;
+  latency->size = samples;
+  latency->samples = malloc(samples * sizeof(int32u));
+  if (latency->samples == NULL) {
+    fprintf(stderr, "Out of memory.\n");
+    exit(1);
+  }
+}
+
+// Nearest rank percentile. The samples must already be sorted.
+static int32u percentile(Latency *latency, int32u perThousand)
+{
+  int32u rank = (latency->count * perThousand + 999) / 1000;
+  return latency->samples[rank == 0 ? 0 : rank - 1];
+}
+
+// With the I/O thread, ashCount belongs to that thread.
+static void readCounts(AshCount *counts)
+{
+#ifdef ASH_HOST_THREAD
+  ashThreadReadCounters(counts);
+#else
+  *counts = ashCount;
+#endif
+}
+
+static void subtractCounts(AshCount *result, AshCount *end, AshCount *start)
+{
+  int32u *r = (int32u *)result;
+  int32u *e = (int32u *)end;
+  int32u *s = (int32u *)start;
+  int8u i;
+
+  for (i = 0; i < sizeof(AshCount) / sizeof(int32u); i++) {
+    r[i] = e[i] - s[i];
+  }
+}
+
+static void writeJson(FILE *out, int32u totalUs)
+{
+  Test *test;
+  Latency *latency;
+  int8u i, j;
+
+  fprintf(out, "{\n");
+  fprintf(out, "  \"benchmark\": \"ezsp-benchmark\",\n");
+  fprintf(out, "  \"port\": \"%s\",\n", ashReadConfig(serialPort));
+  fprintf(out, "  \"baudRate\": %u,\n", ashReadConfig(baudRate));
+#ifdef ASH_HOST_THREAD
+  fprintf(out, "  \"ioThread\": true,\n");
+#else
+  fprintf(out, "  \"ioThread\": false,\n");
+#endif
+  fprintf(out, "  \"payloadLength\": %u,\n", payloadLength);
+  fprintf(out, "  \"callbackDelayUs\": %u,\n", callbackDelayUs);
+  fprintf(out, "  \"maxPendingCommands\": %u,\n",
+          EZSP_HOST_MAX_PENDING_COMMANDS);
+  fprintf(out, "  \"elapsedUs\": %u,\n", totalUs);
+  fprintf(out, "  \"tests\": [");
+  for (i = 0; i < testCount; i++) {
+    test = &tests[i];
+    fprintf(out, "%s\n    {\n", i == 0 ? "" : ",");
+    fprintf(out, "      \"test\": \"%s\",\n", testNames[test->type]);
+    fprintf(out, "      \"requested\": %u,\n", test->count);
+    fprintf(out, "      \"completed\": %u,\n", test->completed);
+    fprintf(out, "      \"errors\": %u,\n", test->errors);
+    fprintf(out, "      \"elapsedUs\": %u,\n", test->elapsedUs);
+    fprintf(out, "      \"perSecond\": %.1f,\n",
+            test->elapsedUs == 0
+            ? 0.0 : test->completed * 1e6 / test->elapsedUs);
+    fprintf(out, "      \"hostCpuUs\": %u,\n", test->cpuUs);
+    fprintf(out, "      \"ash\": {\"txDataFrames\": %u, \"rxDataFrames\": %u, "
+            "\"txRetransmits\": %u, \"rxRetransmits\": %u, "
+            "\"txNaks\": %u, \"rxNaks\": %u, \"rxErrors\": %u, "
+            "\"ackTimeouts\": %u},\n",
+            test->ash.txDataFrames, test->ash.rxDataFrames,
+            test->ash.txReDataFrames, test->ash.rxReDataFrames,
+            test->ash.txNakFrames, test->ash.rxNakFrames,
+            test->ash.rxCrcErrors + test->ash.rxCommErrors
+            + test->ash.rxTooShort + test->ash.rxTooLong
+            + test->ash.rxBadControl + test->ash.rxBadLength
+            + test->ash.rxBadAckNumber + test->ash.rxOutOfSequence,
+            test->ash.rxAckTimeouts);
+    fprintf(out, "      \"latencyUs\": [");
+    for (j = 0; j < test->latencyCount; j++) {
+      latency = &test->latency[j];
+      fprintf(out, "%s\n        {\"frameId\": %u, \"name\": \"%s\", "
+              "\"count\": %u",
+              j == 0 ? "" : ",", latency->frameId,
+              decodeFrameId(latency->frameId), latency->count);
+      if (latency->count != 0) {
+        qsort(latency->samples, latency->count, sizeof(int32u), compareInt32u);
+        fprintf(out, ", \"min\": %u, \"p50\": %u, \"p99\": %u, "
+                "\"p999\": %u, \"max\": %u",
+                latency->samples[0],
+                percentile(latency, 500),
+                percentile(latency, 990),
+                percentile(latency, 999),
+                latency->samples[latency->count - 1]);
+      }
+      fprintf(out, "}");
+      free(latency->samples);
+    }
+    fprintf(out, "%s]\n    }", test->latencyCount == 0 ? "" : "\n      ");
+  }
+  fprintf(out, "\n  ],\n");
+  fprintf(out, "  \"otherCallbacks\": %u\n", otherCallbacks);
+  fprintf(out, "}\n");
+}
+
+//------------------------------------------------------------------------------
+// Utility functions
+
+// Microseconds since the benchmark started.
+static int32u nowUs(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int32u)((now.tv_sec - startTime.tv_sec) * 1000000L
+                  + (now.tv_nsec - startTime.tv_nsec) / 1000);
+}
+
+// User plus system CPU time used by the host, in microseconds.
+static int32u cpuUs(void)
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (int32u)((usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L
+                  + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+// Stands in for the work a real application does in its callbacks.
+static void slowCallback(void)
+{
+  if (callbackDelayUs != 0) {
+    usleep(callbackDelayUs);
+  }
+}
+
+static int compareInt32u(const void *a, const void *b)
+{
+  int32u x = *(const int32u *)a;
+  int32u y = *(const int32u *)b;
+  return (x > y) - (x < y);
+}
+
+//------------------------------------------------------------------------------
+// EZSP callbacks
+
+void ezspErrorHandler(EzspStatus status)
+{
+  errorCount++;
+  fprintf(stderr, "\nEZSP error: %s (0x%02X).\n",
+          ashEzspErrorString(status), status);
+}
+
+void ezspTimerHandler(int8u timerId)
+{
+  slowCallback();
+  if (timerId == CALLBACK_TIMER) {
+    timerCallbacks++;
+  } else {
+    otherCallbacks++;
+  }
+}
+
+void ezspMessageSentHandler(
+      EmberOutgoingMessageType type,
+      int16u indexOrDestination,
+      EmberApsFrame *apsFrame,
+      int8u messageTag,
+      EmberStatus status,
+      int8u messageLength,
+      int8u *messageContents)
+{
+  slowCallback();
+  if (messageSentLatency == NULL
+      || messageSentLatency->count == messageSentLatency->size) {
+    otherCallbacks++;
+    return;
+  }
+  messageSentCallbacks++;
+  messageSentLatency->samples[messageSentLatency->count++] =
+    nowUs() - unicastSentUs[messageTag];
+  if (status != EMBER_SUCCESS) {
+    errorCount++;
+  }
+}
+
+void ezspIncomingMessageHandler(
+      EmberIncomingMessageType type,
+      EmberApsFrame *apsFrame,
+      int8u lastHopLqi,
+      int8s lastHopRssi,
+      EmberNodeId sender,
+      int8u bindingIndex,
+      int8u addressIndex,
+      int8u messageLength,
+      int8u *messageContents)
+{
+  int8u i;
+  slowCallback();
+  for (i = 0; i < messageLength; i++) {
+    incomingMessageSum += messageContents[i];
+  }
+  incomingMessageCallbacks++;
+}
+
+//------------------------------------------------------------------------------
+// EZSP callback function stubs
+
+void ezspStackStatusHandler(
+      EmberStatus status)
+{}
+
+void ezspNetworkFoundHandler(EmberZigbeeNetwork *networkFound,
+                             int8u lastHopLqi,
+                             int8s lastHopRssi)
+{}
+
+void ezspScanCompleteHandler(
+      int8u channel,
+      EmberStatus status)
+{}
+
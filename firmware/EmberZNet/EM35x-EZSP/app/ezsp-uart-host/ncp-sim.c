@@ -0,0 +1,1083 @@
+/** @file ncp-sim.c
+ *  @brief Simulated EZSP-UART network co-processor on a pseudo-terminal
+ *
+ * Runs the NCP side of the ASH protocol - RST/RSTACK, DATA frame
+ * sequencing, ACK/NAK, retransmission and the not-ready flag - using the
+ * same frame encoder and decoder as the host, and answers EZSP commands.
+ * Host programs connect to it as to a real NCP, using the pseudo-terminal
+ * name it prints as their serial port (for example, uart-test-2 -p
+ * /dev/pts/3). This allows host software to be tested and benchmarked
+ * without hardware.
+ *
+ * A small set of EZSP commands is built in: version, nop, echo, callback,
+ * setTimer (with timer callbacks), delayTest, readAndClearCounters,
+ * sendUnicast (with messageSent callbacks), and the configuration, policy
+ * and value commands. Any other command gets an
+ * EZSP_INVALID_COMMAND response unless a response for it is given in a
+ * script file (see -f). Each script line holds a frame ID followed by the
+ * response parameters, all in hex:
+ *
+ *   # frameID  parameters
+ *   28 00 01 00 00 00
+ *
+ * A line starting with "callback" instead gives a callback frame ID and
+ * parameters to use for random callbacks (see -c).
+ *
+ * The serial line can be made less than perfect by limiting the byte rate
+ * (-b), corrupting bytes in both directions (-e), and delaying responses
+ * (-l). Dropping echo responses (-d) tests how the host recovers when an
+ * NCP loses the response to one of several pipelined commands. Counters are
+ * printed on exit.
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.        *80*-->
+ */
+
+#define _GNU_SOURCE 1  // posix_openpt() and friends. Include before
+                       // PLATFORM_HEADER since that also includes stdlib.h
+
+#include PLATFORM_HEADER
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include "stack/include/ember-types.h"
+#include "stack/include/error.h"
+#include "hal/hal.h"
+#include "hal/micro/system-timer.h"
+#include "hal/micro/generic/ash-protocol.h"
+#include "hal/micro/generic/ash-common.h"
+#include "app/ezsp-uart-host/ash-host.h"
+
+//------------------------------------------------------------------------------
+// Preprocessor definitions
+
+#define ACK_TIMEOUT_MS      800   // resend unacknowledged frames after this
+#define MAX_TX_WINDOW       7     // most DATA frames sent without an ACK
+#define QUEUE_SIZE          32    // EZSP frames waiting to be sent (power of 2)
+#define OUT_BUFFER_SIZE     4096  // encoded bytes waiting to be written
+#define MAX_BURST_BYTES     64    // most bytes sent at once when rate limited
+#define MAX_POLL_MS         1000
+#define TIMER_COUNT         4     // EZSP timers, as on a real NCP
+#define MAX_SCRIPT_CALLBACKS 16
+#define VALUE_MAX_LENGTH    16
+
+#define EZSP_RESPONSE_FRAME_CONTROL(commandFrameControl)  \
+  (EZSP_FRAME_CONTROL_RESPONSE                            \
+   | ((commandFrameControl) & EZSP_FRAME_CONTROL_NETWORK_INDEX_MASK))
+
+//------------------------------------------------------------------------------
+// Types
+
+// An EZSP frame, and when it may be sent.
+typedef struct {
+  int32u due;
+  int8u len;
+  int8u data[ASH_MAX_DATA_FIELD_LEN];
+} SimFrame;
+
+typedef struct {
+  int16u head;
+  int16u count;
+  SimFrame frames[QUEUE_SIZE];
+} SimQueue;
+
+typedef struct {
+  boolean active;
+  boolean repeat;
+  int32u periodMs;
+  int32u due;
+} SimTimer;
+
+typedef struct {
+  boolean valid;
+  int8u len;
+  int8u data[ASH_MAX_DATA_FIELD_LEN];
+} ScriptResponse;
+
+typedef struct {
+  int32u rxBytes;
+  int32u txBytes;
+  int32u rxDataFrames;
+  int32u txDataFrames;
+  int32u rxAckFrames;
+  int32u rxNakFrames;
+  int32u txAckFrames;
+  int32u txNakFrames;
+  int32u rxDuplicates;
+  int32u rxErrors;
+  int32u txReDataFrames;
+  int32u ackTimeouts;
+  int32u resets;
+  int32u commands;
+  int32u unknownCommands;
+  int32u callbacks;
+  int32u droppedCallbacks;
+  int32u droppedResponses;
+  int32u corruptedBytes;
+} SimCount;
+
+//------------------------------------------------------------------------------
+// Global Variables
+
+// Needed by ash-common.c, though the simulator does not use its timers.
+AshHostConfig ashHostConfig;
+
+//------------------------------------------------------------------------------
+// Local Variables
+
+// Options
+static int32u baudRate = 0;           // 0 means no rate limit
+static int32u callbacksPerSecond = 0;
+static int32u corruptPpm = 0;         // corrupted bytes per million
+static int32u dropPpm = 0;            // dropped echo responses per million
+static int16u latencyMs = 0;
+static int8u txWindow = 3;
+static boolean randomize = TRUE;
+static int16u stackVersion = 0x4700;
+static int8u trace = 0;
+static int32u runSeconds = 0;         // 0 means until killed
+
+// Serial port
+static int ptyFd = -1;
+static int slaveFd = -1;
+static int8u outBuffer[OUT_BUFFER_SIZE];
+static int16u outHead;                // next byte to write
+static int16u outCount;
+static int32u txCredit;               // bytes * 1000 that may be sent now
+static int32u rxCredit;               // bytes * 1000 that may be read now
+static int32u lastCreditTime;
+static int32u rxHoldUntil;            // delayTest: don't read until then
+static boolean rxHold = FALSE;
+
+// ASH state
+static boolean connected = FALSE;
+static int8u frmTx;                   // next frame number to send
+static int8u ackRx;                   // oldest frame number not yet ACKed
+static int8u frmRx;                   // next frame number expected
+static boolean ackPending;            // an ACK must be sent
+static boolean rejecting;             // a NAK has been sent, awaiting resync
+static boolean hostNotReady;          // host's nFlag: hold back callbacks
+static int32u ackTimerStart;
+static SimFrame sentFrames[8];        // by frame number, for retransmission
+static int8u rxFrame[ASH_MAX_FRAME_LEN];
+static int8u rxLen;
+
+// EZSP state
+static SimQueue responseQueue;
+static SimQueue callbackQueue;
+static SimTimer timers[TIMER_COUNT];
+static int32u nextRandomCallback;
+static int16u configValues[256];
+static int8u values[256][VALUE_MAX_LENGTH + 1];  // length, then value
+static ScriptResponse script[256];
+static SimFrame scriptCallbacks[MAX_SCRIPT_CALLBACKS];
+static int8u scriptCallbackCount = 0;
+static int8u apsSequence;
+
+static SimCount simCount;
+static volatile sig_atomic_t done = FALSE;
+
+static const char usage[] =
+" [options]\n"
+"    -b <baud>         limit the byte rate in both directions to that of a\n"
+"                      serial line at this baud rate (default: no limit)\n"
+"    -c <rate>         send this many random callbacks per second\n"
+"    -d <ppm>          drop this many echo responses per million\n"
+"    -e <ppm>          corrupt this many bytes per million in each direction\n"
+"    -f <file>         read EZSP responses and callbacks from a script file\n"
+"    -h                print this message\n"
+"    -k <1-7>          most DATA frames sent before an ACK (default 3)\n"
+"    -l <msec>         delay EZSP responses by this many milliseconds\n"
+"    -n <seconds>      exit after this many seconds (default: run until killed)\n"
+"    -o <path>         also make the pseudo-terminal available as <path>\n"
+"    -s <version>      stack version returned by the version command (hex)\n"
+"    -t <0-2>          trace: 1 = ASH events, 2 = also every frame\n"
+"    -x 0,1            disable/enable data randomization (must match host)\n";
+
+//------------------------------------------------------------------------------
+// Forward Declarations
+
+static boolean processOptions(int argc, char *argv[], char **linkPath);
+static boolean readScript(const char *fileName);
+static boolean openPty(const char *linkPath);
+static void resetNcp(void);
+static void updateCredit(int32u now);
+static void readInput(int32u now);
+static void receiveFrame(EzspStatus status);
+static void receiveDataFrame(void);
+static void handleAckNumber(int8u ackNum, int32u now);
+static void processCommand(int8u *frame, int8u len);
+static void sendFrames(int32u now);
+static void sendDataFrame(int8u frameNum, boolean reTx);
+static void sendShortFrame(int8u control, int8u *data, int8u len);
+static void encodeFrame(int8u *frame, int8u len);
+static void writeOutput(void);
+static void serviceTimers(int32u now);
+static void queueCallback(const int8u *frame, int8u len, int32u due);
+static void queueResponse(const int8u *frame, int8u len, int32u due);
+static int32u pollTimeout(int32u now);
+static void printCounts(void);
+static void onSignal(int signal);
+static SimFrame *queueTail(SimQueue *queue);
+static SimFrame *queueHead(SimQueue *queue);
+static void queuePop(SimQueue *queue);
+
+//------------------------------------------------------------------------------
+// Functions
+
+int main( int argc, char *argv[] )
+{
+  char *linkPath = NULL;
+  struct pollfd fds;
+  int32u now;
+  int32u startTime;
+
+  if (!processOptions(argc, argv, &linkPath)) {
+    return 1;
+  }
+  if (!openPty(linkPath)) {
+    return 1;
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+  srand(1);
+  resetNcp();
+  connected = FALSE;
+  startTime = lastCreditTime = halCommonGetInt32uMillisecondTick();
+  nextRandomCallback = startTime;
+
+  while (!done) {
+    now = halCommonGetInt32uMillisecondTick();
+    if (runSeconds != 0 && now - startTime >= runSeconds * 1000) {
+      break;
+    }
+    updateCredit(now);
+    readInput(now);
+    serviceTimers(now);
+    sendFrames(now);
+    writeOutput();
+
+    fds.fd = ptyFd;
+    fds.events = (rxHold || (baudRate != 0 && rxCredit < 1000)) ? 0 : POLLIN;
+    if (outCount != 0 && (baudRate == 0 || txCredit >= 1000)) {
+      fds.events |= POLLOUT;
+    }
+    (void)poll(&fds, 1, pollTimeout(now));
+  }
+  printCounts();
+  if (linkPath != NULL) {
+    unlink(linkPath);
+  }
+  return 0;
+}
+
+static boolean processOptions(int argc, char *argv[], char **linkPath)
+{
+  int c;
+  unsigned int value;
+
+  while ((c = getopt(argc, argv, "b:c:d:e:f:hk:l:n:o:s:t:x:")) != -1) {
+    if (c != 'f' && c != 'o' && c != 'h' && c != 's'
+        && sscanf(optarg, "%u", &value) != 1) {
+      fprintf(stderr, "Invalid value %s for -%c.\n", optarg, c);
+      return FALSE;
+    }
+    switch (c) {
+    case 'b':
+      baudRate = value;
+      break;
+    case 'c':
+      callbacksPerSecond = value;
+      break;
+    case 'd':
+      dropPpm = value;
+      break;
+    case 'e':
+      corruptPpm = value;
+      break;
+    case 'f':
+      if (!readScript(optarg)) {
+        return FALSE;
+      }
+      break;
+    case 'k':
+      if (value < 1 || value > MAX_TX_WINDOW) {
+        fprintf(stderr, "Window must be from 1 to %d.\n", MAX_TX_WINDOW);
+        return FALSE;
+      }
+      txWindow = value;
+      break;
+    case 'l':
+      latencyMs = value;
+      break;
+    case 'n':
+      runSeconds = value;
+      break;
+    case 'o':
+      *linkPath = optarg;
+      break;
+    case 's':
+      if (sscanf(optarg, "%x", &value) != 1) {
+        fprintf(stderr, "Invalid stack version %s.\n", optarg);
+        return FALSE;
+      }
+      stackVersion = value;
+      break;
+    case 't':
+      trace = value;
+      break;
+    case 'x':
+      randomize = (value != 0);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s%s", argv[0], usage);
+      return FALSE;
+    }
+  }
+  if (optind != argc) {
+    fprintf(stderr, "Usage: %s%s", argv[0], usage);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+// Reads lines of hex bytes: a frame ID and response parameters, or the word
+// "callback" followed by a callback frame ID and parameters.
+static boolean readScript(const char *fileName)
+{
+  FILE *file = fopen(fileName, "r");
+  char line[512];
+  char *p;
+  char *end;
+  int8u bytes[ASH_MAX_DATA_FIELD_LEN];
+  int8u count;
+  int lineNumber = 0;
+  boolean isCallback;
+  unsigned long byte;
+
+  if (file == NULL) {
+    fprintf(stderr, "Cannot open script %s: %s\n", fileName, strerror(errno));
+    return FALSE;
+  }
+  while (fgets(line, sizeof(line), file) != NULL) {
+    lineNumber++;
+    p = line + strspn(line, " \t");
+    if (*p == '#' || *p == '\n' || *p == '\0') {
+      continue;
+    }
+    isCallback = (strncmp(p, "callback", 8) == 0);
+    if (isCallback) {
+      p += 8;
+    }
+    count = 0;
+    while (count < ASH_MAX_DATA_FIELD_LEN - EZSP_PARAMETERS_INDEX + 1) {
+      byte = strtoul(p, &end, 16);
+      if (end == p) {
+        break;
+      }
+      if (byte > 0xFF) {
+        count = 0;
+        break;
+      }
+      bytes[count++] = (int8u)byte;
+      p = end;
+    }
+    if (count == 0 || *(p + strspn(p, " \t\r\n")) != '\0') {
+      fprintf(stderr, "%s:%d: invalid line\n", fileName, lineNumber);
+      fclose(file);
+      return FALSE;
+    }
+    if (isCallback) {
+      if (scriptCallbackCount < MAX_SCRIPT_CALLBACKS) {
+        SimFrame *frame = &scriptCallbacks[scriptCallbackCount++];
+        frame->len = EZSP_PARAMETERS_INDEX + count - 1;
+        frame->data[EZSP_FRAME_ID_INDEX] = bytes[0];
+        MEMCOPY(frame->data + EZSP_PARAMETERS_INDEX, bytes + 1, count - 1);
+      }
+    } else {
+      script[bytes[0]].valid = TRUE;
+      script[bytes[0]].len = count - 1;
+      MEMCOPY(script[bytes[0]].data, bytes + 1, count - 1);
+    }
+  }
+  fclose(file);
+  return TRUE;
+}
+
+static boolean openPty(const char *linkPath)
+{
+  struct termios tios;
+  char *slaveName;
+
+  ptyFd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (ptyFd < 0 || grantpt(ptyFd) != 0 || unlockpt(ptyFd) != 0) {
+    fprintf(stderr, "Cannot create pseudo-terminal: %s\n", strerror(errno));
+    return FALSE;
+  }
+  slaveName = ptsname(ptyFd);
+  // Keep the slave open, so that reads do not fail while no host has it
+  // open, and make it raw until a host sets it up.
+  slaveFd = open(slaveName, O_RDWR | O_NOCTTY);
+  if (slaveFd < 0) {
+    fprintf(stderr, "Cannot open %s: %s\n", slaveName, strerror(errno));
+    return FALSE;
+  }
+  tcgetattr(slaveFd, &tios);
+  cfmakeraw(&tios);
+  tcsetattr(slaveFd, TCSANOW, &tios);
+  fcntl(ptyFd, F_SETFL, O_NONBLOCK);
+
+  if (linkPath != NULL) {
+    unlink(linkPath);
+    if (symlink(slaveName, linkPath) != 0) {
+      fprintf(stderr, "Cannot create %s: %s\n", linkPath, strerror(errno));
+      return FALSE;
+    }
+  }
+  printf("NCP simulator on %s\n", slaveName);
+  fflush(stdout);
+  return TRUE;
+}
+
+static void resetNcp(void)
+{
+  int8u i;
+
+  frmTx = ackRx = frmRx = 0;
+  ackPending = rejecting = hostNotReady = FALSE;
+  ackTimerStart = 0;
+  responseQueue.count = callbackQueue.count = 0;
+  for (i = 0; i < TIMER_COUNT; i++) {
+    timers[i].active = FALSE;
+  }
+  rxHold = FALSE;
+  connected = TRUE;
+}
+
+//------------------------------------------------------------------------------
+// Receiving
+
+// Line rate emulation: each direction may move baudRate/10 bytes a second.
+static void updateCredit(int32u now)
+{
+  int32u elapsed = now - lastCreditTime;
+  int32u limit = MAX_BURST_BYTES * 1000;
+
+  lastCreditTime = now;
+  if (baudRate == 0) {
+    return;
+  }
+  if (elapsed > 1000) {
+    elapsed = 1000;
+  }
+  txCredit += elapsed * (baudRate / 10);
+  rxCredit += elapsed * (baudRate / 10);
+  if (txCredit > limit) {
+    txCredit = limit;
+  }
+  if (rxCredit > limit) {
+    rxCredit = limit;
+  }
+}
+
+static boolean corruptByte(int8u *byte)
+{
+  if (corruptPpm != 0 && (int32u)(rand() % 1000000) < corruptPpm) {
+    *byte ^= (int8u)(1 << (rand() % 8));
+    simCount.corruptedBytes++;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+static void readInput(int32u now)
+{
+  int8u buffer[256];
+  int16u max = sizeof(buffer);
+  int16u i;
+  int count;
+  int8u out;
+  int8u index;
+  EzspStatus status;
+
+  if (rxHold) {
+    if ((int32s)(now - rxHoldUntil) < 0) {
+      return;
+    }
+    rxHold = FALSE;
+  }
+  if (baudRate != 0) {
+    if (rxCredit / 1000 < max) {
+      max = rxCredit / 1000;
+    }
+    if (max == 0) {
+      return;
+    }
+  }
+  count = read(ptyFd, buffer, max);
+  if (count <= 0) {
+    return;
+  }
+  simCount.rxBytes += count;
+  if (baudRate != 0) {
+    rxCredit -= count * 1000;
+  }
+  for (i = 0; i < count && !rxHold; i++) {
+    corruptByte(&buffer[i]);
+    if (!ashDecodeInProgress) {
+      rxLen = 0;
+    }
+    index = rxLen;
+    status = ashDecodeByte(buffer[i], &out, &rxLen);
+    if (rxLen != index) {
+      rxFrame[index] = out;
+    }
+    if (status != EZSP_ASH_IN_PROGRESS) {
+      receiveFrame(status);
+    }
+  }
+  // Any bytes after a delayTest command are left unread, as if the
+  // NCP were busy; they are lost here, so ask for them again.
+  if (i < count) {
+    rejecting = FALSE;
+    ashDecodeInProgress = FALSE;
+  }
+}
+
+static void receiveFrame(EzspStatus status)
+{
+  int8u control = rxFrame[0];
+  int32u now = halCommonGetInt32uMillisecondTick();
+
+  if (status != EZSP_SUCCESS) {
+    if (status == EZSP_ASH_CANCELLED) {
+      return;
+    }
+    simCount.rxErrors++;
+    if (trace) {
+      printf("rx error 0x%02X\n", status);
+    }
+    if (connected && !rejecting) {
+      rejecting = TRUE;
+      sendShortFrame(ASH_CONTROL_NAK | frmRx, NULL, 0);
+      simCount.txNakFrames++;
+    }
+    return;
+  }
+  if (trace > 1) {
+    printf("rx control 0x%02X len %d\n", control, rxLen);
+  }
+
+  if (control == ASH_CONTROL_RST && rxLen == ASH_FRAME_LEN_RST) {
+    int8u rstAck[2];
+    simCount.resets++;
+    resetNcp();
+    rstAck[0] = ASH_VERSION;
+    rstAck[1] = EM2XX_RESET_SOFTWARE;
+    outCount = 0;                     // the host discards anything pending
+    sendShortFrame(ASH_CONTROL_RSTACK, rstAck, sizeof(rstAck));
+    if (trace) {
+      printf("reset\n");
+    }
+  } else if (!connected) {
+    return;
+  } else if ((control & ASH_DFRAME_MASK) == ASH_CONTROL_DATA) {
+    if (rxLen < ASH_FRAME_LEN_DATA_MIN) {
+      simCount.rxErrors++;
+      return;
+    }
+    handleAckNumber(ASH_GET_ACKNUM(control), now);
+    receiveDataFrame();
+  } else if ((control & ASH_SHFRAME_MASK) == ASH_CONTROL_ACK) {
+    simCount.rxAckFrames++;
+    hostNotReady = (ASH_GET_NFLAG(control) != 0);
+    handleAckNumber(ASH_GET_ACKNUM(control), now);
+  } else if ((control & ASH_SHFRAME_MASK) == ASH_CONTROL_NAK) {
+    simCount.rxNakFrames++;
+    hostNotReady = (ASH_GET_NFLAG(control) != 0);
+    handleAckNumber(ASH_GET_ACKNUM(control), now);
+    // Go back N: resend everything the host has not acknowledged.
+    {
+      int8u frameNum;
+      for (frameNum = ackRx; frameNum != frmTx; frameNum = MOD8(frameNum + 1)) {
+        sendDataFrame(frameNum, TRUE);
+      }
+    }
+  }
+}
+
+static void receiveDataFrame(void)
+{
+  int8u control = rxFrame[0];
+  int8u frameNum = ASH_GET_FRMNUM(control);
+  int8u *data = rxFrame + 1;
+  int8u len = rxLen - 1;
+
+  if (frameNum == frmRx) {
+    simCount.rxDataFrames++;
+    rejecting = FALSE;
+    INC8(frmRx);
+    ackPending = TRUE;
+    if (randomize) {
+      (void)ashRandomizeArray(0, data, len);
+    }
+    processCommand(data, len);
+  } else if (ASH_GET_RFLAG(control)) {
+    // A retransmission of a frame already received: acknowledge it again.
+    simCount.rxDuplicates++;
+    ackPending = TRUE;
+  } else if (!rejecting) {
+    rejecting = TRUE;
+    sendShortFrame(ASH_CONTROL_NAK | frmRx, NULL, 0);
+    simCount.txNakFrames++;
+  }
+}
+
+static void handleAckNumber(int8u ackNum, int32u now)
+{
+  if (WITHIN_RANGE(ackRx, ackNum, frmTx) && ackNum != ackRx) {
+    ackRx = ackNum;
+    ackTimerStart = now;
+  }
+}
+
+//------------------------------------------------------------------------------
+// EZSP
+
+static void processCommand(int8u *frame, int8u len)
+{
+  int8u response[ASH_MAX_DATA_FIELD_LEN];
+  int8u *params = frame + EZSP_PARAMETERS_INDEX;
+  int8u *out = response + EZSP_PARAMETERS_INDEX;
+  int8u frameId = frame[EZSP_FRAME_ID_INDEX];
+  int32u now = halCommonGetInt32uMillisecondTick();
+  int32u due = now + latencyMs;
+  int16u delay;
+  int8u id;
+
+  simCount.commands++;
+  response[EZSP_SEQUENCE_INDEX] = frame[EZSP_SEQUENCE_INDEX];
+  response[EZSP_FRAME_CONTROL_INDEX] =
+    EZSP_RESPONSE_FRAME_CONTROL(frame[EZSP_FRAME_CONTROL_INDEX]);
+  response[EZSP_FRAME_ID_INDEX] = frameId;
+
+  if (script[frameId].valid) {
+    MEMCOPY(out, script[frameId].data, script[frameId].len);
+    out += script[frameId].len;
+  } else {
+    switch (frameId) {
+    case EZSP_VERSION:
+      *out++ = EZSP_PROTOCOL_VERSION;
+      *out++ = EZSP_STACK_TYPE_MESH;
+      *out++ = LOW_BYTE(stackVersion);
+      *out++ = HIGH_BYTE(stackVersion);
+      break;
+    case EZSP_NOP:
+      break;
+    case EZSP_ECHO:
+      if (len > EZSP_PARAMETERS_INDEX
+          && params[0] <= len - EZSP_PARAMETERS_INDEX - 1) {
+        MEMCOPY(out, params, params[0] + 1);
+        out += params[0] + 1;
+      } else {
+        *out++ = 0;
+      }
+      break;
+    case EZSP_CALLBACK:
+      // Callbacks are always sent asynchronously.
+      response[EZSP_FRAME_ID_INDEX] = EZSP_NO_CALLBACKS;
+      break;
+    case EZSP_SET_TIMER:
+      // timerId, time, units, repeat
+      id = params[0];
+      if (id < TIMER_COUNT) {
+        int32u time = HIGH_LOW_TO_INT(params[2], params[1]);
+        int32u unitMs = (params[3] == EMBER_EVENT_QS_TIME ? 250
+                         : params[3] == EMBER_EVENT_MINUTE_TIME ? 65536L
+                         : 1);
+        timers[id].periodMs = time * unitMs;
+        timers[id].repeat = params[4];
+        timers[id].active = (time != 0 && params[3] != EMBER_EVENT_INACTIVE);
+        timers[id].due = now + timers[id].periodMs;
+        *out++ = EMBER_SUCCESS;
+      } else {
+        *out++ = EMBER_BAD_ARGUMENT;
+      }
+      break;
+    case EZSP_DELAY_TEST:
+      // Stop reading commands for the time given, as a busy NCP would.
+      delay = HIGH_LOW_TO_INT(params[1], params[0]);
+      rxHold = TRUE;
+      rxHoldUntil = now + delay;
+      break;
+    case EZSP_READ_AND_CLEAR_COUNTERS:
+      MEMSET(out, 0, EMBER_COUNTER_TYPE_COUNT * 2);
+      out += EMBER_COUNTER_TYPE_COUNT * 2;
+      break;
+    case EZSP_GET_CONFIGURATION_VALUE:
+      *out++ = EZSP_SUCCESS;
+      *out++ = LOW_BYTE(configValues[params[0]]);
+      *out++ = HIGH_BYTE(configValues[params[0]]);
+      break;
+    case EZSP_SET_CONFIGURATION_VALUE:
+      configValues[params[0]] = HIGH_LOW_TO_INT(params[2], params[1]);
+      *out++ = EZSP_SUCCESS;
+      break;
+    case EZSP_SET_POLICY:
+      *out++ = EZSP_SUCCESS;
+      break;
+    case EZSP_GET_VALUE:
+      *out++ = EZSP_SUCCESS;
+      MEMCOPY(out, values[params[0]], values[params[0]][0] + 1);
+      out += values[params[0]][0] + 1;
+      break;
+    case EZSP_SET_VALUE:
+      if (params[1] <= VALUE_MAX_LENGTH) {
+        MEMCOPY(values[params[0]], params + 1, params[1] + 1);
+        *out++ = EZSP_SUCCESS;
+      } else {
+        *out++ = EZSP_ERROR_INVALID_VALUE;
+      }
+      break;
+    case EZSP_SEND_UNICAST:
+      // type, destination, APS frame, tag, length, contents. The message is
+      // delivered at once: messageSentHandler follows the response.
+      if (len < EZSP_PARAMETERS_INDEX + 16
+          || params[15] > len - EZSP_PARAMETERS_INDEX - 16) {
+        *out++ = EMBER_BAD_ARGUMENT;
+        *out++ = 0;
+      } else if (len + 1 > ASH_MAX_DATA_FIELD_LEN) {
+        *out++ = EMBER_MESSAGE_TOO_LONG;
+        *out++ = 0;
+      } else {
+        int8u callback[ASH_MAX_DATA_FIELD_LEN];
+        int8u *callbackParams = callback + EZSP_PARAMETERS_INDEX;
+        params[13] = apsSequence;
+        callback[EZSP_FRAME_ID_INDEX] = EZSP_MESSAGE_SENT_HANDLER;
+        MEMCOPY(callbackParams, params, 15);
+        callbackParams[15] = EMBER_SUCCESS;
+        MEMCOPY(callbackParams + 16, params + 15, params[15] + 1);
+        queueCallback(callback, len + 1, due);
+        *out++ = EMBER_SUCCESS;
+        *out++ = apsSequence++;
+      }
+      break;
+    default:
+      simCount.unknownCommands++;
+      response[EZSP_FRAME_ID_INDEX] = EZSP_INVALID_COMMAND;
+      *out++ = EZSP_ERROR_INVALID_FRAME_ID;
+      break;
+    }
+  }
+  queueResponse(response, out - response, due);
+}
+
+static void serviceTimers(int32u now)
+{
+  int8u callback[EZSP_PARAMETERS_INDEX + 1];
+  int8u i;
+  int32u count;
+
+  if (!connected) {
+    return;
+  }
+  for (i = 0; i < TIMER_COUNT; i++) {
+    if (timers[i].active && (int32s)(now - timers[i].due) >= 0) {
+      callback[EZSP_FRAME_ID_INDEX] = EZSP_TIMER_HANDLER;
+      callback[EZSP_PARAMETERS_INDEX] = i;
+      queueCallback(callback, sizeof(callback), now);
+      if (timers[i].repeat && timers[i].periodMs != 0) {
+        timers[i].due += timers[i].periodMs;
+        if ((int32s)(now - timers[i].due) >= 0) {
+          timers[i].due = now + timers[i].periodMs;   // fell behind
+        }
+      } else {
+        timers[i].active = FALSE;
+      }
+    }
+  }
+  if (callbacksPerSecond != 0 && (int32s)(now - nextRandomCallback) >= 0) {
+    if (callbacksPerSecond < 1000) {
+      // Random intervals averaging 1/callbacksPerSecond
+      count = 1;
+      nextRandomCallback = now + rand() % (2000 / callbacksPerSecond + 1);
+    } else {
+      // Several each millisecond, rounded up or down at random
+      count = (callbacksPerSecond / 1000
+               + ((int32u)(rand() % 1000) < callbacksPerSecond % 1000));
+      nextRandomCallback = now + 1;
+    }
+    for (; count > 0; count--) {
+      if (scriptCallbackCount != 0) {
+        SimFrame *frame = &scriptCallbacks[rand() % scriptCallbackCount];
+        queueCallback(frame->data, frame->len, now);
+      } else {
+        callback[EZSP_FRAME_ID_INDEX] = EZSP_TIMER_HANDLER;
+        callback[EZSP_PARAMETERS_INDEX] = TIMER_COUNT;  // not a real timer
+        queueCallback(callback, sizeof(callback), now);
+      }
+    }
+  }
+}
+
+static void queueCallback(const int8u *frame, int8u len, int32u due)
+{
+  SimFrame *callback = queueTail(&callbackQueue);
+  if (callback == NULL) {
+    simCount.droppedCallbacks++;      // like an NCP out of buffers
+    return;
+  }
+  MEMCOPY(callback->data, frame, len);
+  callback->data[EZSP_SEQUENCE_INDEX] = 0;
+  callback->data[EZSP_FRAME_CONTROL_INDEX] =
+    EZSP_FRAME_CONTROL_RESPONSE | EZSP_FRAME_CONTROL_ASYNCH_CB;
+  callback->len = len;
+  callback->due = due;
+  callbackQueue.count++;
+  simCount.callbacks++;
+}
+
+static void queueResponse(const int8u *frame, int8u len, int32u due)
+{
+  SimFrame *response;
+  if (dropPpm != 0
+      && frame[EZSP_FRAME_ID_INDEX] == EZSP_ECHO
+      && (int32u)(rand() % 1000000) < dropPpm) {
+    simCount.droppedResponses++;
+    return;
+  }
+  response = queueTail(&responseQueue);
+  if (response == NULL) {
+    return;                           // the host sent too many commands
+  }
+  MEMCOPY(response->data, frame, len);
+  response->len = len;
+  response->due = due;
+  responseQueue.count++;
+}
+
+//------------------------------------------------------------------------------
+// Sending
+
+static void sendFrames(int32u now)
+{
+  SimFrame *frame;
+  SimQueue *queue;
+
+  if (!connected) {
+    return;
+  }
+  // Go back N if the host has not acknowledged frames in time.
+  if (ackRx != frmTx && (int32s)(now - ackTimerStart) >= ACK_TIMEOUT_MS) {
+    int8u frameNum;
+    simCount.ackTimeouts++;
+    for (frameNum = ackRx; frameNum != frmTx; frameNum = MOD8(frameNum + 1)) {
+      sendDataFrame(frameNum, TRUE);
+    }
+    ackTimerStart = now;
+  }
+  while (MOD8(frmTx - ackRx) < txWindow) {
+    frame = queueHead(&responseQueue);
+    queue = &responseQueue;
+    if (frame == NULL || (int32s)(now - frame->due) < 0) {
+      frame = hostNotReady ? NULL : queueHead(&callbackQueue);
+      queue = &callbackQueue;
+    }
+    if (frame == NULL || (int32s)(now - frame->due) < 0) {
+      break;
+    }
+    if (ackRx == frmTx) {
+      ackTimerStart = now;
+    }
+    sentFrames[frmTx] = *frame;
+    if (randomize) {
+      (void)ashRandomizeArray(0, sentFrames[frmTx].data, frame->len);
+    }
+    queuePop(queue);
+    sendDataFrame(frmTx, FALSE);
+    INC8(frmTx);
+  }
+  if (ackPending) {
+    sendShortFrame(ASH_CONTROL_ACK | frmRx, NULL, 0);
+    simCount.txAckFrames++;
+  }
+}
+
+static void sendDataFrame(int8u frameNum, boolean reTx)
+{
+  int8u frame[ASH_MAX_FRAME_LEN];
+  SimFrame *sent = &sentFrames[frameNum];
+
+  frame[0] = (frameNum << ASH_FRMNUM_BIT)
+             | (reTx ? ASH_RFLAG_MASK : 0)
+             | frmRx;
+  MEMCOPY(frame + 1, sent->data, sent->len);
+  encodeFrame(frame, sent->len + 1);
+  ackPending = FALSE;
+  simCount.txDataFrames++;
+  if (reTx) {
+    simCount.txReDataFrames++;
+  }
+  if (trace > 1 || (trace && reTx)) {
+    printf("tx DATA %d%s ack %d\n", frameNum, reTx ? " (retx)" : "", frmRx);
+  }
+}
+
+static void sendShortFrame(int8u control, int8u *data, int8u len)
+{
+  int8u frame[ASH_FRAME_LEN_RSTACK];
+
+  frame[0] = control;
+  if (len != 0) {
+    MEMCOPY(frame + 1, data, len);
+  }
+  encodeFrame(frame, len + 1);
+  if ((control & ASH_SHFRAME_MASK) == ASH_CONTROL_ACK) {
+    ackPending = FALSE;
+  }
+  if (trace > 1) {
+    printf("tx control 0x%02X\n", control);
+  }
+}
+
+static void encodeFrame(int8u *frame, int8u len)
+{
+  int8u offset = 0;
+  int8u byte;
+  int16u index;
+
+  if (outCount > OUT_BUFFER_SIZE - 2 * ASH_MAX_FRAME_WITH_CRC_LEN - 1) {
+    return;                           // host is not reading: drop the frame
+  }
+  byte = ashEncodeByte(len, frame[0], &offset);
+  while (TRUE) {
+    corruptByte(&byte);
+    index = (outHead + outCount) % OUT_BUFFER_SIZE;
+    outBuffer[index] = byte;
+    outCount++;
+    if (offset == 0xFF) {
+      break;
+    }
+    byte = ashEncodeByte(0, frame[offset], &offset);
+  }
+}
+
+static void writeOutput(void)
+{
+  int16u max = outCount;
+  int count;
+
+  if (baudRate != 0 && max > txCredit / 1000) {
+    max = txCredit / 1000;
+  }
+  if (max > OUT_BUFFER_SIZE - outHead) {
+    max = OUT_BUFFER_SIZE - outHead;
+  }
+  if (max == 0) {
+    return;
+  }
+  count = write(ptyFd, outBuffer + outHead, max);
+  if (count > 0) {
+    simCount.txBytes += count;
+    outHead = (outHead + count) % OUT_BUFFER_SIZE;
+    outCount -= count;
+    if (baudRate != 0) {
+      txCredit -= count * 1000;
+    }
+  }
+}
+
+// Returns how long the main loop can sleep before it has something to do.
+static int32u pollTimeout(int32u now)
+{
+  int32u timeout = MAX_POLL_MS;
+  SimFrame *frame;
+  int8u i;
+
+#define EARLIER(time)                                             \
+  do {                                                            \
+    int32s delta = (int32s)((time) - now);                        \
+    if (delta < 0) { delta = 0; }                                 \
+    if ((int32u)delta < timeout) { timeout = (int32u)delta; }     \
+  } while (0)
+
+  if (baudRate != 0 && (outCount != 0 || rxCredit < 1000)) {
+    timeout = 1;                      // waiting for line rate credit
+  }
+  if (rxHold) {
+    EARLIER(rxHoldUntil);
+  }
+  if (ackRx != frmTx) {
+    EARLIER(ackTimerStart + ACK_TIMEOUT_MS);
+  }
+  frame = queueHead(&responseQueue);
+  if (frame != NULL && MOD8(frmTx - ackRx) < txWindow) {
+    EARLIER(frame->due);
+  }
+  for (i = 0; i < TIMER_COUNT; i++) {
+    if (timers[i].active) {
+      EARLIER(timers[i].due);
+    }
+  }
+  if (callbacksPerSecond != 0) {
+    EARLIER(nextRandomCallback);
+  }
+  return timeout;
+}
+
+//------------------------------------------------------------------------------
+// Utility functions
+
+static SimFrame *queueTail(SimQueue *queue)
+{
+  if (queue->count == QUEUE_SIZE) {
+    return NULL;
+  }
+  return &queue->frames[(queue->head + queue->count) & (QUEUE_SIZE - 1)];
+}
+
+static SimFrame *queueHead(SimQueue *queue)
+{
+  return (queue->count == 0) ? NULL : &queue->frames[queue->head];
+}
+
+static void queuePop(SimQueue *queue)
+{
+  queue->head = (queue->head + 1) & (QUEUE_SIZE - 1);
+  queue->count--;
+}
+
+static void onSignal(int signal)
+{
+  done = TRUE;
+}
+
+static void printCounts(void)
+{
+  printf("NCP simulator counts  Received  Transmitted\n");
+  printf("Total bytes         %10u  %10u\n", simCount.rxBytes, simCount.txBytes);
+  printf("DATA frames         %10u  %10u\n",
+         simCount.rxDataFrames, simCount.txDataFrames);
+  printf("ACK frames          %10u  %10u\n",
+         simCount.rxAckFrames, simCount.txAckFrames);
+  printf("NAK frames          %10u  %10u\n",
+         simCount.rxNakFrames, simCount.txNakFrames);
+  printf("Retransmitted       %10u  %10u\n",
+         simCount.rxDuplicates, simCount.txReDataFrames);
+  printf("Frame errors        %10u\n", simCount.rxErrors);
+  printf("ACK timeouts        %10u\n", simCount.ackTimeouts);
+  printf("Resets              %10u\n", simCount.resets);
+  printf("EZSP commands       %10u (%u unknown)\n",
+         simCount.commands, simCount.unknownCommands);
+  printf("Callbacks           %10u\n", simCount.callbacks);
+  printf("Dropped callbacks   %10u\n", simCount.droppedCallbacks);
+  printf("Dropped responses   %10u\n", simCount.droppedResponses);
+  printf("Corrupted bytes     %10u\n", simCount.corruptedBytes);
+  fflush(stdout);
+}
@@ -16,6 +16,8 @@
 
 #if !defined(EZSP_HOST)
   #include "stack/include/cbke-crypto-engine.h"  // emberGetCertificate()
+#else
+  #include "app/util/ezsp/ezsp-stats.h"
 #endif
 
 #include "app/framework/cli/core-cli.h"
@@ -359,6 +361,42 @@ static EmberCommandEntry endpointCommands[] = {
   emberCommandEntryTerminator(),
 };
 
+#if defined(EZSP_HOST)
+//------------------------------------------------------------------------------
+// "ezsp-stats" commands
+
+#define EZSP_STATS_FILE_NAME_LENGTH 64
+
+static void ezspStatsPrintCommand(void)
+{
+  ezspStatsPrint(stdout);
+}
+
+static void ezspStatsLogCommand(void)
+{
+  int32u seconds = emberUnsignedCommandArgument(0);
+  int8u fileName[EZSP_STATS_FILE_NAME_LENGTH + 1];
+  int8u length = emberCopyStringArgument(1,
+                                         fileName,
+                                         EZSP_STATS_FILE_NAME_LENGTH,
+                                         FALSE);
+  fileName[length] = '\0';
+  if (!ezspStatsLogToFile((char *)fileName, seconds * 1000)) {
+    emberAfCorePrintln("Error:  Cannot open %p", fileName);
+  }
+}
+
+static EmberCommandEntry ezspStatsCommands[] = {
+  emberCommandEntryAction("print", ezspStatsPrintCommand, "",
+                          "Print EZSP latencies, callbacks and ASH queue depths."),
+  emberCommandEntryAction("clear", ezspStatsClear, "",
+                          "Clear the EZSP statistics."),
+  emberCommandEntryAction("log", ezspStatsLogCommand, "wb",
+                          "Append the statistics to a file every n seconds (0 stops)."),
+  emberCommandEntryTerminator(),
+};
+#endif
+
 //------------------------------------------------------------------------------
 // Commands
 
@@ -413,6 +451,10 @@ EmberCommandEntry emberCommandTable[] = {
                           "Print the list of timer events."),
   emberCommandEntrySubMenu("endpoint", endpointCommands,
                            "Commands to manipulate the endpoints."),
+#if defined(EZSP_HOST)
+  emberCommandEntrySubMenu("ezsp-stats", ezspStatsCommands,
+                           "Commands for the EZSP and ASH statistics."),
+#endif
   
 #ifndef EMBER_AF_CLI_DISABLE_INFO
   emberCommandEntryAction("info", emAfCliInfoCommand, "", \
@@ -212,7 +212,7 @@ static void optionBindingTablePrintCommand(void)
 
   emberAfAppPrintln("#  type   nwk  loc   rem   clus   eui");
   for (i = 0; i < emberAfGetBindingTableSize(); i++) {
-    EmberStatus status = emberGetBinding(i, &result);
+    EmberStatus status = emberAfGetBinding(i, &result);
     if (status == EMBER_SUCCESS) {
       if (result.type > EMBER_MULTICAST_BINDING) {
         result.type = 4;  // last entry in the string list above
@@ -238,13 +238,23 @@ static void optionBindingTablePrintCommand(void)
   emberAfAppPrintln("%d of %d bindings used",
                     bindings,
                     emberAfGetBindingTableSize());
+#ifdef EZSP_HOST
+  {
+    const EmberAfBindingCacheCounts *counts = emAfGetBindingCacheCounts();
+    emberAfAppPrintln("host copy: %l reads (EZSP calls saved), "
+                      "%l NCP reads, %l updates",
+                      counts->hostReads,
+                      counts->ezspReads,
+                      counts->updates);
+  }
+#endif
 #endif //defined(EMBER_AF_PRINT_ENABLE) && defined(EMBER_AF_PRINT_APP)
 }
 
 // option binding-table clear
 static void optionBindingTableClearCommand(void)
 {
-  emberClearBindingTable();
+  emberAfClearBindingTable();
 }
 
 // option address-table print
@@ -398,7 +408,7 @@ static void optionBindingTableSetCommand(void)
     entry.local = endpoint;
     entry.remote = (int8u)emberUnsignedCommandArgument(3);
     emberAfCopyBigEndianEui64Argument(4, entry.identifier);
-    status = emberSetBinding(index, &entry);
+    status = emberAfSetBinding(index, &entry);
     emberAfPopNetworkIndex();
   }
   emberAfAppPrintln("set bind %d: 0x%x", index, status);
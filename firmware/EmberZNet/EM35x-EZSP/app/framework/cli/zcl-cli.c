@@ -1325,7 +1325,7 @@ void emAfCliBsendCommand(void)
 
   // find a binding to send on
   for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
-    status = emberGetBinding(i, &candidate);
+    status = emberAfGetBinding(i, &candidate);
 
     // if we can read the binding, it is unicast, the endpoint is the
     // one we want (or we have no preference) and the cluster matches
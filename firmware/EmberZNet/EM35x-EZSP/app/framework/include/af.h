@@ -710,6 +710,36 @@ EmberPanId emberAfGetPanId(void);
  */
 int8u emberAfGetBindingIndex(void);
 
+#if defined(DOXYGEN_SHOULD_SKIP_THIS) || defined(EZSP_HOST)
+/**
+ * @brief Copies a binding table entry.  On the host this reads a copy of the
+ * NCP's binding table, without an EZSP command.  Framework code and plugins
+ * should use these functions rather than the stack's binding functions, so
+ * that the copy stays up to date.
+ */
+EmberStatus emberAfGetBinding(int8u index, EmberBindingTableEntry *result);
+
+/**
+ * @brief Sets a binding table entry.
+ */
+EmberStatus emberAfSetBinding(int8u index, EmberBindingTableEntry *value);
+
+/**
+ * @brief Deletes a binding table entry.
+ */
+EmberStatus emberAfDeleteBinding(int8u index);
+
+/**
+ * @brief Deletes all binding table entries.
+ */
+EmberStatus emberAfClearBindingTable(void);
+#else
+  #define emberAfGetBinding(index, result) emberGetBinding((index), (result))
+  #define emberAfSetBinding(index, value) emberSetBinding((index), (value))
+  #define emberAfDeleteBinding(index) emberDeleteBinding(index)
+  #define emberAfClearBindingTable() emberClearBindingTable()
+#endif
+
 /*
  * @brief Returns an address index that matches the current incoming message,
  * if known.
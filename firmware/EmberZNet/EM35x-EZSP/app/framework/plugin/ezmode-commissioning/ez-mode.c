@@ -146,7 +146,7 @@ static void createBinding(int8u *address) {
   // first look for a duplicate binding, we should not add duplicates
   for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++)
   {
-     status = emberGetBinding(i, &candidate);
+     status = emberAfGetBinding(i, &candidate);
 
      if ((status == EMBER_SUCCESS)
            && (candidate.type == EMBER_UNICAST_BINDING)
@@ -164,14 +164,14 @@ static void createBinding(int8u *address) {
    }
 	
    for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
-     if (emberGetBinding(i, &candidate) == EMBER_SUCCESS
+     if (emberAfGetBinding(i, &candidate) == EMBER_SUCCESS
          && candidate.type == EMBER_UNUSED_BINDING) {
        candidate.type = EMBER_UNICAST_BINDING;
        candidate.local = ezmodeClientEndpoint;
        candidate.remote = currentIdentifyingEndpoint;
        candidate.clusterId = ezmodeClientCluster;
        MEMCOPY(candidate.identifier, address, EUI64_SIZE);
-       status = emberSetBinding(i, &candidate);
+       status = emberAfSetBinding(i, &candidate);
        if (status == EMBER_SUCCESS) {
          ezModeState = EZMODE_BOUND;
          emberEventControlSetActive(stateEvent);
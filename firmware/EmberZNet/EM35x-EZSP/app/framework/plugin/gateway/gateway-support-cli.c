@@ -0,0 +1,42 @@
+// *****************************************************************************
+// * gateway-support-cli.c
+// *
+// * CLI interface to show how often the gateway wakes up and why.
+// *
+// * Copyright 2012 by Ember Corporation. All rights reserved.              *80*
+// *****************************************************************************
+
+#include "app/framework/include/af.h"
+#include "app/util/serial/command-interpreter2.h"
+#include "app/framework/plugin/gateway/gateway-support.h"
+
+// *****************************************************************************
+// Forward Declarations
+
+static void wakeupsCommand(void);
+
+// *****************************************************************************
+// Globals
+
+EmberCommandEntry emberAfPluginGatewayCommands[] = {
+  emberCommandEntryAction("wakeups", wakeupsCommand, "",
+                          "Prints how often the gateway has woken up and why"),
+  emberCommandEntryTerminator(),
+};
+
+// *****************************************************************************
+// Functions
+
+static void wakeupsCommand(void)
+{
+  const GatewayWakeupCounts *counts = gatewayGetWakeupCounts();
+  int32u seconds = counts->elapsedMs / 1000;
+
+  emberAfCorePrintln("Waits:             %l in %l s (%l per second)",
+                     counts->waits,
+                     seconds,
+                     (seconds > 0 ? counts->waits / seconds : 0));
+  emberAfCorePrintln("Input wakeups:     %l", counts->fdWakeups);
+  emberAfCorePrintln("Timeout wakeups:   %l", counts->timerWakeups);
+  emberAfCorePrintln("epoll_ctl() calls: %l", counts->fdRegistrations);
+}
@@ -16,26 +16,51 @@
 #include "app/ezsp-uart-host/ash-host.h"
 #include "app/ezsp-uart-host/ash-host-io.h"
 #include "app/ezsp-uart-host/ash-host-ui.h"
+#ifdef ASH_HOST_THREAD
+  #include "hal/micro/generic/ash-protocol.h"
+  #include "app/ezsp-uart-host/ash-host-thread.h"
+#endif
 
 #include "app/util/serial/command-interpreter2.h"
 #include "app/util/serial/linux-serial.h"
 #include "app/framework/plugin/gateway/gateway-support.h"
 
-#include <sys/time.h>   // for select()
-#include <sys/types.h>  // ""
-#include <unistd.h>     // ""
-#include <errno.h>      // ""
+#include <sys/epoll.h>   // for epoll_wait()
+#include <sys/timerfd.h> // for timerfd_settime()
+#include <sys/types.h>
+#include <unistd.h>
+#include <errno.h>
 
 //------------------------------------------------------------------------------
 // Globals
 
-// This defines how long select() will wait for data.  0 = wait forever.
-// Because ASH needs to check for timeout in messages sends, we
-// must periodically wakeup.  Timeouts are rare but could occur.
+// While EZSP commands are waiting for responses we must wake up
+// periodically, because the EZSP layer only notices a lost response when it
+// is polled.  ASH tells us exactly when its own timers expire.
 #define READ_TIMEOUT_MS  100
+// Even when idle we wake up this often, so that anything the main loop polls
+// rather than waits for still runs.
+#define IDLE_TIMEOUT_MS  1000
 #define MAX_FDS 10
 #define INVALID_FD -1
 
+// The epoll set holds the watched file descriptors and a timerfd for the
+// deadline, so each wait is a single epoll_wait() call.
+static int epollFd = INVALID_FD;
+static int timerFd = INVALID_FD;
+static int watchedFds[MAX_FDS];
+// Set when a watched descriptor may have been closed since the last wait.
+// Its number can be reused straight away by the next open(), and epoll drops
+// a closed descriptor from the set, so the registrations must be redone even
+// though getFdsToWatch() reports the same number.
+static boolean watchedFdClosed = FALSE;
+// Index in watchedFds of the first descriptor added by the application with
+// emberAfPluginGatewaySelectFileDescriptorsCallback().
+static int firstApplicationFd;
+
+static GatewayWakeupCounts wakeupCounts;
+static int32u wakeupCountsStartMs;
+
 static const char* debugLabel = "gateway-debug";
 static const boolean debugOn = FALSE;
 
@@ -48,6 +73,8 @@ static const char cliPrompt[] = ZA_PROMPT;
 // Forward Declarations
 
 static void getFdsToWatch(int* list, int maxSize);
+static void watchFds(void);
+static void applicationFdReady(int fd);
 static void debugPrint(const char* formatString, ...);
 
 //------------------------------------------------------------------------------
@@ -91,6 +118,8 @@ boolean emberAfMainStartCallback(int* returnCode,
     return 1;
   }
 
+  ashSetSerialCloseHandler(&gatewayWatchedFdClosed);
+
   *returnCode = gatewayBackchannelStart();
   if (*returnCode != EMBER_SUCCESS) {
     return TRUE;
@@ -106,82 +135,97 @@ boolean emberAfMainStartCallback(int* returnCode,
 
 // Rather than looping like a simple em250 application we can actually
 // do the proper thing here, which is wait for EZSP or CLI events to fire.
-// This is done via our good friend select().  As a warning, the select() call
-// may not work in certain scenarios (I'm looking at you Cygwin) and thus one
-// will have to fall back to polling loops.
+// This is done with epoll: the file descriptors are registered once, and the
+// deadline is a timerfd in the same epoll set.  A timeout of 0 only checks
+// for input without waiting.
 
 static void gatewayWaitForEventsWithTimeout(int32u timeoutMs)
 {
-  static boolean debugPrintedOnce = FALSE;
+  static boolean firstRun = TRUE;
+  struct epoll_event events[MAX_FDS + 1];
+  struct itimerspec deadline;
+#ifndef ASH_HOST_THREAD
+  int16u ashTimeoutMs;
+#endif
+  int64u expirations;
   int fdsWithData;
-  int fdsToWatch[MAX_FDS];
-  fd_set readSet;
-  int highestFd = 0;
+  boolean timerExpired = FALSE;
   int i;
 
-  timeoutMs = (timeoutMs < READ_TIMEOUT_MS
-               ? timeoutMs
-               : READ_TIMEOUT_MS);
-
-  if (timeoutMs == 0) {
-    // Prevent waiting forever (see select() call below).  
-    // This causes problems due to synchronization between the parent and child processes.
-    timeoutMs = READ_TIMEOUT_MS;
-  }
-
-  struct timeval timeoutStruct = { 
-    0,                      // seconds
-    timeoutMs * 1000        // micro seconds
-  };
-
-  static boolean firstRun = TRUE;
   if (firstRun) {
     firstRun = FALSE;
     debugPrint("gatewayWaitForEvents() first run, not waiting for data.");
     return;
   }
 
-  FD_ZERO(&readSet);
-  getFdsToWatch(fdsToWatch, MAX_FDS);
-
-  for (i = 0; i < MAX_FDS; i++) {
-    if (fdsToWatch[i] != INVALID_FD) {
-      if (!debugPrintedOnce) {
-        debugPrint("Watching FD %d for data.", fdsToWatch[i]);
-        debugPrint("Current Highest FD: %d", highestFd);
-      }
-      FD_SET(fdsToWatch[i], &readSet);
-      if (fdsToWatch[i] > highestFd) {
-        highestFd = fdsToWatch[i];
-      }
+  if (epollFd == INVALID_FD) {
+    epollFd = epoll_create(MAX_FDS + 1);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (epollFd < 0 || timerFd < 0) {
+      fprintf(stderr, "FATAL: could not create epoll set: %s\n",
+              strerror(errno));
+      assert(FALSE);
     }
+    MEMSET(&events[0], 0, sizeof(events[0]));
+    events[0].events = EPOLLIN;
+    events[0].data.fd = timerFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &events[0]);
+    MEMSET(watchedFds, 0xFF, sizeof(watchedFds));
+    wakeupCountsStartMs = halCommonGetInt32uMillisecondTick();
+  }
+  watchFds();
+
+#ifndef ASH_HOST_THREAD
+  // Wake in time to service the ASH timers (the I/O thread does this itself).
+  ashTimeoutMs = ashMsToNextTimeout();
+  if (timeoutMs > ashTimeoutMs) {
+    timeoutMs = ashTimeoutMs;
+  }
+#endif
+  if (timeoutMs > READ_TIMEOUT_MS && ezspPendingCommandCount() > 0) {
+    timeoutMs = READ_TIMEOUT_MS;
   }
-  if (!debugPrintedOnce) {
-    debugPrint("Highest FD: %d", highestFd);
+  if (timeoutMs > IDLE_TIMEOUT_MS) {
+    timeoutMs = IDLE_TIMEOUT_MS;
   }
-  debugPrintedOnce = TRUE;
 
-  //  debugPrint("calling select(): %d", timeoutMs);
-  fdsWithData = select(highestFd + 1,           // per select() manpage
-                       &readSet,                // read FDs
-                       NULL,                    // write FDs
-                       NULL,                    // exception FDs
-                       (timeoutMs > 0           // passing NULL means wait 
-                        ? &timeoutStruct        //   forever
-                        : NULL));
+  if (timeoutMs == 0) {
+    fdsWithData = epoll_wait(epollFd, events, MAX_FDS + 1, 0);
+  } else {
+    MEMSET(&deadline, 0, sizeof(deadline));
+    deadline.it_value.tv_sec = timeoutMs / 1000;
+    deadline.it_value.tv_nsec = (timeoutMs % 1000) * 1000000L;
+    timerfd_settime(timerFd, 0, &deadline, NULL);
+    do {
+      fdsWithData = epoll_wait(epollFd, events, MAX_FDS + 1, -1);
+    } while (fdsWithData < 0 && errno == EINTR);
+    wakeupCounts.waits++;
+  }
   if (fdsWithData < 0) {
-    fprintf(stderr, "FATAL: select() returned error: %s\n",
+    fprintf(stderr, "FATAL: epoll_wait() returned error: %s\n",
             strerror(errno));
     for (i = 0; i < MAX_FDS; i++) {
-      if (fdsToWatch[i] != INVALID_FD) {
-        debugPrint("Was Watching FD %d for data.", fdsToWatch[i]);
+      if (watchedFds[i] != INVALID_FD) {
+        debugPrint("Was Watching FD %d for data.", watchedFds[i]);
       }
     }
-    debugPrint("Highest FD: %d", highestFd);
     assert(FALSE);
   }
 
-  if (fdsWithData != 0) {
+  for (i = 0; i < fdsWithData; i++) {
+    if (events[i].data.fd == timerFd) {
+      // Reading clears the expiration so the timerfd stops being readable.
+      if (read(timerFd, &expirations, sizeof(expirations)) > 0) {
+        timerExpired = TRUE;
+      }
+    } else {
+      applicationFdReady(events[i].data.fd);
+    }
+  }
+  if (timerExpired && fdsWithData == 1) {
+    wakeupCounts.timerWakeups++;
+  } else if (fdsWithData != 0) {
+    wakeupCounts.fdWakeups++;
     debugPrint("data is ready to read");
   }
 }
@@ -193,14 +237,83 @@ int32u emberAfCheckForSleepCallback(void)
   return elapsedTimeInt32u(start, halCommonGetInt32uMillisecondTick());
 }
 
+// Registers the file descriptors to watch with the epoll set.  A descriptor
+// is registered once and stays in the set until getFdsToWatch() reports a
+// different one in its place.  All of them are registered again after
+// gatewayWatchedFdClosed(), since one that was closed and reopened under the
+// same number has silently dropped out of the set.
+static void watchFds(void)
+{
+  int fdsToWatch[MAX_FDS];
+  struct epoll_event event;
+  boolean rewatchAll = watchedFdClosed;
+  int i;
+
+  watchedFdClosed = FALSE;
+  getFdsToWatch(fdsToWatch, MAX_FDS);
+  for (i = 0; i < MAX_FDS; i++) {
+    if (fdsToWatch[i] == watchedFds[i] && !rewatchAll) {
+      continue;
+    }
+    if (watchedFds[i] != INVALID_FD) {
+      // This fails harmlessly if the old descriptor has been closed.
+      epoll_ctl(epollFd, EPOLL_CTL_DEL, watchedFds[i], NULL);
+      wakeupCounts.fdRegistrations++;
+    }
+    watchedFds[i] = fdsToWatch[i];
+    if (watchedFds[i] != INVALID_FD) {
+      MEMSET(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.fd = watchedFds[i];
+      wakeupCounts.fdRegistrations++;
+      if (epoll_ctl(epollFd, EPOLL_CTL_ADD, watchedFds[i], &event) == 0) {
+        debugPrint("Watching FD %d for data.", watchedFds[i]);
+      } else {
+        debugPrint("Could not watch FD %d: %s", watchedFds[i], strerror(errno));
+      }
+    }
+  }
+}
+
+void gatewayWatchedFdClosed(int fd)
+{
+  debugPrint("FD %d closed.", fd);
+  watchedFdClosed = TRUE;
+}
+
+// Tells the application that one of the descriptors it asked the gateway to
+// watch is readable.  The gateway's own descriptors are read by the main loop.
+static void applicationFdReady(int fd)
+{
+  int i;
+  for (i = firstApplicationFd; i < MAX_FDS; i++) {
+    if (watchedFds[i] == fd) {
+      emberAfPluginGatewayFileDescriptorReadyCallback(fd);
+      return;
+    }
+  }
+}
+
+const GatewayWakeupCounts *gatewayGetWakeupCounts(void)
+{
+  wakeupCounts.elapsedMs =
+    elapsedTimeInt32u(wakeupCountsStartMs, halCommonGetInt32uMillisecondTick());
+  return &wakeupCounts;
+}
+
 static void getFdsToWatch(int* list, int maxSize)
 {
   int i = 0;
   MEMSET(list, 0xFF, sizeof(int) * maxSize);
   list[i++] = emberSerialGetInputFd(0);
   list[i++] = emberSerialGetInputFd(1);
+#ifdef ASH_HOST_THREAD
+  list[i++] = ashThreadGetFd();
+#else
   list[i++] = ashSerialGetFd();
+#endif
 
+  firstApplicationFd = i;
   i += emberAfPluginGatewaySelectFileDescriptorsCallback(&(list[i]),
                                                          maxSize - i);
 
@@ -2,6 +2,22 @@
 
 void gatewayBackchannelStop(void);
 
+// Counts of the times the gateway has waited for input or a timeout in
+// emberAfCheckForSleepCallback(), and what woke it up.
+typedef struct {
+  int32u waits;
+  int32u fdWakeups;         // input arrived on a watched file descriptor
+  int32u timerWakeups;      // the timeout expired
+  int32u fdRegistrations;   // epoll_ctl() calls to add or remove descriptors
+  int32u elapsedMs;         // time since the first wait
+} GatewayWakeupCounts;
+
+const GatewayWakeupCounts *gatewayGetWakeupCounts(void);
+
+// Called when a file descriptor the gateway may be watching is closed, so
+// that the next wait registers the watched descriptors again.
+void gatewayWatchedFdClosed(int fd);
+
 
 typedef int8u BackchannelState;
 
@@ -21,7 +21,7 @@ static void print(void)
   int8u i;
   for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
     EmberBindingTableEntry entry;
-    emberGetBinding(i, &entry);
+    emberAfGetBinding(i, &entry);
     if (entry.type == EMBER_MULTICAST_BINDING) {
       emberAfCorePrintln("ep[%x] id[%2x]", entry.local, 
                          HIGH_LOW_TO_INT(entry.identifier[1], entry.identifier[0]));
@@ -53,7 +53,7 @@ static EmberAfStatus addEntryToGroupTable(int8u endpoint, int16u groupId, int8u
   // Look for an empty binding slot.
   for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
     EmberBindingTableEntry binding;
-    if (emberGetBinding(i, &binding) == EMBER_SUCCESS
+    if (emberAfGetBinding(i, &binding) == EMBER_SUCCESS
         && binding.type == EMBER_UNUSED_BINDING) {
       EmberStatus status;
       binding.type = EMBER_MULTICAST_BINDING;
@@ -61,7 +61,7 @@ static EmberAfStatus addEntryToGroupTable(int8u endpoint, int16u groupId, int8u
       binding.identifier[1] = HIGH_BYTE(groupId);
       binding.local = endpoint;
 
-      status = emberSetBinding(i, &binding);
+      status = emberAfSetBinding(i, &binding);
       if (status == EMBER_SUCCESS) {
         // Set the group name, if supported
         emberAfPluginGroupsServerSetGroupNameCallback(endpoint,
@@ -82,7 +82,7 @@ static EmberAfStatus removeEntryFromGroupTable(int8u endpoint, int16u groupId)
 {
   if(isGroupPresent(endpoint, groupId)) {
     int8u bindingIndex = findGroupIndex(endpoint, groupId);
-    EmberStatus status = emberDeleteBinding(bindingIndex);
+    EmberStatus status = emberAfDeleteBinding(bindingIndex);
     if (status == EMBER_SUCCESS) {
       int8u groupName[ZCL_GROUPS_CLUSTER_MAXIMUM_NAME_LENGTH + 1] = {0};
       emberAfPluginGroupsServerSetGroupNameCallback(endpoint,
@@ -180,7 +180,7 @@ boolean emberAfGroupsClusterGetGroupMembershipCallback(int8u groupCount,
   if (groupCount == 0) {
     for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
       EmberBindingTableEntry entry;
-      emberGetBinding(i, &entry);
+      emberAfGetBinding(i, &entry);
       if (entry.type == EMBER_MULTICAST_BINDING) {
         if (entry.local == emberAfCurrentEndpoint()) {
           list[listLen]     = entry.identifier[0];
@@ -195,7 +195,7 @@ boolean emberAfGroupsClusterGetGroupMembershipCallback(int8u groupCount,
       int16u groupId = emberAfGetInt16u(groupList + (i << 1), 0, 2);
       for (j = 0; j < EMBER_BINDING_TABLE_SIZE; j++) {
         EmberBindingTableEntry entry;
-        emberGetBinding(j, &entry);
+        emberAfGetBinding(j, &entry);
         if (entry.type == EMBER_MULTICAST_BINDING) {
           if (entry.local == emberAfCurrentEndpoint()
               && entry.identifier[0] == LOW_BYTE(groupId)
@@ -263,10 +263,10 @@ boolean emberAfGroupsClusterRemoveAllGroupsCallback(void)
 
   for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
     EmberBindingTableEntry binding;
-    if(emberGetBinding(i, &binding) == EMBER_SUCCESS) {
+    if(emberAfGetBinding(i, &binding) == EMBER_SUCCESS) {
       if (binding.type == EMBER_MULTICAST_BINDING
           && endpoint == binding.local) {
-        EmberStatus status = emberDeleteBinding(i);
+        EmberStatus status = emberAfDeleteBinding(i);
         if (status != EMBER_SUCCESS) {
           success = FALSE;
           emberAfGroupsClusterPrintln("ERR: Failed to delete binding (0x%x)",
@@ -326,12 +326,12 @@ void emberAfGroupsClusterClearGroupTableCallback(int8u endpoint)
   int8u i, networkIndex = emberGetCurrentNetwork();
   for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
     EmberBindingTableEntry binding;
-    if (emberGetBinding(i, &binding) == EMBER_SUCCESS
+    if (emberAfGetBinding(i, &binding) == EMBER_SUCCESS
         && binding.type == EMBER_MULTICAST_BINDING
         && (endpoint == binding.local
             || (endpoint == EMBER_BROADCAST_ENDPOINT
                 && networkIndex == binding.networkIndex))) {
-      EmberStatus status = emberDeleteBinding(i);
+      EmberStatus status = emberAfDeleteBinding(i);
       if (status != EMBER_SUCCESS) {
         emberAfGroupsClusterPrintln("ERR: Failed to delete binding (0x%x)",
                                     status);
@@ -346,7 +346,7 @@ static boolean isGroupPresent(int8u endpoint, int16u groupId)
 
   for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
     EmberBindingTableEntry binding;
-    if (emberGetBinding(i, &binding) == EMBER_SUCCESS) {
+    if (emberAfGetBinding(i, &binding) == EMBER_SUCCESS) {
       if (bindingGroupMatch(endpoint, groupId, &binding)) {
         return TRUE;
       }
@@ -371,7 +371,7 @@ static int8u findGroupIndex(int8u endpoint, int16u groupId)
   int8u i;
   for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
     EmberBindingTableEntry entry;
-    emberGetBinding(i, &entry);
+    emberAfGetBinding(i, &entry);
     if(bindingGroupMatch(endpoint, groupId, &entry)) {
       return i;
     }
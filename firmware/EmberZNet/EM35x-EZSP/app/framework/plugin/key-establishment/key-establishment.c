@@ -42,6 +42,13 @@ typedef int8u KeyEstablishMessage;
 // These are initialized by the init routine.
 static KeyEstablishEvent lastEvent;
 
+// GENERATE_KEYS or GENERATE_SHARED_SECRET when the crypto operation for that
+// event is waiting for another one to complete.
+static KeyEstablishEvent deferredCryptoEvent;
+
+// How often the client cluster tick checks whether the crypto engine is free.
+#define CRYPTO_RETRY_DELAY_MS 250
+
 typedef struct {
   EmberEUI64 eui64;
   EmberPanId panId;
@@ -211,6 +218,7 @@ static void setupEventTimeouts(int8u theirGenerateKeyTimeSeconds,
 static EmberStatus calculateSmacs(boolean amInitiator,
                                   EmberCertificateData *partnerCert,
                                   EmberPublicKeyData *partnerEphemeralPublicKey);
+static boolean startCryptoOperation(KeyEstablishEvent event);
 static boolean commandReceivedHandler(EmberAfClusterCommand *cmd);
 static void messageSentHandler(EmberOutgoingMessageType type,
                                int16u indexOrDestination,
@@ -474,11 +482,10 @@ static void keyEstablishStateMachine(KeyEstablishEvent newEvent,
                                    (!partner.isInitiator
                                     ? data2              // partner cert
                                     : data1))            // partner key
-        || emberGenerateCbkeKeys() != EMBER_OPERATION_IN_PROGRESS) {
+        || !startCryptoOperation(GENERATE_KEYS)) {
       cleanupAndStop(NO_LOCAL_RESOURCES);
       return;
     }
-    emAfSetCryptoOperationInProgress();
     break;
 
   // For both roles, we are done generating keys.  Send the message.
@@ -493,37 +500,23 @@ static void keyEstablishStateMachine(KeyEstablishEvent newEvent,
   // For initiator, we received ephemeral data resp.  Generate shared secret.
   // For responder, we received confirm key request.  Generate shared secret.
   case GENERATE_SHARED_SECRET:
-    {
-      EmberCertificateData partnerCert;
-      EmberPublicKeyData partnerEphemeralPublicKey;
-
 #if defined(EMBER_AF_PRINT_ENABLE) && defined(EMBER_AF_PRINT_KEY_ESTABLISHMENT_CLUSTER)
-      if (!partner.isInitiator) {
-        debugPrintKey(FALSE, data1);
-      } else {
-        debugPrintOtherSmac(TRUE, data1);
-      }
+    if (!partner.isInitiator) {
+      debugPrintKey(FALSE, data1);
+    } else {
+      debugPrintOtherSmac(TRUE, data1);
+    }
 #endif
 
-      // For the initiator this is slightly ineffecient because we store
-      // the public key but then immediately retrieve it.  However it
-      // saves on flash to treat responder and initiator the same.
-      if (!askApplication(GENERATING_SHARED_SECRET)
-          || (!partner.isInitiator
-              ? !storePublicPartnerData(FALSE, data1)
-              : !storeSmac((EmberSmacData *)data1))
-          || !retrieveAndClearPublicPartnerData(&partnerCert,
-                                                &partnerEphemeralPublicKey)
-          || (EMBER_OPERATION_IN_PROGRESS
-              != calculateSmacs(!partner.isInitiator,
-                                &partnerCert,
-                                &partnerEphemeralPublicKey))) {
-        cleanupAndStop(NO_LOCAL_RESOURCES);
-        return;
-      }
-      emAfSetCryptoOperationInProgress();
-      break;
+    if (!askApplication(GENERATING_SHARED_SECRET)
+        || (!partner.isInitiator
+            ? !storePublicPartnerData(FALSE, data1)
+            : !storeSmac((EmberSmacData *)data1))
+        || !startCryptoOperation(GENERATE_SHARED_SECRET)) {
+      cleanupAndStop(NO_LOCAL_RESOURCES);
+      return;
     }
+    break;
 
   // For both roles, we are done generating shared secret,
   //   send confirm key message.
@@ -600,11 +593,15 @@ static void clearKeyEstablishmentState(void)
 {
   partner.isInitiator = TRUE;
   lastEvent = NO_KEY_ESTABLISHMENT_EVENT;
+  deferredCryptoEvent = NO_KEY_ESTABLISHMENT_EVENT;
   clearAllTemporaryPublicData();
   emberClearTemporaryDataMaybeStoreLinkKey(FALSE);
   emberAfDeactivateClusterTick(keyEstablishmentEndpoint,
                                ZCL_KEY_ESTABLISHMENT_CLUSTER_ID,
                                EMBER_AF_SERVER_CLUSTER_TICK);
+  emberAfDeactivateClusterTick(keyEstablishmentEndpoint,
+                               ZCL_KEY_ESTABLISHMENT_CLUSTER_ID,
+                               EMBER_AF_CLIENT_CLUSTER_TICK);
 
   // NOTE: When clearing the state, we intentionally retain information about
   // the partner (e.g., node id, APS sequence numbers, etc.).  That information
@@ -878,6 +875,50 @@ static EmberStatus calculateSmacs(boolean amInitiator,
                              partnerEphemeralPublicKey);
 }
 
+// Only one crypto operation can run at a time.  If another one (for example,
+// an image signature verification) is in progress, ours is started from the
+// client cluster tick once that completes.  The timeout for the event keeps
+// running meanwhile.
+static boolean startCryptoOperation(KeyEstablishEvent event)
+{
+  if (emAfIsCryptoOperationInProgress()) {
+    if (deferredCryptoEvent == NO_KEY_ESTABLISHMENT_EVENT) {
+      emberAfKeyEstablishmentClusterPrintln("Waiting for crypto operation in progress");
+    }
+    deferredCryptoEvent = event;
+    return (EMBER_SUCCESS
+            == emberAfScheduleClusterTick(keyEstablishmentEndpoint,
+                                          ZCL_KEY_ESTABLISHMENT_CLUSTER_ID,
+                                          EMBER_AF_CLIENT_CLUSTER_TICK,
+                                          CRYPTO_RETRY_DELAY_MS,
+                                          EMBER_AF_OK_TO_NAP));
+  }
+  deferredCryptoEvent = NO_KEY_ESTABLISHMENT_EVENT;
+
+  if (event == GENERATE_KEYS) {
+    if (emberGenerateCbkeKeys() != EMBER_OPERATION_IN_PROGRESS) {
+      return FALSE;
+    }
+  } else {
+    EmberCertificateData partnerCert;
+    EmberPublicKeyData partnerEphemeralPublicKey;
+
+    // For the initiator this is slightly ineffecient because we store
+    // the public key but then immediately retrieve it.  However it
+    // saves on flash to treat responder and initiator the same.
+    if (!retrieveAndClearPublicPartnerData(&partnerCert,
+                                           &partnerEphemeralPublicKey)
+        || (EMBER_OPERATION_IN_PROGRESS
+            != calculateSmacs(!partner.isInitiator,
+                              &partnerCert,
+                              &partnerEphemeralPublicKey))) {
+      return FALSE;
+    }
+  }
+  emAfSetCryptoOperationInProgress();
+  return TRUE;
+}
+
 static boolean commandReceivedHandler(EmberAfClusterCommand *cmd)
 {
   EmberAfStatus status = (cmd->direction == ZCL_DIRECTION_CLIENT_TO_SERVER
@@ -1141,6 +1182,14 @@ void emberAfKeyEstablishmentClusterServerTickCallback(int8u endpoint)
   cleanupAndStop(TIMEOUT_OCCURRED);
 }
 
+void emberAfKeyEstablishmentClusterClientTickCallback(int8u endpoint)
+{
+  if (deferredCryptoEvent != NO_KEY_ESTABLISHMENT_EVENT
+      && !startCryptoOperation(deferredCryptoEvent)) {
+    cleanupAndStop(NO_LOCAL_RESOURCES);
+  }
+}
+
 boolean emberAfKeyEstablishmentClusterServerCommandReceivedCallback(EmberAfClusterCommand *cmd)
 {
   return commandReceivedHandler(cmd);
@@ -1297,6 +1346,11 @@ void emAfPluginKeyEstablishmentGenerateCbkeKeysHandler(EmberStatus status,
                                          status);
   emAfCryptoOperationComplete();
 
+  // Key establishment may have timed out while the keys were generated.
+  if (lastEvent == NO_KEY_ESTABLISHMENT_EVENT) {
+    return;
+  }
+
   if (status != EMBER_SUCCESS) {
     cleanupAndStop(NO_LOCAL_RESOURCES);
     return;
@@ -1320,6 +1374,12 @@ void emAfPluginKeyEstablishmentCalculateSmacsHandler(EmberStatus status,
   emberAfKeyEstablishmentClusterPrintln("CalculateSmacsHandler() returned: 0x%x",
                                          status);
   emAfCryptoOperationComplete();
+
+  // Key establishment may have timed out while the SMACs were calculated.
+  if (lastEvent == NO_KEY_ESTABLISHMENT_EVENT) {
+    return;
+  }
+
   debugPrintSmac(TRUE,  emberSmacContents(initiatorSmacReturn));
   debugPrintSmac(FALSE, emberSmacContents(responderSmacReturn));
 
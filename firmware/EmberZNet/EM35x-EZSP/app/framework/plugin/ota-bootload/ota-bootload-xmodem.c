@@ -55,7 +55,6 @@ static int8u blockNum;
 
 static boolean sendBlock(int8u blockNum, const int8u *data)
 {
-  int i;
   int retry = 5;
   int16u crc = 0;
   int8u status = NAK;
@@ -64,10 +63,8 @@ static boolean sendBlock(int8u blockNum, const int8u *data)
   fullBlock[CONTROL_OFFSET] = SOH;
   fullBlock[BLOCK_NUM_OFFSET] = blockNum;
   fullBlock[BLOCK_COMP_OFFSET] = ~blockNum;
-  for(i=0; i<DATA_SIZE; i++) {
-    crc = halCommonCrc16(data[i],crc);
-    fullBlock[DATA_OFFSET + i] = data[i];
-  }
+  crc = halCommonCrc16Block(data, DATA_SIZE, crc);
+  MEMCOPY(fullBlock + DATA_OFFSET, data, DATA_SIZE);
   fullBlock[CRC_H_OFFSET] = HIGH_BYTE(crc);
   fullBlock[CRC_L_OFFSET] = LOW_BYTE(crc);
   
@@ -67,6 +67,9 @@ static const int8u PGM_NO_CONST allowedSignerEuiBigEndian[MAX_SIGNERS][EUI64_SIZ
 // based apps.
 static EmberAesMmoHashContext context;
 static int32u currentOffset = 0;
+// Set once the digest is in context.result, so that it is not finalized
+// again while the DSA verify waits for the crypto engine.
+static boolean digestComplete = FALSE;
 
 typedef enum {
   DIGEST_CALCULATE_COMPLETE    = 0,
@@ -146,6 +149,7 @@ EmberAfImageVerifyStatus emAfOtaImageSignatureVerify(int16u maxHashCalculations,
   if (newVerification) {
     otaPrintln("Client Verifying Signature.");
     currentOffset = 0;
+    digestComplete = FALSE;
   }
 
   if (EMBER_LIBRARY_PRESENT_MASK 
@@ -252,6 +256,13 @@ EmberAfImageVerifyStatus emAfOtaImageSignatureVerify(int16u maxHashCalculations,
   } // Else, DIGEST_CALCULATE_COMPLETE
     //   Fall through
 
+  // The DSA verify would fail while another crypto operation is running.
+  // The digest is kept, and the verify is started when the caller tries
+  // again.
+  if (emAfIsCryptoOperationInProgress()) {
+    return EMBER_AF_IMAGE_VERIFY_IN_PROGRESS;
+  }
+
   if (EMBER_OPERATION_IN_PROGRESS
       == emberDsaVerify(&digest,
                         &signerCert,
@@ -286,6 +297,13 @@ static DigestCalculateStatus calculateDigest(int16u maxHashCalculations,
     return DIGEST_CALCULATE_ERROR;
   }
 
+  if (digestComplete) {
+    MEMCOPY(digest->contents,
+            context.result,
+            EMBER_AES_HASH_BLOCK_SIZE);
+    return DIGEST_CALCULATE_COMPLETE;
+  }
+
   dataLeftToRead = imageSize - EMBER_SIGNATURE_SIZE - currentOffset;
   if (currentOffset == 0) {
     otaPrintln("Starting new digest calculation");
@@ -349,6 +367,7 @@ static DigestCalculateStatus calculateDigest(int16u maxHashCalculations,
     return DIGEST_CALCULATE_ERROR;
   }
   currentOffset += remainder;
+  digestComplete = TRUE;
   debugDigestPrint(&context);
 
   emAfPrintPercentageUpdate("Digest Calculate", 
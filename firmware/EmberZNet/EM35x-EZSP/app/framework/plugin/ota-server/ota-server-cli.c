@@ -47,6 +47,18 @@
  *        <b>plugin ota-server upgrade</b>
  *        - <i></i>
  *
+ *        <b>plugin ota-server downloads</b>
+ *        - <i>Prints the downloads the server is tracking, with the
+ *             throughput and estimated time to completion of each.</i>
+ *
+ *        <b>plugin ota-server rate-limit &lt;total&gt; &lt;per client&gt;</b>
+ *        - <i>Sets the maximum number of image blocks per second the server
+ *             sends.  Clients asking for more are told to wait for data.</i>
+ *          - <i>total - int16u. The limit for all clients together
+ *               (0 = no limit).</i>
+ *          - <i>per client - int16u. The limit for each client
+ *               (0 = no limit).</i>
+ *
  *        <b>plugin ota-server policy print</b>
  *        - <i>Prints the polices used by the ota-server Policy Plugin.</I>
  *
@@ -94,6 +106,7 @@
 // Globals
 
 static void setPolicy(void);
+static void setRateLimits(void);
 
 #if defined(EMBER_AF_PLUGIN_OTA_SERVER_POLICY)
 
@@ -145,6 +158,10 @@ static const PGM_P notifyArguments[] = {
                                      "Send a notification about a new OTA image", \
                                      notifyArguments),                  \
   emberCommandEntryAction("upgrade",     otaSendUpgradeCommand, "vu", "" ),  \
+  emberCommandEntryAction("downloads",   emAfOtaServerPrintDownloads, "", \
+                          "Print the downloads in progress"),     \
+  emberCommandEntryAction("rate-limit",  setRateLimits, "vv",    \
+                          "Set the total and per client image blocks per second"), \
   LOAD_FILE_COMMAND \
 POLICY_COMMANDS \
 emberCommandEntryTerminator(),
@@ -214,6 +231,13 @@ static void setPolicy(void)
 }
 #endif
 
+// plugin ota-server rate-limit <total blocks/s> <blocks/s per client>
+static void setRateLimits(void)
+{
+  emAfOtaServerSetDownloadRateLimits((int16u)emberUnsignedCommandArgument(0),
+                                     (int16u)emberUnsignedCommandArgument(1));
+}
+
 void otaSendUpgradeCommand(void)
 {
   EmberNodeId dest = (EmberNodeId)emberUnsignedCommandArgument(0);
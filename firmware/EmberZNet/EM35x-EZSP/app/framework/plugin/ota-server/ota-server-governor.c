@@ -0,0 +1,334 @@
+// *******************************************************************
+// * ota-server-governor.c
+// *
+// * Zigbee Over-the-air bootload cluster for upgrading firmware and
+// * downloading specific file.
+// *
+// * This keeps track of the downloads in progress and holds the
+// * image blocks served to all clients, and to each one of them, to
+// * a configurable number per second.  A client that asks for more
+// * is told to wait for data.
+// *
+// * Copyright 2010 by Ember Corporation. All rights reserved.              *80*
+// *******************************************************************
+
+#include "app/framework/include/af.h"
+#include "callback.h"
+#include "app/framework/plugin/ota-common/ota.h"
+#include "app/framework/plugin/ota-storage-common/ota-storage.h"
+#include "ota-server.h"
+#include "app/framework/util/util.h"
+#include "app/framework/util/common.h"
+
+// Applications generated before these options existed track the default
+// number of downloads from plugin.properties and do not limit the block rate.
+#ifndef EMBER_AF_PLUGIN_OTA_SERVER_DOWNLOAD_CLIENTS
+  #define EMBER_AF_PLUGIN_OTA_SERVER_DOWNLOAD_CLIENTS 8
+#endif
+#ifndef EMBER_AF_PLUGIN_OTA_SERVER_BLOCKS_PER_SECOND
+  #define EMBER_AF_PLUGIN_OTA_SERVER_BLOCKS_PER_SECOND 0
+#endif
+#ifndef EMBER_AF_PLUGIN_OTA_SERVER_CLIENT_BLOCKS_PER_SECOND
+  #define EMBER_AF_PLUGIN_OTA_SERVER_CLIENT_BLOCKS_PER_SECOND 0
+#endif
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+
+#define DOWNLOAD_TABLE_SIZE EMBER_AF_PLUGIN_OTA_SERVER_DOWNLOAD_CLIENTS
+
+// A download that has not asked for a block in this long no longer counts
+// against the clients sharing the budget.  The sample server policy may
+// legitimately delay a client for two minutes.
+#define DOWNLOAD_IDLE_TIMEOUT_MS (5 * 60 * MILLISECOND_TICKS_PER_SECOND)
+
+// Clients that are over budget are asked to come back this much later.
+#define WAIT_FOR_DATA_SECONDS 1
+
+#define SERVER_AND_CLIENT_SUPPORT_MIN_BLOCK_REQUEST \
+  (EMBER_AF_IMAGE_BLOCK_REQUEST_MIN_BLOCK_REQUEST_SUPPORTED_BY_CLIENT \
+   | EMBER_AF_IMAGE_BLOCK_REQUEST_MIN_BLOCK_REQUEST_SUPPORTED_BY_SERVER)
+
+typedef struct {
+  EmberNodeId nodeId;         // EMBER_NULL_NODE_ID if the entry is free
+  EmberAfOtaImageId imageId;
+  int32u imageSize;
+  int32u nextOffset;          // just past the last block sent
+  int32u bytesSent;
+  int32u startTimeMs;         // first request for this image
+  int32u lastRequestTimeMs;
+  int32u lastBlockTimeMs;
+  int32u windowStartMs;
+  int16u windowBlocks;
+  int16u waits;
+  boolean finished;
+} Download;
+
+static Download downloads[DOWNLOAD_TABLE_SIZE];
+static boolean downloadsInitialized = FALSE;
+
+static int16u blocksPerSecond = EMBER_AF_PLUGIN_OTA_SERVER_BLOCKS_PER_SECOND;
+static int16u clientBlocksPerSecond
+  = EMBER_AF_PLUGIN_OTA_SERVER_CLIENT_BLOCKS_PER_SECOND;
+static int32u windowStartMs;
+static int16u windowBlocks;
+static int32u totalWaits;
+
+// -----------------------------------------------------------------------------
+// Forward Declarations
+// -----------------------------------------------------------------------------
+
+static void initDownloads(void);
+static Download* findDownload(EmberNodeId nodeId,
+                              const EmberAfOtaImageId* id,
+                              int32u now);
+static boolean windowFull(int32u now,
+                          int32u* startMs,
+                          int16u* blocks,
+                          int16u limit);
+static boolean isActive(const Download* download, int32u now);
+static int8u activeDownloads(int32u now);
+static int32u bytesPerSecondOf(const Download* download);
+
+// -----------------------------------------------------------------------------
+
+int8u emAfOtaServerGovernBlockRequest(EmberAfImageBlockRequestCallbackStruct* callbackData)
+{
+  int32u now = halCommonGetInt32uMillisecondTick();
+  Download* download = findDownload(callbackData->source,
+                                    callbackData->id,
+                                    now);
+  boolean clientFull;
+  boolean allFull;
+
+  download->lastRequestTimeMs = now;
+  clientFull = windowFull(now,
+                          &download->windowStartMs,
+                          &download->windowBlocks,
+                          clientBlocksPerSecond);
+  allFull = windowFull(now, &windowStartMs, &windowBlocks, blocksPerSecond);
+  if (!clientFull && !allFull) {
+    return EMBER_ZCL_STATUS_SUCCESS;
+  }
+
+  download->waits++;
+  totalWaits++;
+
+  // Current time is sent as 0, so this is relative.
+  callbackData->waitTimeMinutesResponse = WAIT_FOR_DATA_SECONDS;
+
+  // A client that can pace itself is given its fair share of the total
+  // budget, rounded up to whole seconds between blocks, so that it stops
+  // asking early.
+  if (allFull
+      && (SERVER_AND_CLIENT_SUPPORT_MIN_BLOCK_REQUEST
+          == (callbackData->bitmask & SERVER_AND_CLIENT_SUPPORT_MIN_BLOCK_REQUEST))) {
+    int8u active = activeDownloads(now);
+    int16u fairPeriodSeconds = ((active + blocksPerSecond - 1)
+                                / blocksPerSecond);
+    if (active > blocksPerSecond
+        && callbackData->minBlockRequestPeriod < fairPeriodSeconds) {
+      callbackData->minBlockRequestPeriod = fairPeriodSeconds;
+    }
+  }
+  return EMBER_ZCL_STATUS_WAIT_FOR_DATA;
+}
+
+void emAfOtaServerRecordBlockSent(EmberNodeId client,
+                                  const EmberAfOtaImageId* id,
+                                  int32u offset,
+                                  int8u length)
+{
+  int32u now = halCommonGetInt32uMillisecondTick();
+  Download* download = findDownload(client, id, now);
+
+  // Blocks sent for page requests were not asked for one at a time, but they
+  // still use up the budget.
+  windowFull(now, &download->windowStartMs, &download->windowBlocks, 0);
+  windowFull(now, &windowStartMs, &windowBlocks, 0);
+  download->windowBlocks++;
+  windowBlocks++;
+
+  download->bytesSent += length;
+  download->nextOffset = offset + length;
+  download->lastBlockTimeMs = now;
+  download->lastRequestTimeMs = now;
+}
+
+void emAfOtaServerDownloadFinished(EmberNodeId client)
+{
+  int8u i;
+  initDownloads();
+  for (i = 0; i < DOWNLOAD_TABLE_SIZE; i++) {
+    if (downloads[i].nodeId == client) {
+      downloads[i].finished = TRUE;
+    }
+  }
+}
+
+void emAfOtaServerSetDownloadRateLimits(int16u totalBlocksPerSecond,
+                                        int16u blocksPerSecondPerClient)
+{
+  blocksPerSecond = totalBlocksPerSecond;
+  clientBlocksPerSecond = blocksPerSecondPerClient;
+}
+
+void emAfOtaServerPrintDownloads(void)
+{
+  int32u now = halCommonGetInt32uMillisecondTick();
+  int8u i;
+
+  initDownloads();
+  otaPrintln("Active downloads: %d, waits: %l",
+             activeDownloads(now),
+             totalWaits);
+  otaPrintln("Block limit per second: %d total, %d per client (0 = none)",
+             blocksPerSecond,
+             clientBlocksPerSecond);
+  emberAfCoreFlush();
+
+  for (i = 0; i < DOWNLOAD_TABLE_SIZE; i++) {
+    const Download* download = &downloads[i];
+    int32u rate;
+    int32u remaining;
+    if (download->nodeId == EMBER_NULL_NODE_ID) {
+      continue;
+    }
+    rate = bytesPerSecondOf(download);
+    remaining = (download->imageSize > download->nextOffset
+                 ? download->imageSize - download->nextOffset
+                 : 0);
+    otaPrintln("0x%2x mfgId:%2x imageType:%2x, file:%4x %p",
+               download->nodeId,
+               download->imageId.manufacturerId,
+               download->imageId.imageTypeId,
+               download->imageId.firmwareVersion,
+               (download->finished
+                ? "finished"
+                : (isActive(download, now) ? "active" : "idle")));
+    otaPrintln("  offset:%l of %l, %l bytes/s, waits:%d",
+               download->nextOffset,
+               download->imageSize,
+               rate,
+               download->waits);
+    if (remaining == 0 || download->finished) {
+      otaPrintln("  ETA: done");
+    } else if (rate == 0) {
+      otaPrintln("  ETA: unknown");
+    } else {
+      otaPrintln("  ETA: %l s", (remaining + rate - 1) / rate);
+    }
+    emberAfCoreFlush();
+  }
+}
+
+static void initDownloads(void)
+{
+  int8u i;
+  if (downloadsInitialized) {
+    return;
+  }
+  for (i = 0; i < DOWNLOAD_TABLE_SIZE; i++) {
+    downloads[i].nodeId = EMBER_NULL_NODE_ID;
+  }
+  windowStartMs = halCommonGetInt32uMillisecondTick();
+  downloadsInitialized = TRUE;
+}
+
+// Returns the entry for the client's download of the image, starting a new
+// one if the client has moved on to another image or finished.  When the
+// table is full, the entry that has been quiet the longest is reused.
+static Download* findDownload(EmberNodeId nodeId,
+                              const EmberAfOtaImageId* id,
+                              int32u now)
+{
+  Download* download = NULL;
+  Download* oldest = NULL;
+  int8u i;
+
+  initDownloads();
+  for (i = 0; i < DOWNLOAD_TABLE_SIZE; i++) {
+    if (downloads[i].nodeId == nodeId) {
+      download = &downloads[i];
+      break;
+    }
+    if (oldest != NULL && oldest->nodeId == EMBER_NULL_NODE_ID) {
+      continue;
+    }
+    if (oldest == NULL
+        || downloads[i].nodeId == EMBER_NULL_NODE_ID
+        || (elapsedTimeInt32u(downloads[i].lastRequestTimeMs, now)
+            > elapsedTimeInt32u(oldest->lastRequestTimeMs, now))) {
+      oldest = &downloads[i];
+    }
+  }
+
+  if (download != NULL
+      && !download->finished
+      && 0 == MEMCOMPARE(&download->imageId, id, sizeof(EmberAfOtaImageId))) {
+    return download;
+  }
+  if (download == NULL) {
+    download = oldest;
+  }
+
+  MEMSET(download, 0, sizeof(Download));
+  download->nodeId = nodeId;
+  MEMCOPY(&download->imageId, id, sizeof(EmberAfOtaImageId));
+  download->imageSize = emberAfOtaStorageGetTotalImageSizeCallback(id);
+  download->startTimeMs = now;
+  download->lastRequestTimeMs = now;
+  download->lastBlockTimeMs = now;
+  download->windowStartMs = now;
+  return download;
+}
+
+// Starts a new one second window if the current one has passed, then returns
+// whether the window already holds as many blocks as the limit allows.  A
+// limit of 0 means there is none.
+static boolean windowFull(int32u now,
+                          int32u* startMs,
+                          int16u* blocks,
+                          int16u limit)
+{
+  if (elapsedTimeInt32u(*startMs, now) >= MILLISECOND_TICKS_PER_SECOND) {
+    *startMs = now;
+    *blocks = 0;
+  }
+  return (limit != 0 && *blocks >= limit);
+}
+
+static boolean isActive(const Download* download, int32u now)
+{
+  return (download->nodeId != EMBER_NULL_NODE_ID
+          && !download->finished
+          && (elapsedTimeInt32u(download->lastRequestTimeMs, now)
+              < DOWNLOAD_IDLE_TIMEOUT_MS));
+}
+
+static int8u activeDownloads(int32u now)
+{
+  int8u count = 0;
+  int8u i;
+  for (i = 0; i < DOWNLOAD_TABLE_SIZE; i++) {
+    if (isActive(&downloads[i], now)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+static int32u bytesPerSecondOf(const Download* download)
+{
+  int32u elapsedMs = elapsedTimeInt32u(download->startTimeMs,
+                                       download->lastBlockTimeMs);
+  if (elapsedMs == 0) {
+    return 0;
+  }
+  // Stay within 32 bits for images of more than a few megabytes.
+  if (download->bytesSent <= MAX_INT32U_VALUE / MILLISECOND_TICKS_PER_SECOND) {
+    return (download->bytesSent * MILLISECOND_TICKS_PER_SECOND) / elapsedMs;
+  }
+  return download->bytesSent / (elapsedMs / MILLISECOND_TICKS_PER_SECOND + 1);
+}
@@ -27,14 +27,44 @@
 
 #define MAXIMUM_PAGE_SIZE 1024
 
-static EmberNodeId requesterNodeId = EMBER_NULL_NODE_ID;
-static int32u requesterBaseOffset;
-static int16u requesterPageSize;
-static int16u totalBytesSent;
-static int8u requesterMaxDataSize;
-static EmberAfOtaImageId requesterImageId;
-static boolean handlingPageRequest = FALSE;
-static int16u requesterResponseSpacing;
+// Applications generated before these options existed get the defaults from
+// plugin.properties.
+#ifndef EMBER_AF_PLUGIN_OTA_SERVER_PAGE_REQUEST_SESSIONS
+  #define EMBER_AF_PLUGIN_OTA_SERVER_PAGE_REQUEST_SESSIONS 4
+#endif
+#ifndef EMBER_AF_PLUGIN_OTA_SERVER_PAGE_REQUEST_BLOCKS_PER_SECOND
+  #define EMBER_AF_PLUGIN_OTA_SERVER_PAGE_REQUEST_BLOCKS_PER_SECOND 50
+#endif
+
+// Each client with an outstanding page request gets a session.  The sessions
+// are served round-robin, one image block per tick, and the blocks sent to all
+// of them together are paced so that the NCP is never asked to buffer more
+// than the configured number of blocks per second.
+#define PAGE_REQUEST_SESSIONS EMBER_AF_PLUGIN_OTA_SERVER_PAGE_REQUEST_SESSIONS
+#define BLOCK_INTERVAL_MS \
+  (1000L / EMBER_AF_PLUGIN_OTA_SERVER_PAGE_REQUEST_BLOCKS_PER_SECOND)
+
+typedef struct {
+  EmberNodeId nodeId;         // EMBER_NULL_NODE_ID if the session is free
+  EmberAfOtaImageId imageId;
+  EmberApsFrame apsFrame;     // response frame of the page request
+  int8u sequenceNumber;
+  int32u baseOffset;
+  int16u pageSize;
+  int16u totalBytesSent;
+  int8u maxDataSize;
+  int16u responseSpacing;
+  int32u nextSendTimeMs;
+  int32u startTimeMs;
+} PageRequestSession;
+
+static PageRequestSession sessions[PAGE_REQUEST_SESSIONS];
+static boolean sessionsInitialized = FALSE;
+static int8u lastServedSession = PAGE_REQUEST_SESSIONS - 1;
+static int32u nextBlockTimeMs;
+
+// The session whose block is being generated, or NULL.
+static PageRequestSession* currentSession = NULL;
 
 #define SHORTEST_SEND_RATE 10L  // ms.
 
@@ -42,8 +72,11 @@ static int16u requesterResponseSpacing;
 // Forward Declarations
 // -----------------------------------------------------------------------------
 
-static void sendBlockRequest(void);
-static void abortPageRequest(void);
+static void initSessions(void);
+static PageRequestSession* findSession(EmberNodeId nodeId);
+static PageRequestSession* nextDueSession(int32u now);
+static void sendBlockRequest(PageRequestSession* session);
+static void abortPageRequest(PageRequestSession* session);
 
 #if defined(EM_AF_TEST_HARNESS_CODE)
   #define pageRequestTickCallback(x,y)             \
@@ -63,6 +96,7 @@ int8u emAfOtaPageRequestHandler(int8u endpoint,
 {
   int32u totalSize;
   int8u status;
+  PageRequestSession* session;
   emberAfOtaBootloadClusterPrintln("RX ImagePageReq mfgId:%2x imageType:%2x, file:%4x, offset:%4x dataSize:%d pageSize%2x spacing:%d",
                                    id->manufacturerId, 
                                    id->imageTypeId, 
@@ -72,9 +106,13 @@ int8u emAfOtaPageRequestHandler(int8u endpoint,
                                    pageSize, 
                                    responseSpacing);
 
-  // Only allow 1 page request at a time.
-  if (requesterNodeId != EMBER_NULL_NODE_ID) {
-    otaPrintln("2nd page request not supported");
+  // A client that asks again replaces its own outstanding page request.
+  session = findSession(emberAfResponseDestination);
+  if (session == NULL) {
+    session = findSession(EMBER_NULL_NODE_ID);
+  }
+  if (session == NULL) {
+    otaPrintln("No free page request session");
     return EMBER_ZCL_STATUS_FAILURE;
   }
 
@@ -83,7 +121,6 @@ int8u emAfOtaPageRequestHandler(int8u endpoint,
     return status;
   }
   
-  MEMCOPY(&requesterImageId, id, sizeof(EmberAfOtaImageId));
   totalSize = emberAfOtaStorageGetTotalImageSizeCallback(id);
 
   if (totalSize == 0) {
@@ -92,92 +129,186 @@ int8u emAfOtaPageRequestHandler(int8u endpoint,
     return EMBER_ZCL_STATUS_INVALID_VALUE;
   }
 
-  requesterNodeId = emberAfResponseDestination;
-  requesterBaseOffset = offset;
-  requesterPageSize = pageSize;
-  requesterMaxDataSize = maxDataSize;
-  requesterResponseSpacing = (responseSpacing < SHORTEST_SEND_RATE
+  MEMCOPY(&session->imageId, id, sizeof(EmberAfOtaImageId));
+  MEMCOPY(&session->apsFrame, &emberAfResponseApsFrame, sizeof(EmberApsFrame));
+  session->nodeId = emberAfResponseDestination;
+  session->sequenceNumber = emberAfIncomingZclSequenceNumber;
+  session->baseOffset = offset;
+  session->pageSize = pageSize;
+  session->maxDataSize = maxDataSize;
+  session->responseSpacing = (responseSpacing < SHORTEST_SEND_RATE
                               ? SHORTEST_SEND_RATE
                               : responseSpacing);
-  totalBytesSent = 0;
+  session->totalBytesSent = 0;
+  session->startTimeMs = halCommonGetInt32uMillisecondTick();
+  session->nextSendTimeMs = session->startTimeMs;
   
   emAfOtaPageRequestTick(endpoint);
 
+  // The blocks are the only response to a page request.  Whatever the tick
+  // left in the response buffer has already been sent.
+  appResponseLength = 0;
+
   return EMBER_ZCL_STATUS_SUCCESS;
 }
 
 void emAfOtaPageRequestTick(int8u endpoint)
 {
-  if (requesterNodeId == EMBER_NULL_NODE_ID) {
-    return;
+  int32u now = halCommonGetInt32uMillisecondTick();
+  int32u delayMs = MAX_INT32U_VALUE;
+  PageRequestSession* session;
+  int8u i;
+
+  initSessions();
+
+  if (timeGTorEqualInt32u(now, nextBlockTimeMs)) {
+    session = nextDueSession(now);
+    if (session != NULL) {
+      // Keep to the budget on average, but don't make up for ticks that
+      // arrived late with a burst of blocks.
+      nextBlockTimeMs = ((elapsedTimeInt32u(nextBlockTimeMs, now)
+                          < BLOCK_INTERVAL_MS)
+                         ? nextBlockTimeMs
+                         : now) + BLOCK_INTERVAL_MS;
+      session->nextSendTimeMs = now + session->responseSpacing;
+      sendBlockRequest(session);
+    }
   }
 
-  sendBlockRequest();
+  for (i = 0; i < PAGE_REQUEST_SESSIONS; i++) {
+    session = &sessions[i];
+    if (session->nodeId != EMBER_NULL_NODE_ID) {
+      int32u wait = (timeGTorEqualInt32u(now, session->nextSendTimeMs)
+                     ? 0
+                     : elapsedTimeInt32u(now, session->nextSendTimeMs));
+      if (wait < delayMs) {
+        delayMs = wait;
+      }
+    }
+  }
+  if (delayMs == MAX_INT32U_VALUE) {
+    return;
+  }
+  if (!timeGTorEqualInt32u(now, nextBlockTimeMs)
+      && elapsedTimeInt32u(now, nextBlockTimeMs) > delayMs) {
+    delayMs = elapsedTimeInt32u(now, nextBlockTimeMs);
+  }
   emberAfScheduleClusterTick(endpoint,
                              ZCL_OTA_BOOTLOAD_CLUSTER_ID,
                              EMBER_AF_SERVER_CLUSTER_TICK,
-                             requesterResponseSpacing,
+                             delayMs,
                              EMBER_AF_OK_TO_NAP);
 }
 
 boolean emAfOtaPageRequestErrorHandler(void)
 {
-  if (handlingPageRequest) {
-    abortPageRequest();
+  if (currentSession != NULL) {
+    abortPageRequest(currentSession);
     return TRUE;
   }
   return FALSE;
 }
 
-static void abortPageRequest(void)
+static void initSessions(void)
 {
-  requesterNodeId = EMBER_NULL_NODE_ID;
+  int8u i;
+  if (sessionsInitialized) {
+    return;
+  }
+  for (i = 0; i < PAGE_REQUEST_SESSIONS; i++) {
+    sessions[i].nodeId = EMBER_NULL_NODE_ID;
+  }
+  nextBlockTimeMs = halCommonGetInt32uMillisecondTick();
+  sessionsInitialized = TRUE;
 }
 
-static void sendBlockRequest(void)
+static PageRequestSession* findSession(EmberNodeId nodeId)
+{
+  int8u i;
+  initSessions();
+  for (i = 0; i < PAGE_REQUEST_SESSIONS; i++) {
+    if (sessions[i].nodeId == nodeId) {
+      return &sessions[i];
+    }
+  }
+  return NULL;
+}
+
+// Returns the first session after the one served last whose response spacing
+// has elapsed, so that every client gets its turn.
+static PageRequestSession* nextDueSession(int32u now)
+{
+  int8u i;
+  int8u index = lastServedSession;
+  for (i = 0; i < PAGE_REQUEST_SESSIONS; i++) {
+    index = (index + 1 == PAGE_REQUEST_SESSIONS ? 0 : index + 1);
+    if (sessions[index].nodeId != EMBER_NULL_NODE_ID
+        && timeGTorEqualInt32u(now, sessions[index].nextSendTimeMs)) {
+      lastServedSession = index;
+      return &sessions[index];
+    }
+  }
+  return NULL;
+}
+
+static void abortPageRequest(PageRequestSession* session)
+{
+  session->nodeId = EMBER_NULL_NODE_ID;
+}
+
+static void sendBlockRequest(PageRequestSession* session)
 {
   int8u bytesSentThisTime = 0;
-  int32u totalSize = emberAfOtaStorageGetTotalImageSizeCallback(&requesterImageId);
+  int32u totalSize = emberAfOtaStorageGetTotalImageSizeCallback(&session->imageId);
   int8u maxDataToSend;
   int32u bytesLeft;
 
   if (totalSize == 0) {
     // The image no longer exists.  
-    abortPageRequest();
+    abortPageRequest(session);
     return;
   }
 
-  bytesLeft = totalSize - (requesterBaseOffset + totalBytesSent);
+  if (session->baseOffset + session->totalBytesSent >= totalSize) {
+    // The page runs past the end of the image, which has all been sent.
+    abortPageRequest(session);
+    return;
+  }
+  bytesLeft = totalSize - (session->baseOffset + session->totalBytesSent);
   
   // 3 possibilities for how much data to send
-  //   - Up to requesterMaxSize
+  //   - Up to the client's max data size
   //   - As many bytes are left in the file
   //   - As many bytes are left to fill up client's page size
-  if ((requesterPageSize - totalBytesSent) > requesterMaxDataSize) {
-    maxDataToSend = (bytesLeft > requesterMaxDataSize
-                     ? requesterMaxDataSize
+  if ((session->pageSize - session->totalBytesSent) > session->maxDataSize) {
+    maxDataToSend = (bytesLeft > session->maxDataSize
+                     ? session->maxDataSize
                      : (int8u)bytesLeft);
   } else {
-    maxDataToSend = requesterPageSize - totalBytesSent;
+    maxDataToSend = session->pageSize - session->totalBytesSent;
   }
 
-  emberAfResponseDestination = requesterNodeId;
-  handlingPageRequest = TRUE;
+  // Other messages may have come and gone since the page request, so the
+  // response is addressed from what was saved with the session.
+  MEMCOPY(&emberAfResponseApsFrame, &session->apsFrame, sizeof(EmberApsFrame));
+  emberAfResponseDestination = session->nodeId;
+  emberAfIncomingZclSequenceNumber = session->sequenceNumber;
+  currentSession = session;
 
   // To enable sending as fast as possible without the receiver
   // having to waste battery power by responding, we clear the
   // retry flag.
   emberAfResponseApsFrame.options &= ~EMBER_APS_OPTION_RETRY;
 
-  if (pageRequestTickCallback(totalBytesSent,
-                              requesterMaxDataSize)) {
+  if (pageRequestTickCallback(session->totalBytesSent,
+                              session->maxDataSize)) {
     // Simulate a block request to the server that we will generate
     // a response to.
     EmberAfImageBlockRequestCallbackStruct callbackStruct;
     MEMSET(&callbackStruct, 0, sizeof(EmberAfImageBlockRequestCallbackStruct));
-    callbackStruct.source = requesterNodeId;
-    callbackStruct.id = &requesterImageId;
-    callbackStruct.offset = requesterBaseOffset + totalBytesSent;
+    callbackStruct.source = session->nodeId;
+    callbackStruct.id = &session->imageId;
+    callbackStruct.offset = session->baseOffset + session->totalBytesSent;
     callbackStruct.maxDataSize = maxDataToSend;
 
     // This is implied by the MEMSET().  We don't care about those options
@@ -189,26 +320,30 @@ static void sendBlockRequest(void)
   } else {
     bytesSentThisTime += maxDataToSend;
   }
-  handlingPageRequest = FALSE;
+  currentSession = NULL;
   if (bytesSentThisTime == 0) {
     emberAfOtaBootloadClusterPrintln("Failed to send image block for page request");
     // We don't need to call abortPageRequest();
     // here because the server will call into our otaPageRequestErrorHandler()
     // if that occurs.
   } else {
-    totalBytesSent += bytesSentThisTime;
-
-    if (totalBytesSent >= totalSize
-        || totalBytesSent >= requesterPageSize) {
-      emberAfOtaBootloadClusterPrintln("Done sending blocks for page request.");
-      abortPageRequest();
+    session->totalBytesSent += bytesSentThisTime;
+
+    if (session->baseOffset + session->totalBytesSent >= totalSize
+        || session->totalBytesSent >= session->pageSize) {
+      emberAfOtaBootloadClusterPrintln("Done sending blocks for page request to 0x%2x: %d bytes in %d ms",
+                                       session->nodeId,
+                                       session->totalBytesSent,
+                                       elapsedTimeInt32u(session->startTimeMs,
+                                                         halCommonGetInt32uMillisecondTick()));
+      abortPageRequest(session);
     }
   }
 }
 
 boolean emAfOtaServerHandlingPageRequest(void)
 {
-  return handlingPageRequest;
+  return (currentSession != NULL);
 }
 
 //------------------------------------------------------------------------------
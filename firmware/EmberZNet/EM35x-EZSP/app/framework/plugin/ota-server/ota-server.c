@@ -96,7 +96,9 @@ boolean emberAfOtaServerIncomingMessageRawCallback(EmberAfClusterCommand* comman
                                      command->commandId);
     emberAfOtaBootloadClusterFlush();
     emberAfSendDefaultResponse(command, EMBER_ZCL_STATUS_INVALID_FIELD);
-  } else {
+  } else if (appResponseLength != 0) {
+    // An accepted page request is answered only by the image blocks it
+    // schedules, so there is nothing left to send for it here.
     emberAfSendResponse();
   }
 
@@ -208,6 +210,12 @@ int8u emAfOtaImageBlockRequestHandler(EmberAfImageBlockRequestCallbackStruct* ca
   }
 
   status = emAfOtaServerImageBlockRequestCallback(callbackData);
+
+  // Page requests are paced by the page request code itself.
+  if (status == EMBER_ZCL_STATUS_SUCCESS
+      && !emAfOtaServerHandlingPageRequest()) {
+    status = emAfOtaServerGovernBlockRequest(callbackData);
+  }
   if (status != EMBER_ZCL_STATUS_SUCCESS) {
     prepareClusterResponse(ZCL_IMAGE_BLOCK_RESPONSE_COMMAND_ID,
                            status);
@@ -258,6 +266,11 @@ int8u emAfOtaImageBlockRequestHandler(EmberAfImageBlockRequestCallbackStruct* ca
   emberAfPutInt8uInResp((int8u)actualLength);
   emberAfPutBlockInResp(data, actualLength);
 
+  emAfOtaServerRecordBlockSent(callbackData->source,
+                               callbackData->id,
+                               callbackData->offset,
+                               (int8u)actualLength);
+
   // We can't send more than 128 bytes in a packet so we can safely cast this
   // to a 1-byte number.
   return (int8u)actualLength;
@@ -291,6 +304,8 @@ static void upgradeEndRequestHandler(EmberNodeId source,
   emberAfOtaBootloadClusterPrintln("RX UpgradeEndReq status:%x", 
                                    status);
 
+  emAfOtaServerDownloadFinished(source);
+
   // This callback is considered only informative when the status
   // is a failure.
   goAhead = emberAfOtaServerUpgradeEndRequestCallback(source,
@@ -22,6 +22,20 @@ int8u emAfOtaPageRequestHandler(int8u endpoint,
 
 boolean emAfOtaServerHandlingPageRequest(void);
 
+// Returns EMBER_ZCL_STATUS_WAIT_FOR_DATA, with the wait time filled in, if the
+// block would put the server over its block rate limits.
+int8u emAfOtaServerGovernBlockRequest(EmberAfImageBlockRequestCallbackStruct* callbackData);
+void emAfOtaServerRecordBlockSent(EmberNodeId client,
+                                  const EmberAfOtaImageId* id,
+                                  int32u offset,
+                                  int8u length);
+void emAfOtaServerDownloadFinished(EmberNodeId client);
+
+// A limit of 0 means there is none.
+void emAfOtaServerSetDownloadRateLimits(int16u totalBlocksPerSecond,
+                                        int16u blocksPerSecondPerClient);
+void emAfOtaServerPrintDownloads(void);
+
 // This will eventually be moved into a Plugin specific callbacks file.
 void emberAfOtaServerSendUpgradeCommandCallback(EmberNodeId dest,
                                                 int8u endpoint,
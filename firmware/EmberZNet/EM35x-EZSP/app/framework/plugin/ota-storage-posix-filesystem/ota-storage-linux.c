@@ -6,8 +6,16 @@
  * 
  * This implements the image storage for a standard POSIX-style operating system 
  * with an underlying filesystem.  It creates a linked list cache of all
- * the OTA image headers and uses that for quick access to requests for an
- * image.  Full image data requires that we read the file from disk.
+ * the OTA image headers, indexed by manufacturer, image type and upgrade
+ * destination, and uses that for quick access to requests for an image.  Full image data is served from a read-only mapping of each file
+ * that is kept for as long as the image is in the list.  Image files must
+ * therefore never be truncated or rewritten in place while the storage is
+ * open, since touching a mapped page past the new end of a file raises
+ * SIGBUS.  Replace a file by writing the new one under another name and
+ * renaming it over the old one; the old mapping stays valid.
+ *
+ * With the watchDirectory option, changes to the storage directory are picked
+ * up as they happen, one file at a time, rather than by rescanning it.
  *
  * It can also be a OTA client storage device, receiving bytes over the air
  * and storing them to a temporary file.  Once that is done is can validate the
@@ -49,6 +57,23 @@
 
 #include <dirent.h>     // opendir, readdir
 
+#if !defined(WIN32)
+  #include <fcntl.h>      // open
+  #include <sys/mman.h>   // mmap, madvise, munmap
+  #define MAP_IMAGE_FILES
+#endif
+
+#if defined(EMBER_AF_PLUGIN_OTA_STORAGE_POSIX_FILESYSTEM_WATCH_DIRECTORY) \
+    && defined(MAP_IMAGE_FILES)                                         \
+    && defined(__linux__)                                               \
+    && !defined(IMAGE_BUILDER)
+  #include <sys/inotify.h>  // inotify_init1, inotify_add_watch
+  #define WATCH_STORAGE_DIRECTORY
+  #if defined(EMBER_AF_PLUGIN_GATEWAY)
+    #include "app/framework/plugin/gateway/gateway-support.h"
+  #endif
+#endif
+
 #ifdef __APPLE__
 #define strnlen(string, n) strlen((string))
 #endif
@@ -70,12 +95,73 @@ typedef struct {
   struct OtaImage* next;
   struct OtaImage* prev;
   off_t fileSize;
+
+  // Read-only mapping of the whole file, or NULL if it could not be mapped.
+  // Block requests inside the mapping are served with a memcpy.
+  const int8u* mapping;
+  size_t mappingLength;
+
+  int32u lastReadMs;  // only kept up to date for retired images
 } OtaImage;
 
 static OtaImage* imageListFirst = NULL;
 static OtaImage* imageListLast = NULL;
 static int8u imageCount = 0;
 
+// The images that share a key, sorted by firmware version.  Images with the
+// same version stay in the order they have in the image list.
+typedef struct {
+  int16u manufacturerId;
+  int16u imageTypeId;
+  int8u upgradeFileDestination[EUI64_SIZE];  // all 0's when not part of the key
+  int16u count;
+  int16u capacity;
+  OtaImage** images;
+} ImageShelf;
+
+// Open-addressed hash table of shelves.  Shelves are only freed when the
+// storage is closed, so there is no deletion from the table.
+typedef struct {
+  ImageShelf** slots;
+  int16u size;   // 0 or a power of two
+  int16u count;
+} ShelfIndex;
+
+// Every image, keyed by manufacturer ID and image type.
+static ShelfIndex familyIndex = { NULL, 0, 0 };
+
+// Every image, keyed by manufacturer ID, image type and upgrade file
+// destination.  Images without a destination use the all 0's EUI64.
+static ShelfIndex destinationIndex = { NULL, 0, 0 };
+
+#define SHELF_INDEX_INITIAL_SIZE 16
+#define SHELF_INITIAL_CAPACITY   4
+
+#define INVALID_FD -1
+
+#if defined(WATCH_STORAGE_DIRECTORY)
+// inotify descriptor for the storage directory, or INVALID_FD.
+static int watchFd = INVALID_FD;
+
+// Images that were replaced or removed while the directory was watched.
+// They are out of the image list and the catalog, but they keep serving
+// reads for their exact ID from their mapping so that downloads in progress
+// can finish.  They are freed once nobody has read them for a while.
+static OtaImage* retiredImages = NULL;
+
+#if !defined(EMBER_AF_PLUGIN_GATEWAY)
+// The gateway wakes us when the inotify descriptor is readable.  Without it
+// the descriptor is polled.
+#define WATCH_POLL_INTERVAL_MS   1000
+#endif
+#define RETIRED_IMAGE_TIMEOUT_MS                                              \
+  (EMBER_AF_PLUGIN_OTA_STORAGE_POSIX_FILESYSTEM_RETIRED_IMAGE_TIMEOUT * 60000UL)
+#endif
+
+#if !defined(IMAGE_BUILDER)
+EmberEventControl emberAfPluginOtaStoragePosixFilesystemWatchEventControl;
+#endif
+
 #define OTA_MAX_FILENAME_LENGTH 1000
 
 static const int8u otaFileMagicNumberBytes[] = {
@@ -187,8 +273,16 @@ static EmberAfOtaStorageStatus createDefaultStorageDirectory(void);
 static EmberAfOtaStorageStatus initImageDirectory(void);
 static OtaImage* addImageFileToList(const char* filename, 
                                     boolean printImageInfo);
+static OtaImage* loadImageFile(const char* filename);
+static OtaImage* insertImage(OtaImage* newImage, boolean printImageInfo);
+static OtaImage* findImageForRead(const EmberAfOtaImageId* id);
 static OtaImage* findImageById(const EmberAfOtaImageId* id);
+static boolean addImageToCatalog(OtaImage* image);
+static void removeImageFromCatalog(OtaImage* image);
+static void freeCatalog(void);
 static void freeOtaImage(OtaImage* image);
+static void mapImageFile(OtaImage* image);
+static void unmapImageFile(OtaImage* image);
 static void mapHeaderFieldDefinitionToDataStruct(EmberAfOtaHeader* header);
 static void unmapHeaderFieldDefinitions(void);
 static EmberAfOtaStorageStatus readHeaderDataFromBuffer(EmberAfOtaHeaderFieldDefinition* definition,
@@ -200,6 +294,13 @@ static int8u* writeHeaderDataToBuffer(EmberAfOtaHeaderFieldDefinition* definitio
                                       int8u* bufferPtr);
 static EmberAfOtaHeader* readImageHeader(const char* filename);
 static OtaImage* imageSearchInternal(const EmberAfOtaImageId* id);
+static ImageShelf* findShelf(ShelfIndex* index,
+                             int16u manufacturerId,
+                             int16u imageTypeId,
+                             const int8u* eui64,
+                             boolean create);
+static int16u shelfLowerBound(const ImageShelf* shelf, int32u version);
+static const int8u* imageDestination(const EmberAfOtaHeader* header);
 static EmberAfOtaImageId getIteratorImageId(void);
 static EmberAfOtaStorageStatus writeRawData(int32u offset,
                                             const char* filepath,
@@ -207,6 +308,13 @@ static EmberAfOtaStorageStatus writeRawData(int32u offset,
                                             const int8u* data);
 static OtaImage* findImageByFilename(const char* tempFilepath);
 static void removeImage(OtaImage* image);
+static void releaseImage(OtaImage* image);
+#if defined(WATCH_STORAGE_DIRECTORY)
+static void startWatchingDirectory(void);
+static void stopWatchingDirectory(void);
+static void processWatchEvents(void);
+static int32u freeRetiredImages(boolean expiredOnly);
+#endif
 
 static void* myMalloc(size_t size, const char* allocName);
 static void myFree(void* ptr);
@@ -339,6 +447,11 @@ EmberAfOtaStorageStatus emberAfOtaStorageInitCallback(void)
 
   if (status == EMBER_AF_OTA_STORAGE_SUCCESS) {
     initDone = TRUE;
+#if defined(WATCH_STORAGE_DIRECTORY)
+    if (storageDeviceIsDirectory) {
+      startWatchingDirectory();
+    }
+#endif
   }
 
   return status;
@@ -346,6 +459,11 @@ EmberAfOtaStorageStatus emberAfOtaStorageInitCallback(void)
 
 void emAfOtaStorageClose(void)
 {
+#if defined(WATCH_STORAGE_DIRECTORY)
+  stopWatchingDirectory();
+  freeRetiredImages(FALSE);
+#endif
+
   OtaImage* ptr = imageListLast;
   while (ptr != NULL) {
     OtaImage* current = ptr;
@@ -354,6 +472,7 @@ void emAfOtaStorageClose(void)
   }
   imageListLast = NULL;
   imageListFirst = NULL;
+  freeCatalog();
   
   if (storageDevice != NULL) {
     myFree(storageDevice);
@@ -428,7 +547,7 @@ EmberAfOtaStorageStatus emberAfOtaStorageReadImageDataCallback(const EmberAfOtaI
                                                                int8u* returnData, 
                                                                int32u* returnedLength)
 {
-  OtaImage* image = imageSearchInternal(id);
+  OtaImage* image = findImageForRead(id);
   if (image == NULL) {
     error("No such Image (Mfg ID: 0x%04X, Image ID: 0x%04X, Version: 0x%08X\n",
           id->manufacturerId, 
@@ -437,6 +556,18 @@ EmberAfOtaStorageStatus emberAfOtaStorageReadImageDataCallback(const EmberAfOtaI
     return EMBER_AF_OTA_STORAGE_ERROR;
   }
 
+#if defined(MAP_IMAGE_FILES)
+  if (image->mapping != NULL
+      && offset <= image->mappingLength
+      && length <= image->mappingLength - offset) {
+    MEMCOPY(returnData, image->mapping + offset, length);
+    *returnedLength = length;
+    return EMBER_AF_OTA_STORAGE_SUCCESS;
+  }
+#endif
+
+  // Reads that run past the end of the mapping, such as the last block of
+  // a file that is still being written, go to the file itself.
   // Windows requires the 'b' (binary) as part of the mode so that line endings
   // are not truncated.  POSIX ignores this.
   FILE* fileHandle = fopen(image->filepath, "rb");
@@ -665,9 +796,9 @@ int remainingAllocations(void)
 EmberAfOtaStorageStatus emberAfOtaStorageGetFullHeaderCallback(const EmberAfOtaImageId* id,
                                                                EmberAfOtaHeader* returnData)
 {
-  OtaImage* image = imageSearchInternal(id);
+  OtaImage* image = findImageForRead(id);
   if (image == NULL) {
-    return FALSE;
+    return EMBER_AF_OTA_STORAGE_ERROR;
   }
   MEMCOPY(returnData, image->header, sizeof(EmberAfOtaHeader));
   return EMBER_AF_OTA_STORAGE_SUCCESS;
@@ -675,7 +806,7 @@ EmberAfOtaStorageStatus emberAfOtaStorageGetFullHeaderCallback(const EmberAfOtaI
 
 int32u emberAfOtaStorageGetTotalImageSizeCallback(const EmberAfOtaImageId* id)
 {
-  OtaImage* image = imageSearchInternal(id);
+  OtaImage* image = findImageForRead(id);
   if (image == NULL) {
     return 0;
   }
@@ -706,6 +837,56 @@ EmberAfOtaStorageStatus emberAfOtaStorageDriverPrepareToResumeDownloadCallback(v
   return EMBER_AF_OTA_STORAGE_SUCCESS;
 }
 
+#if !defined(IMAGE_BUILDER)
+// Runs when the storage directory has changed, and when the next retired
+// image is due to be freed.
+void emberAfPluginOtaStoragePosixFilesystemWatchEventHandler(void)
+{
+#if defined(WATCH_STORAGE_DIRECTORY)
+  int32u msToNextExpiry;
+#endif
+  emberEventControlSetInactive(emberAfPluginOtaStoragePosixFilesystemWatchEventControl);
+#if defined(WATCH_STORAGE_DIRECTORY)
+  if (watchFd == INVALID_FD) {
+    return;
+  }
+  processWatchEvents();
+  msToNextExpiry = freeRetiredImages(TRUE);
+  if (msToNextExpiry != 0) {
+    emberAfEventControlSetDelay(&emberAfPluginOtaStoragePosixFilesystemWatchEventControl,
+                                msToNextExpiry);
+  }
+#if !defined(EMBER_AF_PLUGIN_GATEWAY)
+  if (msToNextExpiry == 0 || msToNextExpiry > WATCH_POLL_INTERVAL_MS) {
+    emberAfEventControlSetDelay(&emberAfPluginOtaStoragePosixFilesystemWatchEventControl,
+                                WATCH_POLL_INTERVAL_MS);
+  }
+#endif
+#endif
+}
+
+// Adds the inotify descriptor to those the gateway waits on.
+int emberAfPluginGatewaySelectFileDescriptorsCallback(int* list, int maxSize)
+{
+#if defined(WATCH_STORAGE_DIRECTORY)
+  if (watchFd != INVALID_FD && maxSize > 0) {
+    list[0] = watchFd;
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+void emberAfPluginGatewayFileDescriptorReadyCallback(int fd)
+{
+#if defined(WATCH_STORAGE_DIRECTORY)
+  if (fd == watchFd) {
+    emberEventControlSetActive(emberAfPluginOtaStoragePosixFilesystemWatchEventControl);
+  }
+#endif
+}
+#endif
+
 //==============================================================================
 // Internal Functions
 //==============================================================================
@@ -809,6 +990,8 @@ static EmberAfOtaStorageStatus writeRawData(int32u offset,
 
 static void removeImage(OtaImage* image)
 {
+  removeImageFromCatalog(image);
+
   OtaImage* before = (OtaImage*)image->prev;
   OtaImage* after = (OtaImage*)image->next;
   if (before) {
@@ -823,10 +1006,36 @@ static void removeImage(OtaImage* image)
   if (image == imageListLast) {
     imageListLast = before;
   }
-  freeOtaImage(image);
+  image->next = NULL;
+  image->prev = NULL;
+  releaseImage(image);
   imageCount--;
 }
 
+// Frees an image that has been taken out of the list, or retires it if
+// clients may still be downloading it.
+static void releaseImage(OtaImage* image)
+{
+#if defined(WATCH_STORAGE_DIRECTORY)
+  // The temporary file is truncated when it is reset, so its mapping cannot
+  // outlive its place in the list.
+  if (watchFd != INVALID_FD
+      && image->mapping != NULL
+      && (tempStorageFilepath == NULL
+          || 0 != strcmp(image->filepath, tempStorageFilepath))) {
+    image->lastReadMs = halCommonGetInt32uMillisecondTick();
+    image->next = (struct OtaImage*)retiredImages;
+    retiredImages = image;
+    if (!emberEventControlGetActive(emberAfPluginOtaStoragePosixFilesystemWatchEventControl)) {
+      emberAfEventControlSetDelay(&emberAfPluginOtaStoragePosixFilesystemWatchEventControl,
+                                  RETIRED_IMAGE_TIMEOUT_MS);
+    }
+    return;
+  }
+#endif
+  freeOtaImage(image);
+}
+
 static void printEui64(int8u* eui64)
 {
   note("%02X%02X%02X%02X%02X%02X%02X%02X",
@@ -865,9 +1074,20 @@ static void printHeaderInfo(const EmberAfOtaHeader* header)
 
 static OtaImage* addImageFileToList(const char* filename, 
                                     boolean printImageInfo)
+{
+  OtaImage* newImage = loadImageFile(filename);
+  if (newImage == NULL) {
+    return NULL;
+  }
+  return insertImage(newImage, printImageInfo);
+}
+
+// Reads the header of an image file into a new OtaImage that is not yet part
+// of the list.
+static OtaImage* loadImageFile(const char* filename)
 {
   OtaImage* newImage = (OtaImage*)myMalloc(sizeof(OtaImage), 
-                                           "addImageFileToList():OtaImage");
+                                           "loadImageFile():OtaImage");
   if (newImage == NULL) {
     return NULL;
   }
@@ -899,7 +1119,18 @@ static OtaImage* addImageFileToList(const char* filename,
   if (newImage->header == NULL) {
     goto dontAdd;
   }
+  return newImage;
+
+ dontAdd:
+  freeOtaImage(newImage);
+  return NULL;
+}
 
+// Adds a loaded image to the list unless an image with the same ID and an
+// equal or later version is already there.  Frees the image if it is not
+// added.
+static OtaImage* insertImage(OtaImage* newImage, boolean printImageInfo)
+{
   EmberAfOtaImageId new = { 
     newImage->header->manufacturerId,
     newImage->header->imageTypeId,
@@ -955,6 +1186,13 @@ static OtaImage* addImageFileToList(const char* filename,
     }
   }
 
+  if (!addImageToCatalog(newImage)) {
+    error("Failed to allocate memory for the image catalog.\n");
+    goto dontAdd;
+  }
+
+  mapImageFile(newImage);
+
   if (imageListFirst == NULL) {
     imageListFirst = newImage;
     imageListLast = newImage;
@@ -1118,11 +1356,55 @@ static void freeOtaImage(OtaImage* image)
   if (image == NULL) {
     return;
   }
+  unmapImageFile(image);
   freeIfNotNull((void**)&(image->header));
   freeIfNotNull((void**)&(image->filepath));
   myFree(image);
 }
 
+// A failed mapping is not an error; reads then go through stdio as before.
+static void mapImageFile(OtaImage* image)
+{
+#if defined(MAP_IMAGE_FILES)
+  struct stat statInfo;
+  void* mapping;
+  int fd = open(image->filepath, O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  // Size the mapping from the open descriptor so that it never extends past
+  // the end of the file it maps.
+  if (0 != fstat(fd, &statInfo) || statInfo.st_size == 0) {
+    close(fd);
+    return;
+  }
+  mapping = mmap(NULL, statInfo.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    debug(config.fileDebug,
+          "Could not map '%s': %s\n",
+          image->filenameStart,
+          strerror(errno));
+    close(fd);
+    return;
+  }
+  close(fd);
+  madvise(mapping, statInfo.st_size, MADV_SEQUENTIAL);
+  image->mapping = (const int8u*)mapping;
+  image->mappingLength = statInfo.st_size;
+#endif
+}
+
+static void unmapImageFile(OtaImage* image)
+{
+#if defined(MAP_IMAGE_FILES)
+  if (image->mapping != NULL) {
+    munmap((void*)image->mapping, image->mappingLength);
+    image->mapping = NULL;
+    image->mappingLength = 0;
+  }
+#endif
+}
+
 static EmberAfOtaHeader* readImageHeader(const char* filename)
 {
   EmberAfOtaHeader* header = NULL;
@@ -1321,16 +1603,47 @@ static void unmapHeaderFieldDefinitions(void)
   }
 }
 
-static OtaImage* findImageById(const EmberAfOtaImageId* id)
+// Like imageSearchInternal(), but retired images still answer for their
+// exact ID.
+static OtaImage* findImageForRead(const EmberAfOtaImageId* id)
 {
-  OtaImage* ptr = imageListFirst;
-  while (ptr != NULL) {
-    if (id->manufacturerId == ptr->header->manufacturerId
-        && id->imageTypeId == ptr->header->imageTypeId
-        && id->firmwareVersion == ptr->header->firmwareVersion) {
-      return ptr;
+  OtaImage* image = imageSearchInternal(id);
+#if defined(WATCH_STORAGE_DIRECTORY)
+  if (image == NULL && id->firmwareVersion != INVALID_FIRMWARE_VERSION) {
+    OtaImage* retired;
+    for (retired = retiredImages;
+         retired != NULL;
+         retired = (OtaImage*)retired->next) {
+      const EmberAfOtaHeader* header = retired->header;
+      if (header->manufacturerId == id->manufacturerId
+          && header->imageTypeId == id->imageTypeId
+          && header->firmwareVersion == id->firmwareVersion
+          && doEui64sMatch(imageDestination(header),
+                           id->deviceSpecificFileEui64)) {
+        retired->lastReadMs = halCommonGetInt32uMillisecondTick();
+        return retired;
+      }
     }
-    ptr = (OtaImage*)ptr->next;
+  }
+#endif
+  return image;
+}
+
+static OtaImage* findImageById(const EmberAfOtaImageId* id)
+{
+  ImageShelf* shelf = findShelf(&familyIndex,
+                                id->manufacturerId,
+                                id->imageTypeId,
+                                emberAfInvalidImageId.deviceSpecificFileEui64,
+                                FALSE);
+  int16u index;
+  if (shelf == NULL) {
+    return NULL;
+  }
+  index = shelfLowerBound(shelf, id->firmwareVersion);
+  if (index < shelf->count
+      && shelf->images[index]->header->firmwareVersion == id->firmwareVersion) {
+    return shelf->images[index];
   }
   return NULL;
 }
@@ -1392,53 +1705,284 @@ static int16u calculateOtaFileHeaderLength(EmberAfOtaHeader* header)
   return length;
 }
 
+// Images with an upgrade file destination only match a search for that
+// EUI64, and images without one only match a search without one.  A search
+// for INVALID_FIRMWARE_VERSION returns the latest version.
 static OtaImage* imageSearchInternal(const EmberAfOtaImageId* id)
 {
-  OtaImage* ptr = imageListFirst;
-  OtaImage* newest = NULL;
-  while (ptr != NULL) {
-    /*
-    note("imageSearchInternal: Considering file '%s' (MFG: 0x%04X, Image: 0x%04X)\n", 
-         ptr->filenameStart,
-         ptr->header->manufacturerId,
-         ptr->header->imageTypeId);
-    */
-    if (ptr->header->manufacturerId == id->manufacturerId
-        && (ptr->header->imageTypeId == id->imageTypeId)) {
-      if (id->firmwareVersion == INVALID_FIRMWARE_VERSION) {
-        newest = ptr;
-      } else if (ptr->header->firmwareVersion
-                 == id->firmwareVersion) {
-        newest = ptr;
-      }
+  ImageShelf* shelf = findShelf(&destinationIndex,
+                                id->manufacturerId,
+                                id->imageTypeId,
+                                id->deviceSpecificFileEui64,
+                                FALSE);
+  int16u index;
+  if (shelf == NULL || shelf->count == 0) {
+    return NULL;
+  }
+  if (id->firmwareVersion == INVALID_FIRMWARE_VERSION) {
+    return shelf->images[shelf->count - 1];
+  }
+  index = shelfLowerBound(shelf, id->firmwareVersion);
+  if (index < shelf->count
+      && shelf->images[index]->header->firmwareVersion == id->firmwareVersion) {
+    return shelf->images[index];
+  }
+  return NULL;
+}
 
-      // Check whether the upgrade file dest the search
-      // and the one in the file.
-      if (newest) {
-        if (doEui64sMatch(emberAfInvalidImageId.deviceSpecificFileEui64,
-                          id->deviceSpecificFileEui64)
-            && !headerHasUpgradeFileDest(newest->header)) {
-          // Keep going.  There is no upgrade file dest in either the
-          // search criteria or the file.  This match may or may not be
-          // the latest version number.
-        } else if (headerHasUpgradeFileDest(newest->header)
-                   && doEui64sMatch(id->deviceSpecificFileEui64,
-                                    newest->header->upgradeFileDestination)) {
-          // Because there is an exact match on the EUI64, we know
-          // this is the only one that can match the request and can
-          // return that now.
-          return newest;
-        } else {
-          // There is an upgrade file dest in either the file or the search
-          // criteria but not in the other.  Therefore this cannot be a
-          // match.
-          newest = NULL;
-        }
+//------------------------------------------------------------------------------
+// Image catalog
+
+static const int8u* imageDestination(const EmberAfOtaHeader* header)
+{
+  return (headerHasUpgradeFileDest(header)
+          ? header->upgradeFileDestination
+          : emberAfInvalidImageId.deviceSpecificFileEui64);
+}
+
+static int16u shelfHash(int16u manufacturerId,
+                        int16u imageTypeId,
+                        const int8u* eui64)
+{
+  int32u hash = ((int32u)manufacturerId << 16) | imageTypeId;
+  int8u i;
+  for (i = 0; i < EUI64_SIZE; i++) {
+    hash = (hash ^ eui64[i]) * 0x01000193UL;
+  }
+  return (int16u)((hash * 0x9E3779B1UL) >> 16);
+}
+
+// Returns the slot holding the matching shelf, or the empty slot where it
+// belongs.  The table must have at least one empty slot.
+static int16u shelfSlot(const ShelfIndex* index,
+                        int16u manufacturerId,
+                        int16u imageTypeId,
+                        const int8u* eui64)
+{
+  int16u mask = index->size - 1;
+  int16u slot = shelfHash(manufacturerId, imageTypeId, eui64) & mask;
+  ImageShelf* shelf;
+  while ((shelf = index->slots[slot]) != NULL) {
+    if (shelf->manufacturerId == manufacturerId
+        && shelf->imageTypeId == imageTypeId
+        && doEui64sMatch(shelf->upgradeFileDestination, eui64)) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+static boolean growShelfIndex(ShelfIndex* index)
+{
+  ShelfIndex bigger;
+  int16u i;
+  bigger.size = (index->size == 0
+                 ? SHELF_INDEX_INITIAL_SIZE
+                 : index->size * 2);
+  bigger.count = index->count;
+  if (bigger.size < index->size) {
+    return FALSE;
+  }
+  bigger.slots = myMalloc(bigger.size * sizeof(ImageShelf*),
+                          "growShelfIndex(): slots");
+  if (bigger.slots == NULL) {
+    return FALSE;
+  }
+  MEMSET(bigger.slots, 0, bigger.size * sizeof(ImageShelf*));
+  for (i = 0; i < index->size; i++) {
+    ImageShelf* shelf = index->slots[i];
+    if (shelf != NULL) {
+      bigger.slots[shelfSlot(&bigger,
+                             shelf->manufacturerId,
+                             shelf->imageTypeId,
+                             shelf->upgradeFileDestination)] = shelf;
+    }
+  }
+  if (index->slots != NULL) {
+    myFree(index->slots);
+  }
+  *index = bigger;
+  return TRUE;
+}
+
+static ImageShelf* findShelf(ShelfIndex* index,
+                             int16u manufacturerId,
+                             int16u imageTypeId,
+                             const int8u* eui64,
+                             boolean create)
+{
+  ImageShelf* shelf;
+  int16u slot;
+  if (index->size != 0) {
+    slot = shelfSlot(index, manufacturerId, imageTypeId, eui64);
+    if (index->slots[slot] != NULL || !create) {
+      return index->slots[slot];
+    }
+  } else if (!create) {
+    return NULL;
+  }
+
+  // Keep the table at most half full.
+  if ((index->count + 1) * 2 > index->size) {
+    if (!growShelfIndex(index)) {
+      return NULL;
+    }
+  }
+  shelf = myMalloc(sizeof(ImageShelf), "findShelf(): shelf");
+  if (shelf == NULL) {
+    return NULL;
+  }
+  MEMSET(shelf, 0, sizeof(ImageShelf));
+  shelf->manufacturerId = manufacturerId;
+  shelf->imageTypeId = imageTypeId;
+  MEMCOPY(shelf->upgradeFileDestination, eui64, EUI64_SIZE);
+  index->slots[shelfSlot(index, manufacturerId, imageTypeId, eui64)] = shelf;
+  index->count++;
+  return shelf;
+}
+
+// Returns the index of the first image with a version of at least 'version'.
+static int16u shelfLowerBound(const ImageShelf* shelf, int32u version)
+{
+  int16u low = 0;
+  int16u high = shelf->count;
+  while (low < high) {
+    int16u middle = low + (high - low) / 2;
+    if (shelf->images[middle]->header->firmwareVersion < version) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+static boolean reserveShelfSpace(ImageShelf* shelf)
+{
+  OtaImage** images;
+  int16u capacity;
+  if (shelf->count < shelf->capacity) {
+    return TRUE;
+  }
+  capacity = (shelf->capacity == 0
+              ? SHELF_INITIAL_CAPACITY
+              : shelf->capacity * 2);
+  images = myMalloc(capacity * sizeof(OtaImage*), "reserveShelfSpace()");
+  if (images == NULL) {
+    return FALSE;
+  }
+  if (shelf->images != NULL) {
+    MEMCOPY(images, shelf->images, shelf->count * sizeof(OtaImage*));
+    myFree(shelf->images);
+  }
+  shelf->images = images;
+  shelf->capacity = capacity;
+  return TRUE;
+}
+
+// New images go at the end of the image list, so they are placed after any
+// image of the same version.
+static void shelfInsert(ImageShelf* shelf, OtaImage* image)
+{
+  int32u version = image->header->firmwareVersion;
+  int16u index = shelfLowerBound(shelf, version);
+  while (index < shelf->count
+         && shelf->images[index]->header->firmwareVersion == version) {
+    index++;
+  }
+  memmove(&shelf->images[index + 1],
+          &shelf->images[index],
+          (shelf->count - index) * sizeof(OtaImage*));
+  shelf->images[index] = image;
+  shelf->count++;
+}
+
+static void shelfRemove(ImageShelf* shelf, OtaImage* image)
+{
+  int16u index = shelfLowerBound(shelf, image->header->firmwareVersion);
+  while (index < shelf->count && shelf->images[index] != image) {
+    index++;
+  }
+  if (index < shelf->count) {
+    shelf->count--;
+    memmove(&shelf->images[index],
+            &shelf->images[index + 1],
+            (shelf->count - index) * sizeof(OtaImage*));
+  }
+}
+
+// Space is reserved on both shelves before either is changed so that a
+// failed allocation leaves the catalog as it was.
+static boolean addImageToCatalog(OtaImage* image)
+{
+  const EmberAfOtaHeader* header = image->header;
+  ImageShelf* family = findShelf(&familyIndex,
+                                 header->manufacturerId,
+                                 header->imageTypeId,
+                                 emberAfInvalidImageId.deviceSpecificFileEui64,
+                                 TRUE);
+  ImageShelf* destination = findShelf(&destinationIndex,
+                                      header->manufacturerId,
+                                      header->imageTypeId,
+                                      imageDestination(header),
+                                      TRUE);
+  if (family == NULL
+      || destination == NULL
+      || !reserveShelfSpace(family)
+      || !reserveShelfSpace(destination)) {
+    return FALSE;
+  }
+  shelfInsert(family, image);
+  shelfInsert(destination, image);
+  return TRUE;
+}
+
+static void removeImageFromCatalog(OtaImage* image)
+{
+  const EmberAfOtaHeader* header = image->header;
+  ImageShelf* shelf = findShelf(&familyIndex,
+                                header->manufacturerId,
+                                header->imageTypeId,
+                                emberAfInvalidImageId.deviceSpecificFileEui64,
+                                FALSE);
+  if (shelf != NULL) {
+    shelfRemove(shelf, image);
+  }
+  shelf = findShelf(&destinationIndex,
+                    header->manufacturerId,
+                    header->imageTypeId,
+                    imageDestination(header),
+                    FALSE);
+  if (shelf != NULL) {
+    shelfRemove(shelf, image);
+  }
+}
+
+static void freeShelfIndex(ShelfIndex* index)
+{
+  int16u i;
+  for (i = 0; i < index->size; i++) {
+    ImageShelf* shelf = index->slots[i];
+    if (shelf != NULL) {
+      if (shelf->images != NULL) {
+        myFree(shelf->images);
       }
+      myFree(shelf);
     }
-    ptr = (OtaImage*)ptr->next;
   }
-  return newest;
+  if (index->slots != NULL) {
+    myFree(index->slots);
+  }
+  index->slots = NULL;
+  index->size = 0;
+  index->count = 0;
+}
+
+static void freeCatalog(void)
+{
+  freeShelfIndex(&familyIndex);
+  freeShelfIndex(&destinationIndex);
 }
 
 static EmberAfOtaImageId getIteratorImageId(void)
@@ -1449,6 +1993,242 @@ static EmberAfOtaImageId getIteratorImageId(void)
   return emAfOtaStorageGetImageIdFromHeader(iterator->header);
 }
 
+//------------------------------------------------------------------------------
+// Directory watcher
+
+#if defined(WATCH_STORAGE_DIRECTORY)
+
+// Images must be replaced by renaming a complete file into the directory
+// (IN_MOVED_TO), never by rewriting them in place; see the top of this file.
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)
+
+static void startWatchingDirectory(void)
+{
+  watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (watchFd < 0) {
+    error("Could not watch storage directory: %s\n", strerror(errno));
+    watchFd = INVALID_FD;
+    return;
+  }
+  if (inotify_add_watch(watchFd, storageDevice, WATCH_EVENTS | IN_ONLYDIR) < 0) {
+    error("Could not watch storage directory '%s': %s\n",
+          storageDevice,
+          strerror(errno));
+    close(watchFd);
+    watchFd = INVALID_FD;
+    return;
+  }
+  debug(config.fileDebug, "Watching storage directory '%s'\n", storageDevice);
+#if !defined(EMBER_AF_PLUGIN_GATEWAY)
+  emberAfEventControlSetDelay(&emberAfPluginOtaStoragePosixFilesystemWatchEventControl,
+                              WATCH_POLL_INTERVAL_MS);
+#endif
+}
+
+static void stopWatchingDirectory(void)
+{
+  if (watchFd != INVALID_FD) {
+    close(watchFd);
+#if defined(EMBER_AF_PLUGIN_GATEWAY)
+    gatewayWatchedFdClosed(watchFd);
+#endif
+    watchFd = INVALID_FD;
+  }
+  emberEventControlSetInactive(emberAfPluginOtaStoragePosixFilesystemWatchEventControl);
+}
+
+// Builds the full path of a file in the storage directory.  Returns FALSE
+// for files that the storage does not manage.
+static boolean watchedFilePath(const char* name, char* path)
+{
+  if (strlen(storageDevice) + strlen(name) + 1 > MAX_FILEPATH_LENGTH
+      || 0 == strcmp(name, tempStorageFile)
+      || (config.ignoreFilesWithUnderscorePrefix && name[0] == '_')) {
+    return FALSE;
+  }
+  sprintf(path, "%s%s", storageDevice, name);
+  return TRUE;
+}
+
+static boolean isOtaFile(const char* path)
+{
+  struct stat statInfo;
+  FILE* fileHandle;
+  boolean isOta;
+  if (0 != stat(path, &statInfo) || !S_ISREG(statInfo.st_mode)) {
+    return FALSE;
+  }
+  fileHandle = fopen(path, "rb");
+  if (fileHandle == NULL) {
+    return FALSE;
+  }
+  isOta = checkMagicNumber(fileHandle, FALSE);
+  fclose(fileHandle);
+  return isOta;
+}
+
+static boolean isSameImage(const EmberAfOtaHeader* first,
+                           const EmberAfOtaHeader* second)
+{
+  return (first->manufacturerId == second->manufacturerId
+          && first->imageTypeId == second->imageTypeId
+          && first->firmwareVersion == second->firmwareVersion
+          && doEui64sMatch(imageDestination(first), imageDestination(second)));
+}
+
+static void imageFileRemoved(const char* name)
+{
+  char path[MAX_FILEPATH_LENGTH + 1];
+  OtaImage* image;
+  if (!watchedFilePath(name, path)) {
+    return;
+  }
+  image = findImageByFilename(path);
+  if (image != NULL) {
+    if (config.printFileDiscoveryOrRemoval) {
+      note("OTA file '%s' removed.\n", image->filenameStart);
+    }
+    removeImage(image);
+  }
+}
+
+// A file that still has the same image ID keeps its place in the list and
+// the catalog; only its header and mapping are swapped.  Otherwise the old
+// entry is retired and the file is added as if it were new.
+static void imageFileChanged(const char* name)
+{
+  char path[MAX_FILEPATH_LENGTH + 1];
+  OtaImage* existing;
+  OtaImage* fresh;
+  OtaImage swap;
+  if (!watchedFilePath(name, path)) {
+    return;
+  }
+  existing = findImageByFilename(path);
+  fresh = (isOtaFile(path) ? loadImageFile(path) : NULL);
+  if (fresh == NULL) {
+    if (existing != NULL) {
+      if (config.printFileDiscoveryOrRemoval) {
+        note("OTA file '%s' is no longer valid.  Removed.\n",
+             existing->filenameStart);
+      }
+      removeImage(existing);
+    }
+    return;
+  }
+
+  if (existing != NULL && isSameImage(existing->header, fresh->header)) {
+    mapImageFile(fresh);
+    swap = *existing;
+    existing->header = fresh->header;
+    existing->fileSize = fresh->fileSize;
+    existing->mapping = fresh->mapping;
+    existing->mappingLength = fresh->mappingLength;
+    fresh->header = swap.header;
+    fresh->mapping = swap.mapping;
+    fresh->mappingLength = swap.mappingLength;
+    freeOtaImage(fresh);
+    if (config.printFileDiscoveryOrRemoval) {
+      note("OTA file '%s' updated.\n", existing->filenameStart);
+    }
+    return;
+  }
+
+  if (existing != NULL) {
+    removeImage(existing);
+  }
+  if (config.printFileDiscoveryOrRemoval) {
+    note("Found OTA file '%s'\n", name);
+  }
+  fresh = insertImage(fresh, TRUE);
+  if (config.fileAddedHandler != NULL
+      && fresh != NULL) {
+    (config.fileAddedHandler)(fresh->header);
+  }
+}
+
+// inotify dropped events, so compare every file with the list instead.
+static void rescanWatchedDirectory(void)
+{
+  OtaImage* image = imageListFirst;
+  struct stat statInfo;
+  struct dirent* dirEntry;
+  DIR* dir;
+
+  while (image != NULL) {
+    OtaImage* next = (OtaImage*)image->next;
+    if (0 != stat(image->filepath, &statInfo)) {
+      removeImage(image);
+    }
+    image = next;
+  }
+
+  dir = opendir(storageDevice);
+  if (dir == NULL) {
+    error("Could not open directory: %s\n", strerror(errno));
+    return;
+  }
+  for (dirEntry = readdir(dir); dirEntry != NULL; dirEntry = readdir(dir)) {
+    imageFileChanged(dirEntry->d_name);
+  }
+  closedir(dir);
+}
+
+static void processWatchEvents(void)
+{
+  // Aligned for struct inotify_event.
+  int32u buffer[1024];
+  ssize_t length;
+  boolean overflowed = FALSE;
+
+  while ((length = read(watchFd, buffer, sizeof(buffer))) > 0) {
+    char* ptr = (char*)buffer;
+    while (ptr < (char*)buffer + length) {
+      struct inotify_event* event = (struct inotify_event*)ptr;
+      ptr += sizeof(struct inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        overflowed = TRUE;
+      } else if (event->len == 0 || (event->mask & IN_ISDIR)) {
+        // Not a file in the directory.
+      } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+        imageFileChanged(event->name);
+      } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        imageFileRemoved(event->name);
+      }
+    }
+  }
+  if (overflowed) {
+    note("Too many storage directory changes at once.  Rescanning.\n");
+    rescanWatchedDirectory();
+  }
+}
+
+// Returns the time until the next of the remaining retired images expires,
+// or 0 if there are none left.
+static int32u freeRetiredImages(boolean expiredOnly)
+{
+  int32u now = halCommonGetInt32uMillisecondTick();
+  int32u msToNextExpiry = 0;
+  OtaImage** link = &retiredImages;
+  while (*link != NULL) {
+    OtaImage* image = *link;
+    int32u idleMs = elapsedTimeInt32u(image->lastReadMs, now);
+    if (!expiredOnly || idleMs >= RETIRED_IMAGE_TIMEOUT_MS) {
+      *link = (OtaImage*)image->next;
+      freeOtaImage(image);
+    } else {
+      if (msToNextExpiry == 0
+          || RETIRED_IMAGE_TIMEOUT_MS - idleMs < msToNextExpiry) {
+        msToNextExpiry = RETIRED_IMAGE_TIMEOUT_MS - idleMs;
+      }
+      link = (OtaImage**)&image->next;
+    }
+  }
+  return msToNextExpiry;
+}
+
+#endif // WATCH_STORAGE_DIRECTORY
+
 //------------------------------------------------------------------------------
 // DEBUG
 
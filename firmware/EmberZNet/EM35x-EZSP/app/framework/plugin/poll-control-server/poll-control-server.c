@@ -31,7 +31,7 @@ static EmberAfPollControlState *stateFromBindingIndex(int8u index)
     return NULL;
   }
 
-  status = emberGetBinding(index, &entry);
+  status = emberAfGetBinding(index, &entry);
   if (status != EMBER_SUCCESS) {
     return NULL;
   }
@@ -69,7 +69,7 @@ static EmberAfPollControlState *allocateState(int8u index)
     return NULL;
   }
 
-  status = emberGetBinding(index, &entry);
+  status = emberAfGetBinding(index, &entry);
   if (status != EMBER_SUCCESS) {
     return NULL;
   }
@@ -271,7 +271,7 @@ void emberAfPollControlClusterServerTickCallback(int8u endpoint)
   if (!fastPollWait && postFastPollTimeRemaining == 0) {
     for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
       EmberBindingTableEntry binding;
-      EmberStatus status = emberGetBinding(i, &binding);
+      EmberStatus status = emberAfGetBinding(i, &binding);
       if (status == EMBER_SUCCESS
           && binding.type == EMBER_UNICAST_BINDING
           && binding.local == endpoint
@@ -17,7 +17,7 @@ static void add(void);
 EmberCommandEntry emberAfPluginReportingCommands[] = {
   emberCommandEntryAction("print",  print, "", "Print the reporting table"),
   emberCommandEntryAction("clear",  clear, "", "Clear the reporting tabel"),
-  emberCommandEntryAction("remove", remov, "u","Remove an entry from the reporting table"),
+  emberCommandEntryAction("remove", remov, "v","Remove an entry from the reporting table"),
   emberCommandEntryAction("add",    add,   "uvvuuvvw", "Add an entry to the reporting table"),
   emberCommandEntryTerminator(),
 };
@@ -25,11 +25,11 @@ EmberCommandEntry emberAfPluginReportingCommands[] = {
 // plugin reporting print
 static void print(void)
 {
-  int8u i;
+  int16u i;
   for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE ; i++) {
     EmberAfPluginReportingEntry entry;
     emAfPluginReportingGetEntry(i, &entry);
-    emberAfReportingPrint("%x:", i);
+    emberAfReportingPrint("%2x:", i);
     if (entry.endpoint != EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID) {
       emberAfReportingPrint("ep %x clus %2x attr %2x svr %c",
                             entry.endpoint,
@@ -64,10 +64,10 @@ static void clear(void)
   emberAfReportingPrintln("%p 0x%x", "clear", status);
 }
 
-// plugin reporting remove <index:1>
+// plugin reporting remove <index:2>
 static void remov(void)
 {
-  EmberStatus status = emAfPluginReportingRemoveEntry((int8u)emberUnsignedCommandArgument(0));
+  EmberStatus status = emAfPluginReportingRemoveEntry((int16u)emberUnsignedCommandArgument(0));
   emberAfReportingPrintln("%p 0x%x", "remove", status);
 }
 
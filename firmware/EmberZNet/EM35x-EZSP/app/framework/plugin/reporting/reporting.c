@@ -17,12 +17,50 @@
 #define READ_DATA_SIZE 8 // max size if attributes aren't present
 #endif
 
-#define NULL_INDEX 0xFF
+// Report table entries are stored in tokens on SoC platforms.
+#if !defined(EZSP_HOST) && EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE > 0xFF
+  #error "The reporting table is limited to 255 entries on SoC platforms."
+#endif
+
+#define NULL_INDEX 0xFFFF
+
+// Every used entry is chained into a hash table by its attribute, and
+// reported entries that need attention are kept in a min-heap ordered by the
+// time they need it, so that neither attribute changes nor the tick have to
+// look at the whole table.
+#define HASH_BUCKETS EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE
+
+// Reports that would fall due within this many milliseconds are sent early
+// if they can share a frame with reports that are due.  Applications
+// generated before the option existed do not coalesce.
+#ifndef EMBER_AF_PLUGIN_REPORTING_COALESCING_WINDOW_MS
+  #define EMBER_AF_PLUGIN_REPORTING_COALESCING_WINDOW_MS 0
+#endif
 
 static void conditionallySendReport(int8u endpoint, EmberAfClusterId clusterId);
 static void scheduleTick(void);
-static void removeConfiguration(int8u index);
-static void removeConfigurationAndScheduleTick(int8u index);
+static void removeConfiguration(int16u index);
+static void removeConfigurationAndScheduleTick(int16u index);
+static void buildIndex(void);
+static int16u findEntry(const EmberAfPluginReportingEntry *key,
+                        EmberAfPluginReportingEntry *result);
+static int16u findUnusedEntry(EmberAfPluginReportingEntry *result);
+static void setEntry(int16u index, EmberAfPluginReportingEntry *entry);
+static void updateDeadline(int16u index,
+                           const EmberAfPluginReportingEntry *entry,
+                           int32u currentTime);
+static boolean sameReport(const EmberAfPluginReportingEntry *a,
+                          const EmberAfPluginReportingEntry *b);
+static int16u reportHash(const EmberAfPluginReportingEntry *entry);
+static boolean addToReport(int16u index,
+                           const EmberAfPluginReportingEntry *entry,
+                           boolean startReport);
+static void addEarlyEntries(int32u currentTime);
+static void findEarlyEntries(int16u position, int32u limit, int16u *count);
+static int16u reportPayloadLimit(EmberApsFrame *apsFrame);
+static void heapRemove(int16u position);
+static void heapSiftUp(int16u position);
+static void heapSiftDown(int16u position);
 static EmberAfStatus configureReceivedAttribute(const EmberAfClusterCommand *cmd,
                                                 EmberAfAttributeId attributeId,
                                                 int8u mask,
@@ -36,160 +74,325 @@ typedef struct {
   int32u lastReportTime;
   int32u lastReportValue;
   boolean reportableChange;
+  int32u deadline;      // when the entry is next due, if it is in the heap
+  int16u heapIndex;     // position in the heap plus one, or zero
+  int16u nextInBucket;  // next entry in the same hash chain
+  int16u nextDue;       // next entry in the same report, while it is sent
 } EmAfPluginReportingVolatileData;
 static EmAfPluginReportingVolatileData volatileData[EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE];
 
+static int16u buckets[HASH_BUCKETS];
+static boolean indexBuilt = FALSE;
+static int16u heap[EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE];
+static int16u heapCount;
+static int16u earlyEntries[EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE];
+
+// The reports being sent by the tick.  Each holds the due entries for one
+// cluster, chained through nextDue in the order they fell due, and is found
+// by its cluster through its own hash chains.
+typedef struct {
+  int16u first;
+  int16u last;
+  int16u nextInBucket;  // next report in the same hash chain
+} EmAfPluginReportingReport;
+static EmAfPluginReportingReport reports[EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE];
+static int16u reportBuckets[HASH_BUCKETS];
+static int16u reportCount;
+
+#define deadlineBefore(a, b) ((int32s)((a) - (b)) < 0)
+
 #ifdef EZSP_HOST
 static EmberAfPluginReportingEntry table[EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE];
-void emAfPluginReportingGetEntry(int8u index, EmberAfPluginReportingEntry *result)
+void emAfPluginReportingGetEntry(int16u index, EmberAfPluginReportingEntry *result)
 {
   MEMCOPY(result, &table[index], sizeof(EmberAfPluginReportingEntry));
 }
-void emAfPluginReportingSetEntry(int8u index, EmberAfPluginReportingEntry *value)
+void emAfPluginReportingSetEntry(int16u index, EmberAfPluginReportingEntry *value)
 {
   MEMCOPY(&table[index], value, sizeof(EmberAfPluginReportingEntry));
 }
 #else
-void emAfPluginReportingGetEntry(int8u index, EmberAfPluginReportingEntry *result)
+void emAfPluginReportingGetEntry(int16u index, EmberAfPluginReportingEntry *result)
 {
-  halCommonGetIndexedToken(result, TOKEN_REPORT_TABLE, index);
+  halCommonGetIndexedToken(result, TOKEN_REPORT_TABLE, (int8u)index);
 }
-void emAfPluginReportingSetEntry(int8u index, EmberAfPluginReportingEntry *value)
+void emAfPluginReportingSetEntry(int16u index, EmberAfPluginReportingEntry *value)
 {
-  halCommonSetIndexedToken(TOKEN_REPORT_TABLE, index, value);
+  halCommonSetIndexedToken(TOKEN_REPORT_TABLE, (int8u)index, value);
 }
 #endif
 
 void emberAfPluginReportingInitCallback(void)
 {
+  buildIndex();
   scheduleTick();
 }
 
 void emberAfPluginReportingTickEventHandler(void)
 {
-  EmberApsFrame *apsFrame = NULL;
+  EmberApsFrame *apsFrame;
   EmberAfStatus status;
   EmberAfAttributeType dataType;
   int32u currentTime = halCommonGetInt32uMillisecondTick();
-  int16u manufacturerCode;
   int8u readData[READ_DATA_SIZE];
-  int8u i, dataSize;
-  boolean clientToServer;
+  int8u dataSize;
+  int16u i, g, next, limit;
 
-  for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE; i++) {
+  if (!indexBuilt) {
+    buildIndex();
+  }
+
+  // Take the entries that are due off the heap, earliest first, and add each
+  // to the report it goes in.
+  reportCount = 0;
+  while (heapCount != 0
+         && !deadlineBefore(currentTime, volatileData[heap[0]].deadline)) {
     EmberAfPluginReportingEntry entry;
+    i = heap[0];
+    heapRemove(0);
     emAfPluginReportingGetEntry(i, &entry);
+    addToReport(i, &entry, TRUE);
+  }
+  if (reportCount == 0) {
+    scheduleTick();
+    return;
+  }
+  addEarlyEntries(currentTime);
+
+  // Entries are only due if they are active reported attributes and either
+  // a reportable change has occurred and the minimum interval has elapsed or
+  // the maximum interval is set and has elapsed.  Each report holds all of
+  // the due attributes of one cluster, as many as fit in a frame to every
+  // destination bound to the cluster.
+  for (g = 0; g < reportCount; g++) {
+    EmberAfPluginReportingEntry first;
+    EmAfClusterReader reader;
+    emAfPluginReportingGetEntry(reports[g].first, &first);
+    reportBuckets[reportHash(&first)] = NULL_INDEX;
+    emAfFindClusterForRead(&reader,
+                           first.endpoint,
+                           first.clusterId,
+                           first.mask,
+                           first.manufacturerCode);
+    apsFrame = NULL;
+    limit = 0;
+
+    for (i = reports[g].first; i != NULL_INDEX; i = next) {
+      EmberAfPluginReportingEntry entry;
+      next = volatileData[i].nextDue;
+      emAfPluginReportingGetEntry(i, &entry);
 
-    // We will only send reports for active reported attributes and only if a
-    // reportable change has occurred and the minimum interval has elapsed or
-    // if the maximum interval is set and has elapsed.
-    if (entry.endpoint == EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID
-        || entry.direction != EMBER_ZCL_REPORTING_DIRECTION_REPORTED
-        || (currentTime - volatileData[i].lastReportTime
-            < entry.data.reported.minInterval * MILLISECOND_TICKS_PER_SECOND)
-        || (!volatileData[i].reportableChange
-            && (currentTime - volatileData[i].lastReportTime
-                < (entry.data.reported.maxInterval
-                   * MILLISECOND_TICKS_PER_SECOND)))) {
-      continue;
-    }
+      status = emAfReadClusterAttribute(&reader,
+                                        entry.attributeId,
+                                        (int8u *)&readData,
+                                        READ_DATA_SIZE,
+                                        &dataType);
+      if (status != EMBER_ZCL_STATUS_SUCCESS) {
+        emberAfReportingPrintln("ERR: reading cluster 0x%2x attribute 0x%2x: 0x%x",
+                                entry.clusterId,
+                                entry.attributeId,
+                                status);
+        updateDeadline(i, &entry, currentTime);
+        continue;
+      }
 
-    status = emAfReadAttribute(entry.endpoint,
-                               entry.clusterId,
-                               entry.attributeId,
-                               entry.mask,
-                               entry.manufacturerCode,
-                               (int8u *)&readData,
-                               READ_DATA_SIZE,
-                               &dataType);
-    if (status != EMBER_ZCL_STATUS_SUCCESS) {
-      emberAfReportingPrintln("ERR: reading cluster 0x%2x attribute 0x%2x: 0x%x",
-                              entry.clusterId,
-                              entry.attributeId,
-                              status);
-      continue;
-    }
+      dataSize = (emberAfIsThisDataTypeAStringType(dataType)
+                  ? emberAfStringLength(readData) + 1
+                  : emberAfGetDataSize(dataType));
 
-    // If we have already started a report for a different attribute or
-    // destination, send it and create a new one.
-    if (apsFrame != NULL &&
-        !(entry.endpoint == apsFrame->sourceEndpoint
-          && entry.clusterId == apsFrame->clusterId
-          && emberAfClusterIsClient(&entry) == clientToServer
-          && entry.manufacturerCode == manufacturerCode)) {
-      conditionallySendReport(apsFrame->sourceEndpoint, apsFrame->clusterId);
-      apsFrame = NULL;
-    }
+      // If the attribute does not fit in the report we have started, send
+      // that one and start another.
+      if (apsFrame != NULL
+          && appResponseLength + 3 + dataSize > limit) {
+        conditionallySendReport(apsFrame->sourceEndpoint, apsFrame->clusterId);
+        apsFrame = NULL;
+      }
 
-    // If we haven't made the message header, make it.
-    if (apsFrame == NULL) {
-      apsFrame = emberAfGetCommandApsFrame();
-      clientToServer = emberAfClusterIsClient(&entry);
-      // The manufacturer-specfic version of the fill API only creates a
-      // manufacturer-specfic command if the manufacturer code is set.  For
-      // non-manufacturer-specfic reports, the manufacturer code is unset, so
-      // we can get away with using this API for both cases.
-      emberAfFillExternalManufacturerSpecificBuffer((clientToServer
-                                                     ? (ZCL_PROFILE_WIDE_COMMAND
-                                                        | ZCL_FRAME_CONTROL_CLIENT_TO_SERVER
-                                                        | EMBER_AF_DEFAULT_RESPONSE_POLICY_REQUESTS)
-                                                     : (ZCL_PROFILE_WIDE_COMMAND
-                                                        | ZCL_FRAME_CONTROL_SERVER_TO_CLIENT
-                                                        | EMBER_AF_DEFAULT_RESPONSE_POLICY_REQUESTS)),
-                                                    entry.clusterId,
-                                                    entry.manufacturerCode,
-                                                    ZCL_REPORT_ATTRIBUTES_COMMAND_ID,
-                                                    "");
-      apsFrame->sourceEndpoint = entry.endpoint;
-      apsFrame->options = EMBER_AF_DEFAULT_APS_OPTIONS;
-      manufacturerCode = entry.manufacturerCode;
-    }
+      // If we haven't made the message header, make it.
+      if (apsFrame == NULL) {
+        apsFrame = emberAfGetCommandApsFrame();
+        // The manufacturer-specfic version of the fill API only creates a
+        // manufacturer-specfic command if the manufacturer code is set.  For
+        // non-manufacturer-specfic reports, the manufacturer code is unset, so
+        // we can get away with using this API for both cases.
+        emberAfFillExternalManufacturerSpecificBuffer((emberAfClusterIsClient(&entry)
+                                                       ? (ZCL_PROFILE_WIDE_COMMAND
+                                                          | ZCL_FRAME_CONTROL_CLIENT_TO_SERVER
+                                                          | EMBER_AF_DEFAULT_RESPONSE_POLICY_REQUESTS)
+                                                       : (ZCL_PROFILE_WIDE_COMMAND
+                                                          | ZCL_FRAME_CONTROL_SERVER_TO_CLIENT
+                                                          | EMBER_AF_DEFAULT_RESPONSE_POLICY_REQUESTS)),
+                                                      entry.clusterId,
+                                                      entry.manufacturerCode,
+                                                      ZCL_REPORT_ATTRIBUTES_COMMAND_ID,
+                                                      "");
+        apsFrame->sourceEndpoint = entry.endpoint;
+        apsFrame->options = EMBER_AF_DEFAULT_APS_OPTIONS;
+        // Every frame of a report goes to the same bindings.
+        if (limit == 0) {
+          limit = reportPayloadLimit(apsFrame);
+        }
+      }
 
-    // Payload is [attribute id:2] [type:1] [data:N].
-    emberAfPutInt16uInResp(entry.attributeId);
-    emberAfPutInt8uInResp(dataType);
+      // Payload is [attribute id:2] [type:1] [data:N].
+      emberAfPutInt16uInResp(entry.attributeId);
+      emberAfPutInt8uInResp(dataType);
 
-    dataSize = (emberAfIsThisDataTypeAStringType(dataType)
-                ? emberAfStringLength(readData) + 1
-                : emberAfGetDataSize(dataType));
 #if (BIGENDIAN_CPU)
-    if (isThisDataTypeSentLittleEndianOTA(dataType)) {
-      int8u i;
-      for (i = 0; i < dataSize; i++) {
-        emberAfPutInt8uInResp(readData[dataSize - i - 1]);
+      if (isThisDataTypeSentLittleEndianOTA(dataType)) {
+        int8u n;
+        for (n = 0; n < dataSize; n++) {
+          emberAfPutInt8uInResp(readData[dataSize - n - 1]);
+        }
+      } else {
+        emberAfPutBlockInResp(readData, dataSize);
       }
-    } else {
-      emberAfPutBlockInResp(readData, dataSize);
-    }
 #else
-    emberAfPutBlockInResp(readData, dataSize);
+      emberAfPutBlockInResp(readData, dataSize);
 #endif
 
-    // Store the last reported time and value so that we can track intervals
-    // and changes.  We only track changes for data types that are small enough
-    // for us to compare.
-    volatileData[i].reportableChange = FALSE;
-    volatileData[i].lastReportTime = currentTime;
-    if (dataSize <= sizeof(volatileData[i].lastReportValue)) {
-      volatileData[i].lastReportValue = 0;
+      // Store the last reported time and value so that we can track intervals
+      // and changes.  We only track changes for data types that are small
+      // enough for us to compare.
+      volatileData[i].reportableChange = FALSE;
+      volatileData[i].lastReportTime = currentTime;
+      if (dataSize <= sizeof(volatileData[i].lastReportValue)) {
+        volatileData[i].lastReportValue = 0;
 #if (BIGENDIAN_CPU)
-      MEMCOPY(((int8u *)&volatileData[i].lastReportValue
-               + sizeof(volatileData[i].lastReportValue)
-               - dataSize),
-              readData,
-              dataSize);
+        MEMCOPY(((int8u *)&volatileData[i].lastReportValue
+                 + sizeof(volatileData[i].lastReportValue)
+                 - dataSize),
+                readData,
+                dataSize);
 #else
-      MEMCOPY(&volatileData[i].lastReportValue, readData, dataSize);
+        MEMCOPY(&volatileData[i].lastReportValue, readData, dataSize);
 #endif
+      }
+      updateDeadline(i, &entry, currentTime);
     }
-  }
 
-  if (apsFrame != NULL) {
-    conditionallySendReport(apsFrame->sourceEndpoint, apsFrame->clusterId);
+    if (apsFrame != NULL) {
+      conditionallySendReport(apsFrame->sourceEndpoint, apsFrame->clusterId);
+    }
   }
   scheduleTick();
 }
 
+// Returns TRUE if two reported entries go in the same report.
+static boolean sameReport(const EmberAfPluginReportingEntry *a,
+                          const EmberAfPluginReportingEntry *b)
+{
+  return (a->endpoint == b->endpoint
+          && a->clusterId == b->clusterId
+          && emberAfClusterIsClient(a) == emberAfClusterIsClient(b)
+          && a->manufacturerCode == b->manufacturerCode);
+}
+
+static int16u reportHash(const EmberAfPluginReportingEntry *entry)
+{
+  int32u hash = entry->endpoint;
+  hash = hash * 31 + entry->clusterId;
+  hash = hash * 31 + emberAfClusterIsClient(entry);
+  hash = hash * 31 + entry->manufacturerCode;
+  return (int16u)(hash % HASH_BUCKETS);
+}
+
+// Adds a due entry to the end of the report it goes in.  If there is no such
+// report yet, one is started if allowed.  Returns FALSE if the entry was not
+// added.
+static boolean addToReport(int16u index,
+                           const EmberAfPluginReportingEntry *entry,
+                           boolean startReport)
+{
+  int16u bucket = reportHash(entry);
+  int16u g;
+  for (g = reportBuckets[bucket]; g != NULL_INDEX; g = reports[g].nextInBucket) {
+    EmberAfPluginReportingEntry first;
+    emAfPluginReportingGetEntry(reports[g].first, &first);
+    if (sameReport(entry, &first)) {
+      volatileData[reports[g].last].nextDue = index;
+      reports[g].last = index;
+      volatileData[index].nextDue = NULL_INDEX;
+      return TRUE;
+    }
+  }
+  if (!startReport) {
+    return FALSE;
+  }
+  g = reportCount++;
+  reports[g].first = index;
+  reports[g].last = index;
+  reports[g].nextInBucket = reportBuckets[bucket];
+  reportBuckets[bucket] = g;
+  volatileData[index].nextDue = NULL_INDEX;
+  return TRUE;
+}
+
+// Adds the entries that would fall due within the coalescing window to the
+// reports of the due entries they belong with, if their minimum intervals
+// have passed.
+static void addEarlyEntries(int32u currentTime)
+{
+  int16u candidates = 0;
+  int16u j;
+
+  if (EMBER_AF_PLUGIN_REPORTING_COALESCING_WINDOW_MS == 0) {
+    return;
+  }
+  findEarlyEntries(0,
+                   currentTime + EMBER_AF_PLUGIN_REPORTING_COALESCING_WINDOW_MS,
+                   &candidates);
+
+  for (j = 0; j < candidates; j++) {
+    EmberAfPluginReportingEntry entry;
+    int16u i = earlyEntries[j];
+    emAfPluginReportingGetEntry(i, &entry);
+    if (currentTime - volatileData[i].lastReportTime
+        >= entry.data.reported.minInterval * MILLISECOND_TICKS_PER_SECOND
+        && addToReport(i, &entry, FALSE)) {
+      heapRemove(volatileData[i].heapIndex - 1);
+    }
+  }
+}
+
+// Appends the entries in the heap, from the given position down, whose
+// deadlines are no later than the limit.
+static void findEarlyEntries(int16u position, int32u limit, int16u *count)
+{
+  if (position >= heapCount
+      || deadlineBefore(limit, volatileData[heap[position]].deadline)) {
+    return;
+  }
+  earlyEntries[(*count)++] = heap[position];
+  findEarlyEntries(2 * position + 1, limit, count);
+  findEarlyEntries(2 * position + 2, limit, count);
+}
+
+// Returns the most a report can hold for every destination bound to its
+// cluster.
+static int16u reportPayloadLimit(EmberApsFrame *apsFrame)
+{
+  int16u limit = EMBER_AF_RESPONSE_BUFFER_LEN;
+  int8u i;
+  for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
+    EmberBindingTableEntry binding;
+    if (emberAfGetBinding(i, &binding) != EMBER_SUCCESS) {
+      break;
+    }
+    if (binding.type == EMBER_UNICAST_BINDING
+        && binding.local == apsFrame->sourceEndpoint
+        && binding.clusterId == apsFrame->clusterId) {
+      int8u max = emberAfMaximumApsPayloadLength(EMBER_OUTGOING_VIA_BINDING,
+                                                 i,
+                                                 apsFrame);
+      if (max < limit) {
+        limit = max;
+      }
+    }
+  }
+  return limit;
+}
+
 static void conditionallySendReport(int8u endpoint, EmberAfClusterId clusterId)
 {
   if (emberAfIsDeviceEnabled(endpoint)
@@ -377,8 +580,7 @@ boolean emberAfReadReportingConfigurationCommandCallback(const EmberAfClusterCom
     EmberAfAttributeMetadata *metadata;
     EmberAfPluginReportingEntry entry;
     EmberAfReportingDirection direction;
-    int8u i;
-    boolean found = FALSE;
+    boolean found;
 
     direction = emberAfGetInt8u(cmd->buffer, bufIndex, cmd->bufLen);
     bufIndex++;
@@ -411,21 +613,15 @@ boolean emberAfReadReportingConfigurationCommandCallback(const EmberAfClusterCom
     // 075123r03 seems to suggest that SUCCESS is returned even if reporting
     // isn't configured for the requested attribute.  The individual fields
     // of the response for this attribute get populated with defaults.
-    for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE; i++) {
-      emAfPluginReportingGetEntry(i, &entry);
-      if (entry.direction == direction
-          && entry.endpoint == cmd->apsFrame->destinationEndpoint
-          && entry.clusterId == cmd->apsFrame->clusterId
-          && entry.attributeId == attributeId
-          && entry.mask == mask
-          && entry.manufacturerCode == cmd->mfgCode
-          && (entry.direction == EMBER_ZCL_REPORTING_DIRECTION_REPORTED
-              || (entry.data.received.source == cmd->source
-                  && entry.data.received.endpoint == cmd->apsFrame->sourceEndpoint))) {
-        found = TRUE;
-        break;
-      }
-    }
+    entry.direction = direction;
+    entry.endpoint = cmd->apsFrame->destinationEndpoint;
+    entry.clusterId = cmd->apsFrame->clusterId;
+    entry.attributeId = attributeId;
+    entry.mask = mask;
+    entry.manufacturerCode = cmd->mfgCode;
+    entry.data.received.source = cmd->source;
+    entry.data.received.endpoint = cmd->apsFrame->sourceEndpoint;
+    found = (findEntry(&entry, &entry) != NULL_INDEX);
     emberAfPutInt8uInResp(EMBER_ZCL_STATUS_SUCCESS);
     emberAfPutInt8uInResp(direction);
     emberAfPutInt16uInResp(attributeId);
@@ -451,7 +647,7 @@ boolean emberAfReadReportingConfigurationCommandCallback(const EmberAfClusterCom
 
 EmberStatus emberAfClearReportTableCallback(void)
 {
-  int8u i;
+  int16u i;
   for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE; i++) {
     removeConfiguration(i);
   }
@@ -459,7 +655,7 @@ EmberStatus emberAfClearReportTableCallback(void)
   return EMBER_SUCCESS;
 }
 
-EmberStatus emAfPluginReportingRemoveEntry(int8u index)
+EmberStatus emAfPluginReportingRemoveEntry(int16u index)
 {
   EmberStatus status = EMBER_INDEX_OUT_OF_RANGE;
   if (index < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE) {
@@ -477,33 +673,32 @@ void emberAfReportingAttributeChangeCallback(int8u endpoint,
                                              EmberAfAttributeType type,
                                              int8u *data)
 {
-  int32u currentTime = halCommonGetInt32uMillisecondTick();
-  int8u i;
-  for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE; i++) {
-    EmberAfPluginReportingEntry entry;
-    emAfPluginReportingGetEntry(i, &entry);
-    if (entry.direction == EMBER_ZCL_REPORTING_DIRECTION_REPORTED
-        && entry.endpoint == endpoint
-        && entry.clusterId == clusterId
-        && entry.attributeId == attributeId
-        && entry.mask == mask
-        && entry.manufacturerCode == manufacturerCode) {
-      // If we are reporting this particular attribute, we only care whether
-      // the new value meets the reportable change criteria.  If it does, we
-      // mark the entry as ready to report and reschedule the tick.  Whether
-      // the tick will be scheduled for immediate or delayed execution depends
-      // on the minimum reporting interval.  This is handled in the scheduler.
-      int32u difference = emberAfGetDifference(data,
-                                               volatileData[i].lastReportValue,
-                                               emberAfGetDataSize(type));
-      int8u analogOrDiscrete = emberAfGetAttributeAnalogOrDiscreteType(type);
-      if ((analogOrDiscrete == EMBER_AF_DATA_TYPE_DISCRETE && difference != 0)
-          || (analogOrDiscrete == EMBER_AF_DATA_TYPE_ANALOG
-              && entry.data.reported.reportableChange <= difference)) {
-        volatileData[i].reportableChange = TRUE;
-        scheduleTick();
-      }
-      break;
+  EmberAfPluginReportingEntry entry;
+  int16u i;
+
+  entry.direction = EMBER_ZCL_REPORTING_DIRECTION_REPORTED;
+  entry.endpoint = endpoint;
+  entry.clusterId = clusterId;
+  entry.attributeId = attributeId;
+  entry.mask = mask;
+  entry.manufacturerCode = manufacturerCode;
+  i = findEntry(&entry, &entry);
+  if (i != NULL_INDEX) {
+    // If we are reporting this particular attribute, we only care whether
+    // the new value meets the reportable change criteria.  If it does, we
+    // mark the entry as ready to report and reschedule the tick.  Whether
+    // the tick will be scheduled for immediate or delayed execution depends
+    // on the minimum reporting interval.  This is handled in the scheduler.
+    int32u difference = emberAfGetDifference(data,
+                                             volatileData[i].lastReportValue,
+                                             emberAfGetDataSize(type));
+    int8u analogOrDiscrete = emberAfGetAttributeAnalogOrDiscreteType(type);
+    if ((analogOrDiscrete == EMBER_AF_DATA_TYPE_DISCRETE && difference != 0)
+        || (analogOrDiscrete == EMBER_AF_DATA_TYPE_ANALOG
+            && entry.data.reported.reportableChange <= difference)) {
+      volatileData[i].reportableChange = TRUE;
+      updateDeadline(i, &entry, halCommonGetInt32uMillisecondTick());
+      scheduleTick();
     }
   }
 }
@@ -511,28 +706,12 @@ void emberAfReportingAttributeChangeCallback(int8u endpoint,
 static void scheduleTick(void)
 {
   int32u delay = MAX_INT32U_VALUE;
-  int32u currentTime = halCommonGetInt32uMillisecondTick();
-  int8u i;
-  for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE; i++) {
-    EmberAfPluginReportingEntry entry;
-    emAfPluginReportingGetEntry(i, &entry);
-    if (entry.endpoint != EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID
-        && entry.direction == EMBER_ZCL_REPORTING_DIRECTION_REPORTED) {
-      int32u minInterval = (entry.data.reported.minInterval
-                            * MILLISECOND_TICKS_PER_SECOND);
-      int32u elapsed = currentTime - volatileData[i].lastReportTime;
-      int32u remaining = MAX_INT32U_VALUE;
-      if (volatileData[i].reportableChange) {
-        remaining = (minInterval < elapsed ? 0 : minInterval - elapsed);
-      } else if (entry.data.reported.maxInterval != 0x0000) {
-        remaining = (entry.data.reported.maxInterval
-                     * MILLISECOND_TICKS_PER_SECOND
-                     - elapsed);
-      }
-      if (remaining < delay) {
-        delay = remaining;
-      }
-    }
+  if (heapCount != 0) {
+    int32u currentTime = halCommonGetInt32uMillisecondTick();
+    int32u deadline = volatileData[heap[0]].deadline;
+    delay = (deadlineBefore(currentTime, deadline)
+             ? deadline - currentTime
+             : 0);
   }
   if (delay != MAX_INT32U_VALUE) {
     emberAfDebugPrintln("sched report event for: 0x%4x", delay);
@@ -543,16 +722,16 @@ static void scheduleTick(void)
   }
 }
 
-static void removeConfiguration(int8u index)
+static void removeConfiguration(int16u index)
 {
   EmberAfPluginReportingEntry entry;
   emAfPluginReportingGetEntry(index, &entry);
   entry.endpoint = EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID;
-  emAfPluginReportingSetEntry(index, &entry);
+  setEntry(index, &entry);
   emberAfPluginReportingConfiguredCallback(&entry);
 }
 
-static void removeConfigurationAndScheduleTick(int8u index)
+static void removeConfigurationAndScheduleTick(int16u index)
 {
   removeConfiguration(index);
   scheduleTick();
@@ -569,10 +748,9 @@ EmberAfStatus emAfPluginReportingConfigureReportedAttribute(const EmberAfCluster
   EmberAfAttributeMetadata *metadata;
   EmberAfPluginReportingEntry entry;
   EmberAfStatus status;
-  int8u i, index = NULL_INDEX;
+  int16u index;
   boolean initialize = TRUE;
 
-
   // Verify that we support the attribute and that the data type matches.
   metadata = emberAfLocateAttributeMetadata(cmd->apsFrame->destinationEndpoint,
                                             cmd->apsFrame->clusterId,
@@ -590,25 +768,18 @@ EmberAfStatus emAfPluginReportingConfigureReportedAttribute(const EmberAfCluster
     return EMBER_ZCL_STATUS_INVALID_VALUE;
   }
 
-  // Check the table for an entry that matches this request and also watch for
-  // empty slots along the way.  If a report exists, it will be overwritten
-  // with the new configuration.  Otherwise, a new entry will be created and
-  // initialized.
-  for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE; i++) {
-    emAfPluginReportingGetEntry(i, &entry);
-    if (entry.direction == EMBER_ZCL_REPORTING_DIRECTION_REPORTED
-        && entry.endpoint == cmd->apsFrame->destinationEndpoint
-        && entry.clusterId == cmd->apsFrame->clusterId
-        && entry.attributeId == attributeId
-        && entry.mask == mask
-        && entry.manufacturerCode == cmd->mfgCode) {
-      initialize = FALSE;
-      index = i;
-      break;
-    } else if (entry.endpoint == EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID
-               && index == NULL_INDEX) {
-      index = i;
-    }
+  // Check the table for an entry that matches this request.  If a report
+  // exists, it will be overwritten with the new configuration.  Otherwise, a
+  // new entry will be created in an empty slot and initialized.
+  entry.direction = EMBER_ZCL_REPORTING_DIRECTION_REPORTED;
+  entry.endpoint = cmd->apsFrame->destinationEndpoint;
+  entry.clusterId = cmd->apsFrame->clusterId;
+  entry.attributeId = attributeId;
+  entry.mask = mask;
+  entry.manufacturerCode = cmd->mfgCode;
+  index = findEntry(&entry, &entry);
+  if (index != NULL_INDEX) {
+    initialize = FALSE;
   }
 
   // If the maximum reporting interval is 0xFFFF, the device shall not issue
@@ -621,6 +792,9 @@ EmberAfStatus emAfPluginReportingConfigureReportedAttribute(const EmberAfCluster
     return EMBER_ZCL_STATUS_SUCCESS;
   }
 
+  if (initialize) {
+    index = findUnusedEntry(&entry);
+  }
   if (index == NULL_INDEX) {
     return EMBER_ZCL_STATUS_INSUFFICIENT_SPACE;
   } else if (initialize) {
@@ -648,7 +822,7 @@ EmberAfStatus emAfPluginReportingConfigureReportedAttribute(const EmberAfCluster
   // continues unchanged if the application rejects the configuration.
   status = emberAfPluginReportingConfiguredCallback(&entry);
   if (status == EMBER_ZCL_STATUS_SUCCESS) {
-    emAfPluginReportingSetEntry(index, &entry);
+    setEntry(index, &entry);
     scheduleTick();
   }
   return status;
@@ -661,30 +835,25 @@ static EmberAfStatus configureReceivedAttribute(const EmberAfClusterCommand *cmd
 {
   EmberAfPluginReportingEntry entry;
   EmberAfStatus status;
-  int8u i, index = NULL_INDEX;
+  int16u index;
   boolean initialize = TRUE;
 
-  // Check the table for an entry that matches this request and also watch for
-  // empty slots along the way.  If a report exists, it will be overwritten
-  // with the new configuration.  Otherwise, a new entry will be created and
-  // initialized.
-  for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE; i++) {
-    emAfPluginReportingGetEntry(i, &entry);
-    if (entry.direction == EMBER_ZCL_REPORTING_DIRECTION_RECEIVED
-        && entry.endpoint == cmd->apsFrame->destinationEndpoint
-        && entry.clusterId == cmd->apsFrame->clusterId
-        && entry.attributeId == attributeId
-        && entry.mask == mask
-        && entry.manufacturerCode == cmd->mfgCode
-        && entry.data.received.source == cmd->source
-        && entry.data.received.endpoint == cmd->apsFrame->sourceEndpoint) {
-      initialize = FALSE;
-      index = i;
-      break;
-    } else if (entry.endpoint == EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID
-               && index == NULL_INDEX) {
-      index = i;
-    }
+  // Check the table for an entry that matches this request.  If a report
+  // exists, it will be overwritten with the new configuration.  Otherwise, a
+  // new entry will be created in an empty slot and initialized.
+  entry.direction = EMBER_ZCL_REPORTING_DIRECTION_RECEIVED;
+  entry.endpoint = cmd->apsFrame->destinationEndpoint;
+  entry.clusterId = cmd->apsFrame->clusterId;
+  entry.attributeId = attributeId;
+  entry.mask = mask;
+  entry.manufacturerCode = cmd->mfgCode;
+  entry.data.received.source = cmd->source;
+  entry.data.received.endpoint = cmd->apsFrame->sourceEndpoint;
+  index = findEntry(&entry, &entry);
+  if (index != NULL_INDEX) {
+    initialize = FALSE;
+  } else {
+    index = findUnusedEntry(&entry);
   }
 
   if (index == NULL_INDEX) {
@@ -714,7 +883,7 @@ static EmberAfStatus configureReceivedAttribute(const EmberAfClusterCommand *cmd
   // here because we don't do anything with received reports.
   status = emberAfPluginReportingConfiguredCallback(&entry);
   if (status == EMBER_ZCL_STATUS_SUCCESS) {
-    emAfPluginReportingSetEntry(index, &entry);
+    setEntry(index, &entry);
   }
   return status;
 }
@@ -740,3 +909,221 @@ static void putReportableChangeInResp(const EmberAfPluginReportingEntry *entry,
     }
   }
 }
+
+//------------------------------------------------------------------------------
+// Entry index and deadline heap
+
+static int16u hashKey(const EmberAfPluginReportingEntry *entry)
+{
+  int32u hash = entry->endpoint;
+  hash = hash * 31 + entry->clusterId;
+  hash = hash * 31 + entry->attributeId;
+  hash = hash * 31 + entry->mask;
+  hash = hash * 31 + entry->manufacturerCode;
+  return (int16u)(hash % HASH_BUCKETS);
+}
+
+static boolean keysMatch(const EmberAfPluginReportingEntry *a,
+                         const EmberAfPluginReportingEntry *b)
+{
+  return (a->direction == b->direction
+          && a->endpoint == b->endpoint
+          && a->clusterId == b->clusterId
+          && a->attributeId == b->attributeId
+          && a->mask == b->mask
+          && a->manufacturerCode == b->manufacturerCode
+          && (a->direction == EMBER_ZCL_REPORTING_DIRECTION_REPORTED
+              || (a->data.received.source == b->data.received.source
+                  && a->data.received.endpoint == b->data.received.endpoint)));
+}
+
+static void linkEntry(int16u index, const EmberAfPluginReportingEntry *entry)
+{
+  int16u bucket;
+  if (entry->endpoint == EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID) {
+    return;
+  }
+  bucket = hashKey(entry);
+  volatileData[index].nextInBucket = buckets[bucket];
+  buckets[bucket] = index;
+}
+
+static void unlinkEntry(int16u index, const EmberAfPluginReportingEntry *entry)
+{
+  int16u *link;
+  if (entry->endpoint == EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID) {
+    return;
+  }
+  for (link = &buckets[hashKey(entry)];
+       *link != NULL_INDEX;
+       link = &volatileData[*link].nextInBucket) {
+    if (*link == index) {
+      *link = volatileData[index].nextInBucket;
+      return;
+    }
+  }
+}
+
+// Rebuilds the hash chains and the heap from the table, which on SoC
+// platforms survives a reboot in tokens.
+static void buildIndex(void)
+{
+  int32u currentTime = halCommonGetInt32uMillisecondTick();
+  int16u i;
+  MEMSET(buckets, 0xFF, sizeof(buckets));
+  MEMSET(reportBuckets, 0xFF, sizeof(reportBuckets));
+  heapCount = 0;
+  indexBuilt = TRUE;
+  for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE; i++) {
+    EmberAfPluginReportingEntry entry;
+    emAfPluginReportingGetEntry(i, &entry);
+    volatileData[i].heapIndex = 0;
+    linkEntry(i, &entry);
+    updateDeadline(i, &entry, currentTime);
+  }
+}
+
+// Returns the index of the used entry with the same direction, attribute and,
+// for received reports, source as the key, or NULL_INDEX.
+static int16u findEntry(const EmberAfPluginReportingEntry *key,
+                        EmberAfPluginReportingEntry *result)
+{
+  EmberAfPluginReportingEntry entry;
+  int16u i;
+  if (!indexBuilt) {
+    buildIndex();
+  }
+  for (i = buckets[hashKey(key)];
+       i != NULL_INDEX;
+       i = volatileData[i].nextInBucket) {
+    emAfPluginReportingGetEntry(i, &entry);
+    if (keysMatch(&entry, key)) {
+      MEMCOPY(result, &entry, sizeof(EmberAfPluginReportingEntry));
+      return i;
+    }
+  }
+  return NULL_INDEX;
+}
+
+static int16u findUnusedEntry(EmberAfPluginReportingEntry *result)
+{
+  int16u i;
+  for (i = 0; i < EMBER_AF_PLUGIN_REPORTING_TABLE_SIZE; i++) {
+    emAfPluginReportingGetEntry(i, result);
+    if (result->endpoint == EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID) {
+      return i;
+    }
+  }
+  return NULL_INDEX;
+}
+
+// Saves an entry, moving it to its new hash chain and place in the heap.
+static void setEntry(int16u index, EmberAfPluginReportingEntry *entry)
+{
+  EmberAfPluginReportingEntry old;
+  if (!indexBuilt) {
+    buildIndex();
+  }
+  emAfPluginReportingGetEntry(index, &old);
+  unlinkEntry(index, &old);
+  emAfPluginReportingSetEntry(index, entry);
+  linkEntry(index, entry);
+  updateDeadline(index, entry, halCommonGetInt32uMillisecondTick());
+}
+
+// Puts a reported entry in the heap at the time it next becomes due, or takes
+// it out if it will not become due without a reportable change.
+static void updateDeadline(int16u index,
+                           const EmberAfPluginReportingEntry *entry,
+                           int32u currentTime)
+{
+  EmAfPluginReportingVolatileData *data = &volatileData[index];
+  int32u elapsed = currentTime - data->lastReportTime;
+  int32u interval;
+  int32u oldDeadline = data->deadline;
+
+  if (entry->endpoint == EMBER_AF_PLUGIN_REPORTING_UNUSED_ENDPOINT_ID
+      || entry->direction != EMBER_ZCL_REPORTING_DIRECTION_REPORTED
+      || (!data->reportableChange
+          && entry->data.reported.maxInterval == 0x0000)) {
+    if (data->heapIndex != 0) {
+      heapRemove(data->heapIndex - 1);
+    }
+    return;
+  }
+
+  interval = ((data->reportableChange
+               ? entry->data.reported.minInterval
+               : entry->data.reported.maxInterval)
+              * MILLISECOND_TICKS_PER_SECOND);
+  data->deadline = currentTime + (elapsed < interval ? interval - elapsed : 0);
+  if (data->heapIndex == 0) {
+    heap[heapCount] = index;
+    data->heapIndex = ++heapCount;
+    heapSiftUp(heapCount - 1);
+  } else if (deadlineBefore(data->deadline, oldDeadline)) {
+    heapSiftUp(data->heapIndex - 1);
+  } else {
+    heapSiftDown(data->heapIndex - 1);
+  }
+}
+
+static void heapRemove(int16u position)
+{
+  int16u removed = heap[position];
+  volatileData[removed].heapIndex = 0;
+  heapCount--;
+  if (position != heapCount) {
+    int16u last = heap[heapCount];
+    heap[position] = last;
+    volatileData[last].heapIndex = position + 1;
+    if (deadlineBefore(volatileData[last].deadline,
+                       volatileData[removed].deadline)) {
+      heapSiftUp(position);
+    } else {
+      heapSiftDown(position);
+    }
+  }
+}
+
+static void heapSiftUp(int16u position)
+{
+  int16u index = heap[position];
+  while (position > 0) {
+    int16u parent = (position - 1) / 2;
+    if (!deadlineBefore(volatileData[index].deadline,
+                        volatileData[heap[parent]].deadline)) {
+      break;
+    }
+    heap[position] = heap[parent];
+    volatileData[heap[position]].heapIndex = position + 1;
+    position = parent;
+  }
+  heap[position] = index;
+  volatileData[index].heapIndex = position + 1;
+}
+
+static void heapSiftDown(int16u position)
+{
+  int16u index = heap[position];
+  for (;;) {
+    int16u child = 2 * position + 1;
+    if (child >= heapCount) {
+      break;
+    }
+    if (child + 1 < heapCount
+        && deadlineBefore(volatileData[heap[child + 1]].deadline,
+                          volatileData[heap[child]].deadline)) {
+      child++;
+    }
+    if (!deadlineBefore(volatileData[heap[child]].deadline,
+                        volatileData[index].deadline)) {
+      break;
+    }
+    heap[position] = heap[child];
+    volatileData[heap[position]].heapIndex = position + 1;
+    position = child;
+  }
+  heap[position] = index;
+  volatileData[index].heapIndex = position + 1;
+}
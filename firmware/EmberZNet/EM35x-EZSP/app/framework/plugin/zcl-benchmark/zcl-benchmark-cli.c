@@ -0,0 +1,150 @@
+// *****************************************************************************
+// * zcl-benchmark-cli.c
+// *
+// * Replays a capture of incoming ZCL frames through emberAfProcessMessage()
+// * and prints the time taken per frame.  Each line of the capture file is one
+// * frame, as hex fields separated by spaces:
+// *   <cluster> <profile> <source endpoint> <destination endpoint>
+// *   <APS options> <ZCL frame>
+// * for example "0006 0104 01 01 0040 010a02".  Lines starting with '#' are
+// * ignored.  Responses and other messages are built but not sent.  The time
+// * includes any printing of the incoming messages, so printing should be
+// * turned off first.
+// *
+// * Copyright 2012 by Ember Corporation. All rights reserved.              *80*
+// *****************************************************************************
+
+#include "app/framework/include/af.h"
+#include "app/framework/util/util.h"
+#include "app/util/serial/command-interpreter2.h"
+
+#include <stdio.h>      // fopen, fgets, sscanf
+#include <time.h>       // clock_gettime
+
+// *****************************************************************************
+// Forward Declarations
+
+static void replayCommand(void);
+
+// *****************************************************************************
+// Globals
+
+#define FILE_NAME_LENGTH 64
+#define MAX_FRAMES 1024
+#define MAX_FRAME_LENGTH 127
+#define LINE_LENGTH (32 + 2 * MAX_FRAME_LENGTH)
+
+typedef struct {
+  EmberApsFrame apsFrame;
+  int8u length;
+  int8u message[MAX_FRAME_LENGTH];
+} CapturedFrame;
+
+static CapturedFrame frames[MAX_FRAMES];
+
+EmberCommandEntry emberAfPluginZclBenchmarkCommands[] = {
+  emberCommandEntryAction("replay", replayCommand, "bw",
+                          "Replay the ZCL frames in a file n times and print the time per frame."),
+  emberCommandEntryTerminator(),
+};
+
+// *****************************************************************************
+// Functions
+
+static int32u nowUs(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int32u)(now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+static boolean parseLine(char *line, CapturedFrame *frame)
+{
+  unsigned int clusterId, profileId, sourceEndpoint, destinationEndpoint;
+  unsigned int options, byte;
+  int consumed;
+  char *hex;
+
+  if (sscanf(line, "%x %x %x %x %x %n",
+             &clusterId,
+             &profileId,
+             &sourceEndpoint,
+             &destinationEndpoint,
+             &options,
+             &consumed) != 5) {
+    return FALSE;
+  }
+  MEMSET(frame, 0, sizeof(CapturedFrame));
+  frame->apsFrame.clusterId = (int16u)clusterId;
+  frame->apsFrame.profileId = (int16u)profileId;
+  frame->apsFrame.sourceEndpoint = (int8u)sourceEndpoint;
+  frame->apsFrame.destinationEndpoint = (int8u)destinationEndpoint;
+  frame->apsFrame.options = (int16u)options;
+  for (hex = line + consumed;
+       frame->length < MAX_FRAME_LENGTH && sscanf(hex, "%2x", &byte) == 1;
+       hex += 2) {
+    frame->message[frame->length++] = (int8u)byte;
+  }
+  return (frame->length != 0);
+}
+
+static void replayCommand(void)
+{
+  int8u fileName[FILE_NAME_LENGTH + 1];
+  int8u length = emberCopyStringArgument(0,
+                                         fileName,
+                                         FILE_NAME_LENGTH,
+                                         FALSE);
+  int32u passes = emberUnsignedCommandArgument(1);
+  char line[LINE_LENGTH];
+  int16u frameCount = 0;
+  int32u pass, startUs, passUs, totalUs = 0, bestUs = 0xFFFFFFFFUL;
+  int16u i;
+  FILE *file;
+
+  fileName[length] = '\0';
+  file = fopen((char *)fileName, "r");
+  if (file == NULL) {
+    emberAfCorePrintln("Error:  Cannot open %p", fileName);
+    return;
+  }
+  while (frameCount < MAX_FRAMES && fgets(line, sizeof(line), file) != NULL) {
+    if (line[0] != '#' && parseLine(line, &frames[frameCount])) {
+      frameCount++;
+    }
+  }
+  fclose(file);
+  if (frameCount == 0 || passes == 0) {
+    emberAfCorePrintln("Error:  No frames to replay");
+    return;
+  }
+
+  emAfSuppressSends = TRUE;
+  for (pass = 0; pass < passes; pass++) {
+    startUs = nowUs();
+    for (i = 0; i < frameCount; i++) {
+      // The framework may change the APS frame and the message, so each
+      // replay works on a copy.
+      EmberApsFrame apsFrame = frames[i].apsFrame;
+      int8u message[MAX_FRAME_LENGTH];
+      MEMCOPY(message, frames[i].message, frames[i].length);
+      emberAfProcessMessage(&apsFrame,
+                            EMBER_INCOMING_UNICAST,
+                            message,
+                            frames[i].length,
+                            emberAfGetNodeId(),
+                            NULL);
+    }
+    passUs = nowUs() - startUs;
+    totalUs += passUs;
+    if (passUs < bestUs) {
+      bestUs = passUs;
+    }
+  }
+  emAfSuppressSends = FALSE;
+
+  emberAfCorePrintln("%d frames, %l passes, %l us", frameCount, passes, totalUs);
+  emberAfCorePrintln("ns per frame: mean %l, best pass %l",
+                     (int32u)((totalUs * 1000.0) / ((double)passes * frameCount)),
+                     (int32u)((bestUs * 1000.0) / frameCount));
+}
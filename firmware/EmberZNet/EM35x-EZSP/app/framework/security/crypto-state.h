@@ -8,10 +8,14 @@
 // *****************************************************************************
 
 // For the host applications, if ECC operations are underway then
-// the NCP will be completely consumed doing the processing for 
+// the NCP will be completely consumed doing the processing for
 // SECONDS.  Therefore the application should not expect it to be
-// very responsive.  Normal operations (cluster and app. ticks) will 
-// not be fired during that period.
+// very responsive.  Normal operations (cluster and app. ticks) will
+// not be fired during that period.  The host still processes NCP callbacks
+// and the CLI.  Only one such operation can run at a time, so anything
+// started from those (key establishment, signed messages, image signature
+// verification) must wait until emAfIsCryptoOperationInProgress() is FALSE
+// before starting its own.
 
 #ifndef CRYPTO_OPERATION_TIMEOUT_MS
 #define CRYPTO_OPERATION_TIMEOUT_MS MILLISECOND_TICKS_PER_SECOND * 5
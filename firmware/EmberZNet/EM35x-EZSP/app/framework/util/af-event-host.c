@@ -5,31 +5,63 @@
 // Copyright 2010 by Ember Corporation. All rights reserved.                *80*
 
 #include PLATFORM_HEADER     // Micro and compiler specific typedefs and macros
+#include <stdlib.h>
 #include "stack/include/ember-types.h"
 #include "hal/hal.h"
 #include "stack/include/event.h"
 
+// The events of each task are kept in a binary min-heap ordered by their
+// 32-bit millisecond deadlines, so running the task and finding the time to
+// its next event only look at the events that are due.  Arming an event
+// moves it within the heap.  Events made inactive with
+// emberEventControlSetInactive() are left where they are and dropped when
+// they reach the top.  Event arrays that are not tasks, and tasks whose queue
+// could not be allocated, are scanned in full as before.
+
+typedef struct EmEventQueue {
+  EmberEventData *events;
+  EmberEventData **heap;
+  EmberEventData **due;         // scratch space for emberRunEvents()
+  int16u count;
+} EmEventQueue;
 
 extern EmberTaskControl emTasks[];
 extern PGM int8u emTaskCount;
 static int8u emActiveTaskCount = 0;
+static EmEventQueue *taskQueues[256];  // indexed by EmberTaskId
+
+static void scheduleEvent(EmberEventControl *event, int32u delayMs);
+static void scanEvents(EmberEventData *events);
+static EmEventQueue *findQueue(EmberEventData *events);
+static void runQueue(EmEventQueue *queue);
+static void pruneQueue(EmEventQueue *queue);
+static void queueInsert(EmEventQueue *queue, EmberEventData *event);
+static void queueRemove(EmEventQueue *queue, int16u index);
+static void queueSiftUp(EmEventQueue *queue, int16u index);
+static void queueSiftDown(EmEventQueue *queue, int16u index);
+static int32u legacyMsToEvent(EmberEventControl *control, int16u *times);
 
+#define deadlineBefore(a, b) ((int32s)((a) - (b)) < 0)
+#define eventIsDue(control, now) (!deadlineBefore((now), (control)->deadline))
 
 void emEventControlSetActive(EmberEventControl *event)
 {
   event->status = EMBER_EVENT_ZERO_DELAY;
+  scheduleEvent(event, 0);
 }
 
 void emEventControlSetDelayMS(EmberEventControl*event, int16u delay)
 {
   event->timeToExecute = halCommonGetInt16uMillisecondTick() + delay;
   event->status = EMBER_EVENT_MS_TIME;
+  scheduleEvent(event, delay);
 }
 
 void emEventControlSetDelayQS(EmberEventControl*event, int16u delay)
 {
   event->timeToExecute = halCommonGetInt16uQuarterSecondTick() + delay;
   event->status = EMBER_EVENT_QS_TIME;
+  scheduleEvent(event, ((int32u) delay) << 8);
 }
 
 void emEventControlSetDelayMinutes(EmberEventControl*event, int16u delay)
@@ -37,15 +69,31 @@ void emEventControlSetDelayMinutes(EmberEventControl*event, int16u delay)
   event->timeToExecute =
     ((int16u) (halCommonGetInt32uMillisecondTick() >> 16)) + delay;
   event->status = EMBER_EVENT_MINUTE_TIME;
+  scheduleEvent(event, ((int32u) delay) << 16);
 }
 
 void emberRunTask(EmberTaskId taskid)
 {
   EmberTaskControl *task = &(emTasks[taskid]);
-  emberRunEvents(task->events);
+  if (taskQueues[taskid] != NULL) {
+    runQueue(taskQueues[taskid]);
+  } else {
+    scanEvents(task->events);
+  }
 }
 
 void emberRunEvents(EmberEventData *events)
+{
+  EmEventQueue *queue = findQueue(events);
+  if (queue != NULL) {
+    runQueue(queue);
+  } else {
+    scanEvents(events);
+  }
+}
+
+// Calls the handlers of the due events in an array that is not a task.
+static void scanEvents(EmberEventData *events)
 {
   int16u times[4];
   EmberEventData *nextEvent;
@@ -77,9 +125,29 @@ int32u emberMsToNextEventExtended(EmberEventData *events, int32u maxTime, int8u*
   int32u time = maxTime;
   int32u nowMS32 = halCommonGetInt32uMillisecondTick();
   int8u index = 0;
+  EmEventQueue *queue = findQueue(events);
   if (returnIndex != NULL) {
     *returnIndex = 0xFF;
   }
+
+  if (queue != NULL) {
+    EmberEventControl *control;
+    pruneQueue(queue);
+    if (queue->count == 0) {
+      return maxTime;
+    }
+    control = queue->heap[0]->control;
+    time = (eventIsDue(control, nowMS32)
+            ? 0
+            : control->deadline - nowMS32);
+    if (time >= maxTime) {
+      return maxTime;
+    }
+    if (returnIndex != NULL) {
+      *returnIndex = (int8u) (queue->heap[0] - events);
+    }
+    return time;
+  }
   
   times[EMBER_EVENT_MS_TIME]     = (int16u) nowMS32;
   times[EMBER_EVENT_QS_TIME]     = (int16u) (nowMS32 >> 8);
@@ -87,28 +155,14 @@ int32u emberMsToNextEventExtended(EmberEventData *events, int32u maxTime, int8u*
 
   for (nextEvent = events; ; nextEvent++) {
     EmberEventControl *control = nextEvent->control;
-    int8u eventStatus;
-    int16u eventTime;
     int32u waitTime;
 
     if (control == NULL
         || time == 0)
       break;
 
-    eventStatus = control->status;
-    if (eventStatus != EMBER_EVENT_INACTIVE) {
-      eventTime = control->timeToExecute;
-      waitTime = elapsedTimeInt16u(times[eventStatus], eventTime);
-      if (control->status == EMBER_EVENT_ZERO_DELAY
-          || timeGTorEqualInt16u(times[eventStatus], eventTime)) {
-        waitTime = 0;
-      } else if (eventStatus == EMBER_EVENT_QS_TIME) {
-        waitTime = ((waitTime << 8)
-                    - (times[EMBER_EVENT_MS_TIME] & 0xFF));
-      } else if (eventStatus == EMBER_EVENT_MINUTE_TIME) {
-        waitTime = ((waitTime << 16)
-                    - times[EMBER_EVENT_MS_TIME]);
-      }
+    if (control->status != EMBER_EVENT_INACTIVE) {
+      waitTime = legacyMsToEvent(control, times);
       if (waitTime < time) {
         time = waitTime;
         if (returnIndex != NULL) {
@@ -141,6 +195,43 @@ EmberTaskId emberTaskInit(EmberEventData *events)
   
   task = &(emTasks[id]);
   task->events = events;
+
+  // Queue the task's events, including any that are already armed.
+  {
+    EmEventQueue *queue;
+    EmberEventData *event;
+    int16u times[4];
+    int32u nowMS32 = halCommonGetInt32uMillisecondTick();
+    int16u eventCount = 0;
+
+    for (event = events; event->control != NULL; event++) {
+      eventCount++;
+    }
+    queue = (EmEventQueue *) malloc(sizeof(EmEventQueue)
+                                    + (2 * eventCount
+                                       * sizeof(EmberEventData *)));
+    if (queue != NULL) {
+      queue->events = events;
+      queue->heap = (EmberEventData **) (queue + 1);
+      queue->due = queue->heap + eventCount;
+      queue->count = 0;
+      taskQueues[id] = queue;
+
+      times[EMBER_EVENT_MS_TIME]     = (int16u) nowMS32;
+      times[EMBER_EVENT_QS_TIME]     = (int16u) (nowMS32 >> 8);
+      times[EMBER_EVENT_MINUTE_TIME] = (int16u) (nowMS32 >> 16);
+      for (event = events; event->control != NULL; event++) {
+        EmberEventControl *control = event->control;
+        control->queue = queue;
+        control->queueIndex = 0;
+        control->eventIndex = (int16u) (event - events);
+        if (control->status != EMBER_EVENT_INACTIVE) {
+          control->deadline = nowMS32 + legacyMsToEvent(control, times);
+          queueInsert(queue, event);
+        }
+      }
+    }
+  }
   
   return id;
 }
@@ -160,4 +251,162 @@ void emMarkTaskActive(EmberTaskId taskid)
 
 void emTaskEnableIdling(boolean allow) { } //stub
 
+//------------------------------------------------------------------------------
+// Event queues
+
+// Sets the deadline of an event and moves it to its place in its task's
+// queue, if it has one.
+static void scheduleEvent(EmberEventControl *event, int32u delayMs)
+{
+  EmEventQueue *queue = event->queue;
+  int32u oldDeadline = event->deadline;
+  event->deadline = halCommonGetInt32uMillisecondTick() + delayMs;
+  if (queue == NULL) {
+    return;
+  }
+  if (event->queueIndex == 0) {
+    queueInsert(queue, &(queue->events[event->eventIndex]));
+  } else if (deadlineBefore(event->deadline, oldDeadline)) {
+    queueSiftUp(queue, event->queueIndex - 1);
+  } else {
+    queueSiftDown(queue, event->queueIndex - 1);
+  }
+}
+
+static EmEventQueue *findQueue(EmberEventData *events)
+{
+  int8u i;
+  for (i = 0; i < emActiveTaskCount; i++) {
+    if (taskQueues[i] != NULL && taskQueues[i]->events == events) {
+      return taskQueues[i];
+    }
+  }
+  return NULL;
+}
+
+// Calls the handlers of the events that are due, each at most once.  Events
+// whose handlers neither rearm nor deactivate them are due again next time.
+static void runQueue(EmEventQueue *queue)
+{
+  int32u now = halCommonGetInt32uMillisecondTick();
+  int16u dueCount = 0;
+  int16u i;
+
+  while (queue->count != 0
+         && eventIsDue(queue->heap[0]->control, now)) {
+    EmberEventData *event = queue->heap[0];
+    queueRemove(queue, 0);
+    if (event->control->status != EMBER_EVENT_INACTIVE) {
+      queue->due[dueCount++] = event;
+    }
+  }
 
+  for (i = 0; i < dueCount; i++) {
+    EmberEventData *event = queue->due[i];
+    EmberEventControl *control = event->control;
+    // An earlier handler may have deactivated or rearmed this event.
+    if (control->status != EMBER_EVENT_INACTIVE
+        && control->queueIndex == 0) {
+      ((void (*)(EmberEventControl *))(event->handler))(control);
+    }
+    if (control->status != EMBER_EVENT_INACTIVE
+        && control->queueIndex == 0) {
+      queueInsert(queue, event);
+    }
+  }
+}
+
+// Drops inactive events from the top of the queue.
+static void pruneQueue(EmEventQueue *queue)
+{
+  while (queue->count != 0
+         && queue->heap[0]->control->status == EMBER_EVENT_INACTIVE) {
+    queueRemove(queue, 0);
+  }
+}
+
+static void queueInsert(EmEventQueue *queue, EmberEventData *event)
+{
+  queue->heap[queue->count] = event;
+  event->control->queueIndex = ++queue->count;
+  queueSiftUp(queue, queue->count - 1);
+}
+
+static void queueRemove(EmEventQueue *queue, int16u index)
+{
+  EmberEventData *removed = queue->heap[index];
+  removed->control->queueIndex = 0;
+  queue->count--;
+  if (index != queue->count) {
+    EmberEventData *last = queue->heap[queue->count];
+    queue->heap[index] = last;
+    last->control->queueIndex = index + 1;
+    if (deadlineBefore(last->control->deadline, removed->control->deadline)) {
+      queueSiftUp(queue, index);
+    } else {
+      queueSiftDown(queue, index);
+    }
+  }
+}
+
+static void queueSiftUp(EmEventQueue *queue, int16u index)
+{
+  EmberEventData *event = queue->heap[index];
+  while (index > 0) {
+    int16u parent = (index - 1) / 2;
+    if (!deadlineBefore(event->control->deadline,
+                        queue->heap[parent]->control->deadline)) {
+      break;
+    }
+    queue->heap[index] = queue->heap[parent];
+    queue->heap[index]->control->queueIndex = index + 1;
+    index = parent;
+  }
+  queue->heap[index] = event;
+  event->control->queueIndex = index + 1;
+}
+
+static void queueSiftDown(EmEventQueue *queue, int16u index)
+{
+  EmberEventData *event = queue->heap[index];
+  for (;;) {
+    int16u child = 2 * index + 1;
+    if (child >= queue->count) {
+      break;
+    }
+    if (child + 1 < queue->count
+        && deadlineBefore(queue->heap[child + 1]->control->deadline,
+                          queue->heap[child]->control->deadline)) {
+      child++;
+    }
+    if (!deadlineBefore(queue->heap[child]->control->deadline,
+                        event->control->deadline)) {
+      break;
+    }
+    queue->heap[index] = queue->heap[child];
+    queue->heap[index]->control->queueIndex = index + 1;
+    index = child;
+  }
+  queue->heap[index] = event;
+  event->control->queueIndex = index + 1;
+}
+
+// Returns the milliseconds until an active event fires, going by its status
+// and 16-bit timeToExecute.
+static int32u legacyMsToEvent(EmberEventControl *control, int16u *times)
+{
+  int8u eventStatus = control->status;
+  int16u eventTime = control->timeToExecute;
+  int32u waitTime = elapsedTimeInt16u(times[eventStatus], eventTime);
+  if (eventStatus == EMBER_EVENT_ZERO_DELAY
+      || timeGTorEqualInt16u(times[eventStatus], eventTime)) {
+    waitTime = 0;
+  } else if (eventStatus == EMBER_EVENT_QS_TIME) {
+    waitTime = ((waitTime << 8)
+                - (times[EMBER_EVENT_MS_TIME] & 0xFF));
+  } else if (eventStatus == EMBER_EVENT_MINUTE_TIME) {
+    waitTime = ((waitTime << 16)
+                - times[EMBER_EVENT_MS_TIME]);
+  }
+  return waitTime;
+}
@@ -37,6 +37,15 @@ int16u emAfAppEventContextLength = EMBER_AF_EVENT_CONTEXT_LENGTH;
 EmberAfEventContext emAfAppEventContext[] = {
   EMBER_AF_GENERATED_EVENT_CONTEXT
 };
+
+// The event contexts are found through an open-addressed hash of (endpoint,
+// cluster, client/server), built from the generated list the first time one
+// is looked up.  The table is kept at most half full, so a lookup is one or
+// two probes whatever the number of contexts.
+#define EVENT_CONTEXT_INDEX_SIZE (2 * EMBER_AF_EVENT_CONTEXT_LENGTH + 1)
+#define NULL_CONTEXT_INDEX 0xFFFF
+static int16u eventContextIndex[EVENT_CONTEXT_INDEX_SIZE];
+static boolean eventContextIndexBuilt = FALSE;
 #endif //EMBER_AF_GENERATED_EVENT_CONTEXT
 
 PGM_P emAfEventStrings[] = {
@@ -91,19 +100,65 @@ void emberAfRunEvents(void)
   emberRunTask(emAfTaskId);
 }
 
+#if defined(EMBER_AF_GENERATED_EVENT_CONTEXT)
+static int16u eventContextSlot(int8u endpoint,
+                               int16u clusterId,
+                               boolean isClient)
+{
+  int32u key = (((int32u)clusterId << 9)
+                | ((int32u)endpoint << 1)
+                | (isClient ? 1 : 0));
+  key ^= key >> 13;
+  key *= 0x9E3779B1UL;
+  return (int16u)((key >> 8) % EVENT_CONTEXT_INDEX_SIZE);
+}
+
+// Each context is entered only if an earlier one does not already have the
+// same key, so the first match is found, as it was by a linear search.
+static void buildEventContextIndex(void)
+{
+  int16u i;
+  MEMSET(eventContextIndex, 0xFF, sizeof(eventContextIndex));
+  for (i = 0; i < emAfAppEventContextLength; i++) {
+    EmberAfEventContext *context = &(emAfAppEventContext[i]);
+    int16u slot = eventContextSlot(context->endpoint,
+                                   context->clusterId,
+                                   context->isClient);
+    while (eventContextIndex[slot] != NULL_CONTEXT_INDEX) {
+      EmberAfEventContext *other = &(emAfAppEventContext[eventContextIndex[slot]]);
+      if (other->endpoint == context->endpoint
+          && other->clusterId == context->clusterId
+          && other->isClient == context->isClient) {
+        break;
+      }
+      slot = (slot + 1) % EVENT_CONTEXT_INDEX_SIZE;
+    }
+    if (eventContextIndex[slot] == NULL_CONTEXT_INDEX) {
+      eventContextIndex[slot] = i;
+    }
+  }
+  eventContextIndexBuilt = TRUE;
+}
+#endif //EMBER_AF_GENERATED_EVENT_CONTEXT
+
 static EmberAfEventContext *findEventContext(int8u endpoint,
                                              int16u clusterId,
                                              boolean isClient) 
 {
 #if defined(EMBER_AF_GENERATED_EVENT_CONTEXT)
-  int8u i;
-  for (i = 0; i < emAfAppEventContextLength; i++) {
-    EmberAfEventContext *context = &(emAfAppEventContext[i]);
+  int16u slot;
+  if (!eventContextIndexBuilt) {
+    buildEventContextIndex();
+  }
+  slot = eventContextSlot(endpoint, clusterId, isClient);
+  while (eventContextIndex[slot] != NULL_CONTEXT_INDEX) {
+    EmberAfEventContext *context = &(emAfAppEventContext[eventContextIndex[slot]]);
     if (context->endpoint == endpoint 
         && context->clusterId == clusterId
         && context->isClient == isClient) {
       return context;
     }
+    slot = (slot + 1) % EVENT_CONTEXT_INDEX_SIZE;
   }
 #endif //EMBER_AF_GENERATED_EVENT_CONTEXT
   return NULL;
@@ -103,6 +103,25 @@ PGM EmberAfOtaImageId emberAfInvalidImageId = INVALID_OTA_IMAGE_ID;
 // correctly, which is not the case (e.g. emberFindKeyTableEntry()).
 const EmberEUI64 emberAfNullEui64 = {0,0,0,0,0,0,0,0};
 
+// The stack signs one message at a time, and not while it is doing any other
+// crypto operation, so messages to be signed wait here until it is free.
+#if !defined(EMBER_AF_SIGNED_MESSAGE_QUEUE_SIZE)
+  #define EMBER_AF_SIGNED_MESSAGE_QUEUE_SIZE 2
+#endif
+
+typedef struct {
+  EmberOutgoingMessageType type;
+  int16u indexOrDestination;
+  EmberApsFrame apsFrame;
+  boolean broadcast;
+  int8u messageLength;
+  int8u message[EMBER_AF_MAXIMUM_APS_PAYLOAD_LENGTH];
+} SignedMessage;
+
+static SignedMessage signedMessages[EMBER_AF_SIGNED_MESSAGE_QUEUE_SIZE];
+static int8u signedMessageCount = 0;
+static boolean sendingQueuedSignedMessage = FALSE;
+
 //------------------------------------------------------------------------------
 // Forward declarations
 
@@ -119,6 +138,32 @@ boolean emberAfIsFullSmartEnergySecurityPresent(void)
   return FALSE;
 }
 
+static EmberStatus queueSignedMessage(EmberOutgoingMessageType type,
+                                      int16u indexOrDestination,
+                                      EmberApsFrame *apsFrame,
+                                      int16u messageLength,
+                                      int8u *message,
+                                      boolean broadcast)
+{
+  SignedMessage *queued;
+  if (messageLength > EMBER_AF_MAXIMUM_APS_PAYLOAD_LENGTH) {
+    return EMBER_MESSAGE_TOO_LONG;
+  }
+  if (signedMessageCount == EMBER_AF_SIGNED_MESSAGE_QUEUE_SIZE) {
+    return EMBER_NO_BUFFERS;
+  }
+  queued = &signedMessages[signedMessageCount];
+  queued->type = type;
+  queued->indexOrDestination = indexOrDestination;
+  MEMCOPY(&queued->apsFrame, apsFrame, sizeof(EmberApsFrame));
+  queued->broadcast = broadcast;
+  queued->messageLength = (int8u)messageLength;
+  MEMCOPY(queued->message, message, messageLength);
+  signedMessageCount++;
+  emberAfSecurityPrintln("Signed message queued until crypto is done");
+  return EMBER_SUCCESS;
+}
+
 static EmberStatus send(EmberOutgoingMessageType type,
                         int16u indexOrDestination,
                         EmberApsFrame *apsFrame,
@@ -129,6 +174,25 @@ static EmberStatus send(EmberOutgoingMessageType type,
   EmberStatus status;
   int8u commandId, index;
 
+#ifdef EMBER_AF_PLUGIN_ZCL_BENCHMARK
+  if (emAfSuppressSends) {
+    return EMBER_SUCCESS;
+  }
+#endif
+
+  // Signed messages wait for the crypto operation in progress, and for any
+  // signed messages that are already waiting.
+  if ((apsFrame->options & EMBER_APS_OPTION_DSA_SIGN)
+      && !sendingQueuedSignedMessage
+      && (signedMessageCount != 0 || emAfIsCryptoOperationInProgress())) {
+    return queueSignedMessage(type,
+                              indexOrDestination,
+                              apsFrame,
+                              messageLength,
+                              message,
+                              broadcast);
+  }
+
   // The send APIs only deal with ZCL messages, so they must at least contain
   // the ZCL header.
   if (messageLength < EMBER_AF_ZCL_OVERHEAD) {
@@ -204,6 +268,29 @@ static EmberStatus send(EmberOutgoingMessageType type,
   return status;
 }
 
+void emAfSendQueuedSignedMessages(void)
+{
+  while (signedMessageCount != 0 && !emAfIsCryptoOperationInProgress()) {
+    SignedMessage *queued = &signedMessages[0];
+    EmberStatus status;
+    sendingQueuedSignedMessage = TRUE;
+    status = send(queued->type,
+                  queued->indexOrDestination,
+                  &queued->apsFrame,
+                  queued->messageLength,
+                  queued->message,
+                  queued->broadcast);
+    sendingQueuedSignedMessage = FALSE;
+    if (status != EMBER_SUCCESS) {
+      emberAfSecurityPrintln("Queued signed message failed: 0x%x", status);
+    }
+    signedMessageCount--;
+    MEMCOPY(&signedMessages[0],
+            &signedMessages[1],
+            signedMessageCount * sizeof(SignedMessage));
+  }
+}
+
 EmberStatus emberAfSendMulticast(EmberMulticastId multicastId,
                                  EmberApsFrame *apsFrame,
                                  int16u messageLength,
@@ -244,7 +331,7 @@ EmberStatus emberAfSendUnicast(EmberOutgoingMessageType type,
     // cluster in the binding is not used because bindings can be used to send
     // messages with any cluster id, not just the one set in the binding.
     EmberBindingTableEntry binding;
-    EmberStatus status = emberGetBinding(indexOrDestination, &binding);
+    EmberStatus status = emberAfGetBinding(indexOrDestination, &binding);
     if (status != EMBER_SUCCESS) {
       return status;
     }
@@ -268,7 +355,7 @@ EmberStatus emberAfSendUnicastToBindings(EmberApsFrame *apsFrame,
 
   for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
     EmberBindingTableEntry binding;
-    status = emberGetBinding(i, &binding);
+    status = emberAfGetBinding(i, &binding);
     if (status != EMBER_SUCCESS) {
       return status;
     }
@@ -301,6 +388,11 @@ EmberStatus emberAfSendInterPan(EmberPanId panId,
                                 int8u* messageBytes)
 {
   EmberAfInterpanHeader header;
+#ifdef EMBER_AF_PLUGIN_ZCL_BENCHMARK
+  if (emAfSuppressSends) {
+    return EMBER_SUCCESS;
+  }
+#endif
   MEMSET(&header, 0, sizeof(EmberAfInterpanHeader));
   header.panId = panId;
   header.shortAddress = nodeId;
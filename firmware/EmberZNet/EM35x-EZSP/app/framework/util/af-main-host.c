@@ -179,6 +179,17 @@ void emAfSetupFakeEepromForSimulation(void);
 static int16u cachedConfigIdValues[EZSP_CONFIG_ID_MAX + 1];
 static boolean cacheConfigIdValuesAllowed = FALSE;
 
+// A copy of the NCP's binding table, so that sending to bindings does not
+// need an EZSP command per entry.  It is loaded after the NCP is initialized
+// and updated by the emberAf binding functions and the remote binding
+// callbacks.
+static EmberBindingTableEntry bindingCache[EMBER_BINDING_TABLE_SIZE];
+// Entries that could not be read from the NCP.  Each is read again on its
+// own when it is next needed.
+static boolean bindingCacheStale[EMBER_BINDING_TABLE_SIZE];
+static boolean bindingCacheValid = FALSE;
+static EmberAfBindingCacheCounts bindingCacheCounts;
+
 //------------------------------------------------------------------------------
 // Forward declarations
 
@@ -245,6 +256,120 @@ void emAfClearNetworkCache(int8u networkIndex)
   networkCache[networkIndex].panId = 0xFFFF;
 }
 
+// Reads the binding table from the NCP.  Entries past the end of the NCP's
+// table, which may be smaller than the one asked for at init, are unused.
+// An entry that cannot be read is marked stale rather than making the whole
+// table be loaded again.
+static void loadBindingCache(void)
+{
+  int8u size = emberAfGetBindingTableSize();
+  int8u i;
+  if (size > EMBER_BINDING_TABLE_SIZE) {
+    size = EMBER_BINDING_TABLE_SIZE;
+  }
+  for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
+    bindingCacheStale[i] = FALSE;
+    if (i < size) {
+      bindingCacheCounts.ezspReads++;
+      if (emberGetBinding(i, &bindingCache[i]) == EMBER_SUCCESS) {
+        continue;
+      }
+      bindingCacheStale[i] = TRUE;
+    }
+    bindingCache[i].type = EMBER_UNUSED_BINDING;
+  }
+  bindingCacheValid = TRUE;
+}
+
+EmberStatus emberAfGetBinding(int8u index, EmberBindingTableEntry *result)
+{
+  if (index >= EMBER_BINDING_TABLE_SIZE) {
+    return EMBER_INVALID_BINDING_INDEX;
+  }
+  if (!bindingCacheValid) {
+    loadBindingCache();
+  }
+  if (bindingCacheStale[index]) {
+    EmberStatus status;
+    bindingCacheCounts.ezspReads++;
+    status = emberGetBinding(index, result);
+    if (status == EMBER_SUCCESS) {
+      MEMCOPY(&bindingCache[index], result, sizeof(EmberBindingTableEntry));
+      bindingCacheStale[index] = FALSE;
+    }
+    return status;
+  }
+  bindingCacheCounts.hostReads++;
+  MEMCOPY(result, &bindingCache[index], sizeof(EmberBindingTableEntry));
+  return EMBER_SUCCESS;
+}
+
+EmberStatus emberAfSetBinding(int8u index, EmberBindingTableEntry *value)
+{
+  EmberStatus status = emberSetBinding(index, value);
+  if (status == EMBER_SUCCESS && index < EMBER_BINDING_TABLE_SIZE) {
+    MEMCOPY(&bindingCache[index], value, sizeof(EmberBindingTableEntry));
+    bindingCacheStale[index] = FALSE;
+    bindingCacheCounts.updates++;
+  }
+  return status;
+}
+
+EmberStatus emberAfDeleteBinding(int8u index)
+{
+  EmberStatus status = emberDeleteBinding(index);
+  if (status == EMBER_SUCCESS && index < EMBER_BINDING_TABLE_SIZE) {
+    bindingCache[index].type = EMBER_UNUSED_BINDING;
+    bindingCacheStale[index] = FALSE;
+    bindingCacheCounts.updates++;
+  }
+  return status;
+}
+
+EmberStatus emberAfClearBindingTable(void)
+{
+  EmberStatus status = emberClearBindingTable();
+  int8u i;
+  if (status == EMBER_SUCCESS) {
+    for (i = 0; i < EMBER_BINDING_TABLE_SIZE; i++) {
+      bindingCache[i].type = EMBER_UNUSED_BINDING;
+      bindingCacheStale[i] = FALSE;
+    }
+    bindingCacheCounts.updates++;
+  } else {
+    bindingCacheValid = FALSE;
+  }
+  return status;
+}
+
+// The NCP calls these after it has changed its binding table in response to
+// a ZDO bind or unbind request.
+void ezspRemoteSetBindingHandler(EmberBindingTableEntry *entry,
+                                 int8u index,
+                                 EmberStatus policyDecision)
+{
+  if (policyDecision == EMBER_SUCCESS && index < EMBER_BINDING_TABLE_SIZE) {
+    MEMCOPY(&bindingCache[index], entry, sizeof(EmberBindingTableEntry));
+    bindingCacheStale[index] = FALSE;
+    bindingCacheCounts.updates++;
+  }
+}
+
+void ezspRemoteDeleteBindingHandler(int8u index,
+                                    EmberStatus policyDecision)
+{
+  if (policyDecision == EMBER_SUCCESS && index < EMBER_BINDING_TABLE_SIZE) {
+    bindingCache[index].type = EMBER_UNUSED_BINDING;
+    bindingCacheStale[index] = FALSE;
+    bindingCacheCounts.updates++;
+  }
+}
+
+const EmberAfBindingCacheCounts *emAfGetBindingCacheCounts(void)
+{
+  return &bindingCacheCounts;
+}
+
 // This is an ineffecient way to generate a random key for the host.
 // If there is a pseudo random number generator available on the host,
 // that may be a better mechanism.
@@ -318,6 +443,7 @@ void emAfResetAndInitNCP(void)
   boolean memoryAllocation;
 
   emberAfPreNcpResetCallback();
+  bindingCacheValid = FALSE;
 
   // ezspInit resets the NCP by calling halNcpHardReset on a SPI host or
   // ashResetNcp on a UART host
@@ -477,6 +603,8 @@ void emAfResetAndInitNCP(void)
   MEMSET(cachedConfigIdValues, 0xFF, ((EZSP_CONFIG_ID_MAX + 1) * sizeof(int16u)));
   cacheConfigIdValuesAllowed = TRUE;
   emberAfGetEui64(emLocalEui64);
+
+  loadBindingCache();
 }
 
 // *******************************************************************
@@ -547,10 +675,9 @@ int main( MAIN_FUNCTION_PARAMETERS )
     }
 
     // Wait until ECC operations are done.  Don't allow any of the clusters
-    // to send messages as the NCP is busy doing ECC
-    if (emAfIsCryptoOperationInProgress()) {
-      continue;
-    }
+    // to send messages as the NCP is busy doing ECC.  emberAfTick() and
+    // emberAfRunEvents() hold back their work until then, while NCP
+    // callbacks and the CLI keep being processed.
 
     // let the ZCL Utils run - this should go after ezspTick
     emberAfTick();
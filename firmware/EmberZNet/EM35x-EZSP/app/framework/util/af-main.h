@@ -30,6 +30,10 @@ void emberAfGetMfgString(int8u* returnData);
 // Functions common to both SOC and Host versions of the application.
 boolean emberAfIsFullSmartEnergySecurityPresent(void);
 
+// Sends the signed messages that were held back while a crypto operation was
+// in progress.
+void emAfSendQueuedSignedMessages(void);
+
 #if defined(EZSP_HOST)
   void emAfClearNetworkCache(int8u networkIndex);
 #else
@@ -65,6 +69,16 @@ EmberStatus emberAfEzspSetSourceRoute(EmberNodeId id);
 
 boolean emberAfNcpNeedsReset(void);
 
+// Counts of reads and changes to the host's copy of the binding table.
+// Every host read is an EZSP getBinding command saved.
+typedef struct {
+  int32u hostReads;   // entries read from the host's copy
+  int32u ezspReads;   // entries read from the NCP
+  int32u updates;     // changes made to the host's copy
+} EmberAfBindingCacheCounts;
+
+const EmberAfBindingCacheCounts *emAfGetBindingCacheCounts(void);
+
 #endif // EZSP_HOST
 
 void emAfPrintStatus(PGM_P task,
@@ -62,12 +62,72 @@ const int16u clusterManufacturerCodeCount = GENERATED_CLUSTER_MANUFACTURER_CODE_
 const EmberAfManufacturerCodeEntry attributeManufacturerCodes[] = GENERATED_ATTRIBUTE_MANUFACTURER_CODES;
 const int16u attributeManufacturerCodeCount = GENERATED_ATTRIBUTE_MANUFACTURER_CODE_COUNT;
 
+// Hosts keep a hash index of every attribute on every endpoint so that
+// emAfReadOrWriteAttribute() need not walk the endpoint, cluster and attribute
+// tables.  The index takes one entry per attribute per endpoint, so SoC
+// applications only get it if they define EMBER_AF_ATTRIBUTE_INDEX_SIZE.
+#if defined(EZSP_HOST) && !defined(EMBER_AF_ATTRIBUTE_INDEX_SIZE)
+  #define EMBER_AF_ATTRIBUTE_INDEX_SIZE                                      \
+    (MAX_ENDPOINT_COUNT                                                      \
+     * (sizeof(generatedAttributes) / sizeof(EmberAfAttributeMetadata)))
+#endif
+
+#ifdef EMBER_AF_ATTRIBUTE_INDEX_SIZE
+#define ATTRIBUTE_INDEX_NULL 0xFFFF
+
+// Cluster readers step through a few attributes before using the index.
+#define CLUSTER_READER_STEPS_BEFORE_INDEX 4
+
+typedef struct {
+  EmberAfAttributeMetadata *metadata;
+  EmberAfCluster *cluster;
+  int8u *location;           // where the value is kept, unless external
+  int16u manufacturerCode;   // the cluster's, if it is manufacturer specific
+  int16u next;               // next entry in the same hash chain
+  int8u endpointIndex;
+} AttributeIndexEntry;
+
+static AttributeIndexEntry attributeIndex[EMBER_AF_ATTRIBUTE_INDEX_SIZE];
+static int16u attributeIndexBuckets[EMBER_AF_ATTRIBUTE_INDEX_SIZE];
+static boolean attributeIndexValid = FALSE;
+#endif // EMBER_AF_ATTRIBUTE_INDEX_SIZE
+
+// Hosts also keep a hash index of every cluster on every endpoint, because
+// emberAfFindCluster() is called for each incoming command by the generated
+// command parser and would otherwise walk the endpoint's cluster table.
+#if defined(EZSP_HOST) && !defined(EMBER_AF_CLUSTER_INDEX_SIZE)
+  #define EMBER_AF_CLUSTER_INDEX_SIZE                                        \
+    (MAX_ENDPOINT_COUNT * (sizeof(generatedClusters) / sizeof(EmberAfCluster)))
+#endif
+
+#ifdef EMBER_AF_CLUSTER_INDEX_SIZE
+#define CLUSTER_INDEX_NULL 0xFFFF
+
+typedef struct {
+  EmberAfCluster *cluster;
+  int16u next;               // next entry in the same hash chain
+  int8u endpointIndex;
+} ClusterIndexEntry;
+
+static ClusterIndexEntry clusterIndex[EMBER_AF_CLUSTER_INDEX_SIZE];
+static int16u clusterIndexBuckets[EMBER_AF_CLUSTER_INDEX_SIZE];
+static boolean clusterIndexValid = FALSE;
+#endif // EMBER_AF_CLUSTER_INDEX_SIZE
+
 //------------------------------------------------------------------------------
 // Forward declarations
 
 // Returns endpoint index within a given cluster
 static int8u findClusterEndpointIndex(int8u endpoint, EmberAfClusterId clusterId, int8u mask);
 
+#ifdef EMBER_AF_ATTRIBUTE_INDEX_SIZE
+static void buildAttributeIndex(void);
+#endif
+
+#ifdef EMBER_AF_CLUSTER_INDEX_SIZE
+static void buildClusterIndex(void);
+#endif
+
 //------------------------------------------------------------------------------
 
 // Initial configuration
@@ -107,6 +167,13 @@ void emberAfEndpointConfigure(void) {
     }
   }
 #endif // FIXED_ENDPOINT_COUNT
+
+#ifdef EMBER_AF_ATTRIBUTE_INDEX_SIZE
+  buildAttributeIndex();
+#endif
+#ifdef EMBER_AF_CLUSTER_INDEX_SIZE
+  buildClusterIndex();
+#endif
 }
 
 int8u emberAfEndpointCount() 
@@ -407,24 +474,118 @@ boolean emAfMatchAttribute(EmberAfCluster *cluster,
 // both and makes the code a bit easier to read.
 typedef EmberAfStatus (*ExternalReadWriteCallback)(int8u, EmberAfClusterId, EmberAfAttributeMetadata *, int16u, int8u *);
 
-// When reading non-string attributes, this function returns an error when destination
-// buffer isn't large enough to accommodate the attribute type.  For strings, the
-// function will copy at most readLength bytes.  This means the resulting string
-// may be truncated.  The length byte(s) in the resulting string will reflect
-// any truncation.  If readLength is zero, we are working with backwards-
-// compatibility wrapper functions and we just cross our fingers and hope for
-// the best.
-//
-// When writing attributes, readLength is ignored.  For non-string attributes,
-// this function assumes the source buffer is the same size as the attribute
-// type.  For strings, the function will copy as many bytes as will fit in the
-// attribute.  This means the resulting string may be truncated.  The length
-// byte(s) in the resulting string will reflect any truncated.
-EmberAfStatus emAfReadOrWriteAttribute(EmberAfAttributeSearchRecord *attRecord,
-                                       EmberAfAttributeMetadata **metadata,
-                                       int8u *buffer,
-                                       int16u readLength,
-                                       boolean write)
+#ifdef EMBER_AF_ATTRIBUTE_INDEX_SIZE
+static int16u attributeIndexHash(int8u endpoint,
+                                 EmberAfClusterId clusterId,
+                                 EmberAfAttributeId attributeId,
+                                 int16u manufacturerCode)
+{
+  int32u hash = endpoint;
+  hash = hash * 31 + clusterId;
+  hash = hash * 31 + attributeId;
+  hash = hash * 31 + manufacturerCode;
+  return (int16u)(hash % EMBER_AF_ATTRIBUTE_INDEX_SIZE);
+}
+
+// Indexes every attribute on every endpoint, enabled or not, with the same
+// data offsets the table walk in findAttributeByWalk() arrives at.  The
+// layout of attributeData only depends on the endpoint configuration, so
+// enabling and disabling endpoints does not call for a rebuild; lookups skip
+// disabled endpoints instead.  Chains are kept in table order so that the
+// first match is the one the walk would find.
+static void buildAttributeIndex(void)
+{
+  int16u count = 0;
+  int16u endpointOffset = 0;
+  int8u ep;
+
+  MEMSET(attributeIndexBuckets, 0xFF, sizeof(attributeIndexBuckets));
+  attributeIndexValid = FALSE;
+
+  for (ep = 0; ep < emberAfEndpointCount(); ep++) {
+    EmberAfEndpointType *endpointType = emAfEndpoints[ep].endpointType;
+    int16u clusterOffset = endpointOffset;
+    int8u clusterIndex;
+    for (clusterIndex = 0;
+         clusterIndex < endpointType->clusterCount;
+         clusterIndex++) {
+      EmberAfCluster *cluster = &(endpointType->cluster[clusterIndex]);
+      int16u attributeOffset = clusterOffset;
+      int16u attrIndex;
+      for (attrIndex = 0; attrIndex < cluster->attributeCount; attrIndex++) {
+        EmberAfAttributeMetadata *am = &(cluster->attributes[attrIndex]);
+        AttributeIndexEntry *entry;
+        int16u *link;
+
+        if (count == EMBER_AF_ATTRIBUTE_INDEX_SIZE
+            || count == ATTRIBUTE_INDEX_NULL) {
+          return;   // leave lookups to the table walk
+        }
+        entry = &attributeIndex[count];
+        entry->metadata = am;
+        entry->cluster = cluster;
+        entry->manufacturerCode = emAfGetManufacturerCodeForAttribute(cluster,
+                                                                      am);
+        entry->next = ATTRIBUTE_INDEX_NULL;
+        entry->endpointIndex = ep;
+        if (am->mask & ATTRIBUTE_MASK_SINGLETON) {
+          entry->location = singletonAttributeLocation(am);
+        } else if (am->mask & ATTRIBUTE_MASK_EXTERNAL_STORAGE) {
+          entry->location = NULL;
+        } else {
+          entry->location = attributeData + attributeOffset;
+          attributeOffset += emberAfAttributeSize(am);
+        }
+
+        link = &attributeIndexBuckets[attributeIndexHash(emAfEndpoints[ep].endpoint,
+                                                         cluster->clusterId,
+                                                         am->attributeId,
+                                                         entry->manufacturerCode)];
+        while (*link != ATTRIBUTE_INDEX_NULL) {
+          link = &attributeIndex[*link].next;
+        }
+        *link = count;
+        count++;
+      }
+      clusterOffset += cluster->clusterSize;
+    }
+    endpointOffset += endpointType->endpointSize;
+  }
+  attributeIndexValid = TRUE;
+}
+
+static boolean findAttributeInIndex(EmberAfAttributeSearchRecord *attRecord,
+                                    EmberAfCluster **cluster,
+                                    EmberAfAttributeMetadata **am,
+                                    int8u **location)
+{
+  int16u i = attributeIndexBuckets[attributeIndexHash(attRecord->endpoint,
+                                                      attRecord->clusterId,
+                                                      attRecord->attributeId,
+                                                      attRecord->manufacturerCode)];
+  while (i != ATTRIBUTE_INDEX_NULL) {
+    AttributeIndexEntry *entry = &attributeIndex[i];
+    if (entry->metadata->attributeId == attRecord->attributeId
+        && entry->cluster->clusterId == attRecord->clusterId
+        && (entry->cluster->mask & attRecord->clusterMask)
+        && entry->manufacturerCode == attRecord->manufacturerCode
+        && emAfEndpoints[entry->endpointIndex].endpoint == attRecord->endpoint
+        && emberAfEndpointIndexIsEnabled(entry->endpointIndex)) {
+      *cluster = entry->cluster;
+      *am = entry->metadata;
+      *location = entry->location;
+      return TRUE;
+    }
+    i = entry->next;
+  }
+  return FALSE;
+}
+#endif // EMBER_AF_ATTRIBUTE_INDEX_SIZE
+
+static boolean findAttributeByWalk(EmberAfAttributeSearchRecord *attRecord,
+                                   EmberAfCluster **foundCluster,
+                                   EmberAfAttributeMetadata **foundAm,
+                                   int8u **location)
 {
   int8u i;
   int16u attributeOffsetIndex = 0;
@@ -449,44 +610,12 @@ EmberAfStatus emAfReadOrWriteAttribute(EmberAfAttributeSearchRecord *attRecord,
             if (emAfMatchAttribute(cluster,
                                    am,
                                    attRecord)) { // Got the attribute
-
-              // If passed metadata location is not null, populate
-              if (metadata != NULL) {
-                *metadata = am;
-              }
-
-              {
-                int8u *attributeLocation = (am->mask & ATTRIBUTE_MASK_SINGLETON
-                                            ? singletonAttributeLocation(am)
-                                            : attributeData + attributeOffsetIndex);
-                int8u *src, *dst;
-                ExternalReadWriteCallback callback;
-                if (write) {
-                  src = buffer;
-                  dst = attributeLocation;
-                  callback = &emberAfExternalAttributeWriteCallback;
-                } else {
-                  if (buffer == NULL) {
-                    return EMBER_ZCL_STATUS_SUCCESS;
-                  }
-
-                  src = attributeLocation;
-                  dst = buffer;
-                  callback = &emberAfExternalAttributeReadCallback;
-                }
-
-                return (am->mask & ATTRIBUTE_MASK_EXTERNAL_STORAGE
-                        ? (*callback)(attRecord->endpoint,
-                                      attRecord->clusterId,
-                                      am,
-                                      emAfGetManufacturerCodeForAttribute(cluster, am),
-                                      buffer)
-                        : typeSensitiveMemCopy(dst,
-                                               src,
-                                               am,
-                                               write,
-                                               readLength));
-              }
+              *foundCluster = cluster;
+              *foundAm = am;
+              *location = (am->mask & ATTRIBUTE_MASK_SINGLETON
+                           ? singletonAttributeLocation(am)
+                           : attributeData + attributeOffsetIndex);
+              return TRUE;
             } else { // Not the attribute we are looking for
               // Increase the index if attribute is not externally stored
               if (!(am->mask & ATTRIBUTE_MASK_EXTERNAL_STORAGE)
@@ -503,7 +632,253 @@ EmberAfStatus emAfReadOrWriteAttribute(EmberAfAttributeSearchRecord *attRecord,
       attributeOffsetIndex += emAfEndpoints[i].endpointType->endpointSize;
     }
   }
-  return EMBER_ZCL_STATUS_UNSUPPORTED_ATTRIBUTE; // Sorry, attribute was not found.
+  return FALSE;
+}
+
+// When reading non-string attributes, this function returns an error when destination
+// buffer isn't large enough to accommodate the attribute type.  For strings, the
+// function will copy at most readLength bytes.  This means the resulting string
+// may be truncated.  The length byte(s) in the resulting string will reflect
+// any truncation.  If readLength is zero, we are working with backwards-
+// compatibility wrapper functions and we just cross our fingers and hope for
+// the best.
+//
+// When writing attributes, readLength is ignored.  For non-string attributes,
+// this function assumes the source buffer is the same size as the attribute
+// type.  For strings, the function will copy as many bytes as will fit in the
+// attribute.  This means the resulting string may be truncated.  The length
+// byte(s) in the resulting string will reflect any truncated.
+static boolean findAttribute(EmberAfAttributeSearchRecord *attRecord,
+                             EmberAfCluster **cluster,
+                             EmberAfAttributeMetadata **am,
+                             int8u **location)
+{
+#ifdef EMBER_AF_ATTRIBUTE_INDEX_SIZE
+  return (attributeIndexValid
+          ? findAttributeInIndex(attRecord, cluster, am, location)
+          : findAttributeByWalk(attRecord, cluster, am, location));
+#else
+  return findAttributeByWalk(attRecord, cluster, am, location);
+#endif
+}
+
+EmberAfStatus emAfReadOrWriteAttribute(EmberAfAttributeSearchRecord *attRecord,
+                                       EmberAfAttributeMetadata **metadata,
+                                       int8u *buffer,
+                                       int16u readLength,
+                                       boolean write)
+{
+  EmberAfCluster *cluster;
+  EmberAfAttributeMetadata *am;
+  int8u *attributeLocation;
+  int8u *src, *dst;
+  ExternalReadWriteCallback callback;
+
+  if (!findAttribute(attRecord, &cluster, &am, &attributeLocation)) {
+    return EMBER_ZCL_STATUS_UNSUPPORTED_ATTRIBUTE; // Sorry, attribute was not found.
+  }
+
+  // If passed metadata location is not null, populate
+  if (metadata != NULL) {
+    *metadata = am;
+  }
+
+  if (write) {
+    src = buffer;
+    dst = attributeLocation;
+    callback = &emberAfExternalAttributeWriteCallback;
+  } else {
+    if (buffer == NULL) {
+      return EMBER_ZCL_STATUS_SUCCESS;
+    }
+
+    src = attributeLocation;
+    dst = buffer;
+    callback = &emberAfExternalAttributeReadCallback;
+  }
+
+  return (am->mask & ATTRIBUTE_MASK_EXTERNAL_STORAGE
+          ? (*callback)(attRecord->endpoint,
+                        attRecord->clusterId,
+                        am,
+                        emAfGetManufacturerCodeForAttribute(cluster, am),
+                        buffer)
+          : typeSensitiveMemCopy(dst,
+                                 src,
+                                 am,
+                                 write,
+                                 readLength));
+}
+
+// Finds the first matching cluster on an enabled endpoint, and where its
+// attributes are stored, for reading several of its attributes in turn.  It
+// also notes whether any later cluster matches, since only then can an
+// attribute missing from the first one be found elsewhere.
+boolean emAfFindClusterForRead(EmAfClusterReader *reader,
+                               int8u endpoint,
+                               EmberAfClusterId clusterId,
+                               int8u mask,
+                               int16u manufacturerCode)
+{
+  int16u endpointOffset = 0;
+  int8u i;
+
+  reader->record.endpoint = endpoint;
+  reader->record.clusterId = clusterId;
+  reader->record.clusterMask = mask;
+  reader->record.attributeId = 0;
+  reader->record.manufacturerCode = manufacturerCode;
+  reader->cluster = NULL;
+  reader->moreClusters = FALSE;
+  reader->foundMetadata = NULL;
+
+  for (i = 0; i < emberAfEndpointCount(); i++) {
+    EmberAfEndpointType *endpointType = emAfEndpoints[i].endpointType;
+    if (emAfEndpoints[i].endpoint == endpoint
+        && emberAfEndpointIndexIsEnabled(i)) {
+      int16u clusterOffset = endpointOffset;
+      int8u clusterIndex;
+      for (clusterIndex = 0;
+           clusterIndex < endpointType->clusterCount;
+           clusterIndex++) {
+        EmberAfCluster *cluster = &(endpointType->cluster[clusterIndex]);
+        if (!emAfMatchCluster(cluster, &reader->record)) {
+          // Not the cluster we are looking for
+        } else if (reader->cluster == NULL) {
+          reader->cluster = cluster;
+          reader->data = attributeData + clusterOffset;
+          reader->nextIndex = 0;
+          reader->nextData = reader->data;
+        } else {
+          reader->moreClusters = TRUE;
+          return TRUE;
+        }
+        clusterOffset += cluster->clusterSize;
+      }
+    }
+    endpointOffset += endpointType->endpointSize;
+  }
+  return (reader->cluster != NULL);
+}
+
+// The search starts after the attribute found last and wraps around, so
+// attributes asked for in the order they are stored are found in a single
+// pass over the cluster.  With the attribute index, a lookup costs about as
+// much as a few steps of the search, so only the next few attributes are
+// tried before it.  An attribute that is not in the reader's cluster may
+// still be in a later matching cluster, such as the client side when both
+// sides are asked for, so then the full search gets the last word.
+EmberAfAttributeMetadata *emAfFindClusterAttribute(EmAfClusterReader *reader,
+                                                   EmberAfAttributeId attributeId)
+{
+  EmberAfCluster *cluster = reader->cluster;
+  int16u index = reader->nextIndex;
+  int8u *data = reader->nextData;
+  int16u steps;
+  int16u n;
+
+  reader->record.attributeId = attributeId;
+  reader->foundMetadata = NULL;
+  if (cluster == NULL) {
+    return NULL;
+  }
+
+  steps = cluster->attributeCount;
+#ifdef EMBER_AF_ATTRIBUTE_INDEX_SIZE
+  if (attributeIndexValid && steps > CLUSTER_READER_STEPS_BEFORE_INDEX) {
+    steps = CLUSTER_READER_STEPS_BEFORE_INDEX;
+  }
+#endif
+
+  for (n = 0; n < steps; n++) {
+    EmberAfAttributeMetadata *am;
+    if (index == cluster->attributeCount) {
+      index = 0;
+      data = reader->data;
+    }
+    am = &(cluster->attributes[index]);
+    index++;
+    if (emAfMatchAttribute(cluster, am, &reader->record)) {
+      reader->foundCluster = cluster;
+      reader->foundMetadata = am;
+      if (am->mask & ATTRIBUTE_MASK_SINGLETON) {
+        reader->foundLocation = singletonAttributeLocation(am);
+      } else if (am->mask & ATTRIBUTE_MASK_EXTERNAL_STORAGE) {
+        reader->foundLocation = NULL;
+      } else {
+        reader->foundLocation = data;
+        data += emberAfAttributeSize(am);
+      }
+      reader->nextIndex = index;
+      reader->nextData = data;
+      return am;
+    }
+    if (!(am->mask & ATTRIBUTE_MASK_EXTERNAL_STORAGE)
+        && !(am->mask & ATTRIBUTE_MASK_SINGLETON)) {
+      data += emberAfAttributeSize(am);
+    }
+  }
+
+  if ((steps == cluster->attributeCount && !reader->moreClusters)
+      || !findAttribute(&reader->record,
+                        &reader->foundCluster,
+                        &reader->foundMetadata,
+                        &reader->foundLocation)) {
+    reader->foundMetadata = NULL;
+  } else if (reader->foundCluster == cluster
+             && !(reader->foundMetadata->mask
+                  & (ATTRIBUTE_MASK_SINGLETON
+                     | ATTRIBUTE_MASK_EXTERNAL_STORAGE))) {
+    // Carry on from here next time.
+    reader->nextIndex = reader->foundMetadata - cluster->attributes + 1;
+    reader->nextData = (reader->foundLocation
+                        + emberAfAttributeSize(reader->foundMetadata));
+  }
+  return reader->foundMetadata;
+}
+
+// Reads the attribute found last, with the same semantics as
+// emAfReadOrWriteAttribute().
+EmberAfStatus emAfReadFoundAttribute(EmAfClusterReader *reader,
+                                     int8u *buffer,
+                                     int16u readLength)
+{
+  EmberAfAttributeMetadata *am = reader->foundMetadata;
+  if (am == NULL) {
+    return EMBER_ZCL_STATUS_UNSUPPORTED_ATTRIBUTE;
+  }
+  if (buffer == NULL) {
+    return EMBER_ZCL_STATUS_SUCCESS;
+  }
+  return (am->mask & ATTRIBUTE_MASK_EXTERNAL_STORAGE
+          ? emberAfExternalAttributeReadCallback(reader->record.endpoint,
+                                                 reader->record.clusterId,
+                                                 am,
+                                                 emAfGetManufacturerCodeForAttribute(reader->foundCluster,
+                                                                                     am),
+                                                 buffer)
+          : typeSensitiveMemCopy(buffer,
+                                 reader->foundLocation,
+                                 am,
+                                 FALSE,
+                                 readLength));
+}
+
+EmberAfStatus emAfReadClusterAttribute(EmAfClusterReader *reader,
+                                       EmberAfAttributeId attributeId,
+                                       int8u *buffer,
+                                       int16u readLength,
+                                       EmberAfAttributeType *dataType)
+{
+  EmberAfStatus status;
+  if (emAfFindClusterAttribute(reader, attributeId) == NULL) {
+    return EMBER_ZCL_STATUS_UNSUPPORTED_ATTRIBUTE;
+  }
+  status = emAfReadFoundAttribute(reader, buffer, readLength);
+  if (status == EMBER_ZCL_STATUS_SUCCESS && dataType != NULL) {
+    *dataType = reader->foundMetadata->attributeType;
+  }
+  return status;
 }
 
 // mask = 0 -> find either client or server
@@ -556,10 +931,86 @@ boolean emberAfContainsClient(int8u endpoint, EmberAfClusterId clusterId) {
   return ( emberAfFindCluster(endpoint, clusterId, CLUSTER_MASK_CLIENT) != NULL );
 }
 
+#ifdef EMBER_AF_CLUSTER_INDEX_SIZE
+static int16u clusterIndexHash(int8u endpoint, EmberAfClusterId clusterId)
+{
+  int32u hash = endpoint;
+  hash = hash * 31 + clusterId;
+  return (int16u)(hash % EMBER_AF_CLUSTER_INDEX_SIZE);
+}
+
+// Indexes every cluster on every endpoint, enabled or not, so that enabling
+// and disabling endpoints does not call for a rebuild; lookups skip disabled
+// endpoints instead.  Client and server clusters share a chain, which is kept
+// in table order so that the first match is the one
+// emberAfFindClusterInType() would find.
+static void buildClusterIndex(void)
+{
+  int16u count = 0;
+  int8u ep;
+
+  MEMSET(clusterIndexBuckets, 0xFF, sizeof(clusterIndexBuckets));
+  clusterIndexValid = FALSE;
+
+  for (ep = 0; ep < emberAfEndpointCount(); ep++) {
+    EmberAfEndpointType *endpointType = emAfEndpoints[ep].endpointType;
+    int8u i;
+    for (i = 0; i < endpointType->clusterCount; i++) {
+      EmberAfCluster *cluster = &(endpointType->cluster[i]);
+      int16u *link;
+
+      if (count == EMBER_AF_CLUSTER_INDEX_SIZE
+          || count == CLUSTER_INDEX_NULL) {
+        return;   // leave lookups to the table walk
+      }
+      clusterIndex[count].cluster = cluster;
+      clusterIndex[count].next = CLUSTER_INDEX_NULL;
+      clusterIndex[count].endpointIndex = ep;
+
+      link = &clusterIndexBuckets[clusterIndexHash(emAfEndpoints[ep].endpoint,
+                                                   cluster->clusterId)];
+      while (*link != CLUSTER_INDEX_NULL) {
+        link = &clusterIndex[*link].next;
+      }
+      *link = count;
+      count++;
+    }
+  }
+  clusterIndexValid = TRUE;
+}
+
+static EmberAfCluster *findClusterInIndex(int8u endpoint,
+                                          EmberAfClusterId clusterId,
+                                          int8u mask)
+{
+  int16u i = clusterIndexBuckets[clusterIndexHash(endpoint, clusterId)];
+  while (i != CLUSTER_INDEX_NULL) {
+    ClusterIndexEntry *entry = &clusterIndex[i];
+    EmberAfCluster *cluster = entry->cluster;
+    if (cluster->clusterId == clusterId
+        && emAfEndpoints[entry->endpointIndex].endpoint == endpoint
+        && emberAfEndpointIndexIsEnabled(entry->endpointIndex)
+        && (mask == 0
+            || (mask == CLUSTER_MASK_CLIENT && emberAfClusterIsClient(cluster))
+            || (mask == CLUSTER_MASK_SERVER && emberAfClusterIsServer(cluster)))) {
+      return cluster;
+    }
+    i = entry->next;
+  }
+  return NULL;
+}
+#endif // EMBER_AF_CLUSTER_INDEX_SIZE
+
 EmberAfCluster *emberAfFindCluster(int8u endpoint, 
                                    EmberAfClusterId clusterId, 
                                    int8u mask) {
-  int8u ep = emberAfIndexFromEndpoint(endpoint);
+  int8u ep;
+#ifdef EMBER_AF_CLUSTER_INDEX_SIZE
+  if (clusterIndexValid) {
+    return findClusterInIndex(endpoint, clusterId, mask);
+  }
+#endif
+  ep = emberAfIndexFromEndpoint(endpoint);
   if ( ep == 0xFF ) 
     return NULL;
   else
@@ -649,6 +1100,7 @@ boolean emberAfEndpointEnableDisable(int8u endpoint, boolean enable)
                         : EZSP_ENDPOINT_DISABLED));
 #endif
 
+  // The attribute index covers disabled endpoints too, so it stays valid.
   if (currentlyEnabled ^ enable) {
     if (enable) {
       initializeEndpoint(&(emAfEndpoints[index]));
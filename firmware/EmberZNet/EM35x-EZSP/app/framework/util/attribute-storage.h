@@ -72,6 +72,40 @@ EmberAfStatus emAfReadOrWriteAttribute(EmberAfAttributeSearchRecord *attRecord,
                                        int16u maxLength,
                                        boolean write);
 
+// Reads attributes of one cluster, finding the cluster only once.  Set up
+// with emAfFindClusterForRead(), which returns FALSE if the cluster is not on
+// the endpoint.  emAfFindClusterAttribute() finds an attribute, or returns
+// NULL, and emAfReadFoundAttribute() reads the attribute found last;
+// emAfReadClusterAttribute() does both.  The reads behave like
+// emAfReadOrWriteAttribute().
+typedef struct {
+  EmberAfAttributeSearchRecord record;
+  EmberAfCluster *cluster;       // NULL if the cluster was not found
+  boolean moreClusters;          // TRUE if a later cluster also matches
+  int8u *data;                   // storage of the cluster's first attribute
+  int16u nextIndex;              // where the next search starts
+  int8u *nextData;               // and its storage
+  EmberAfCluster *foundCluster;  // the attribute found last
+  EmberAfAttributeMetadata *foundMetadata;
+  int8u *foundLocation;          // NULL for externally stored attributes
+} EmAfClusterReader;
+
+boolean emAfFindClusterForRead(EmAfClusterReader *reader,
+                               int8u endpoint,
+                               EmberAfClusterId clusterId,
+                               int8u mask,
+                               int16u manufacturerCode);
+EmberAfAttributeMetadata *emAfFindClusterAttribute(EmAfClusterReader *reader,
+                                                   EmberAfAttributeId attributeId);
+EmberAfStatus emAfReadFoundAttribute(EmAfClusterReader *reader,
+                                     int8u *buffer,
+                                     int16u readLength);
+EmberAfStatus emAfReadClusterAttribute(EmAfClusterReader *reader,
+                                       EmberAfAttributeId attributeId,
+                                       int8u *buffer,
+                                       int16u readLength,
+                                       EmberAfAttributeType *dataType);
+
 boolean emAfMatchCluster(EmberAfCluster *cluster,
                          EmberAfAttributeSearchRecord *attRecord);
 boolean emAfMatchAttribute(EmberAfCluster *cluster,
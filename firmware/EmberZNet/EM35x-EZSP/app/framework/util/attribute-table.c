@@ -277,20 +277,19 @@ boolean emberAfReadSequentialAttributesAddToResponse(int8u endpoint,
   int16u discovered = 0;
   int16u skipped = 0;
   int16u total = 0;
+  EmberAfCluster *cluster;
+  EmAfClusterReader reader;
+  EmberAfAttributeSearchRecord *record = &reader.record;
 
-  EmberAfCluster *cluster = emberAfFindCluster(endpoint, clusterId, mask);
-
-  EmberAfAttributeSearchRecord record;
-  record.endpoint = endpoint;
-  record.clusterId = clusterId;
-  record.clusterMask = mask;
-  record.attributeId = startAttributeId;
-  record.manufacturerCode = manufacturerCode;
-  
   // If we don't have the cluster or it doesn't match the search, we're done.
-  if (cluster == NULL || !emAfMatchCluster(cluster, &record)) {
+  if (!emAfFindClusterForRead(&reader,
+                              endpoint,
+                              clusterId,
+                              mask,
+                              manufacturerCode)) {
     return TRUE;
   }
+  cluster = reader.cluster;
 
   for (i = 0; i < cluster->attributeCount; i++) {
     EmberAfAttributeMetadata *metadata = &cluster->attributes[i];
@@ -299,8 +298,8 @@ boolean emberAfReadSequentialAttributesAddToResponse(int8u endpoint,
     // only if its manufacturer code matches that of the command (which may be
     // unset).
     if (!emberAfClusterIsManufacturerSpecific(cluster)) {
-      record.attributeId = metadata->attributeId;
-      if (!emAfMatchAttribute(cluster, metadata, &record)) {
+      record->attributeId = metadata->attributeId;
+      if (!emAfMatchAttribute(cluster, metadata, record)) {
         continue;
       }
     }
@@ -406,20 +405,20 @@ void emberAfPrintAttributeTable(void)
   }
 }
 
-// given a clusterId and an attribute to read, this crafts the response
+// given a cluster reader and an attribute to read, this crafts the response
 // and places it in the response buffer. Response is one of two items:
 // 1) unsupported: [attrId:2] [status:1]
 // 2) supported:   [attrId:2] [status:1] [type:1] [data:n]
 //
-void emberAfRetrieveAttributeAndCraftResponse(int8u endpoint,
-                                              EmberAfClusterId clusterId,
-                                              EmberAfAttributeId attrId,
-                                              int8u mask,
-                                              int16u manufacturerCode,
-                                              int16u readLength)
+static void craftReadAttributeRecord(EmAfClusterReader *reader,
+                                     EmberAfAttributeId attrId,
+                                     int16u readLength)
 {
+  EmberAfAttributeMetadata *metadata;
   EmberAfStatus status;
   int8u data[ATTRIBUTE_LARGEST];
+  int8u *dataPtr = data;
+  int16u dataPtrLength = ATTRIBUTE_LARGEST;
   int8u dataType;
   int8u dataLen;
 
@@ -429,21 +428,27 @@ void emberAfRetrieveAttributeAndCraftResponse(int8u endpoint,
   }
 
   emberAfAttributesPrintln("OTA READ: ep:%x cid:%2x attid:%2x msk:%x mfcode:%2x", 
-                           endpoint, 
-                           clusterId, attrId, mask, manufacturerCode);
-
-  // lookup the attribute in our table
-  status = emAfReadAttribute(endpoint,
-                             clusterId,
-                             attrId,
-                             mask,
-                             manufacturerCode,
-                             data,
-                             ATTRIBUTE_LARGEST,
-                             &dataType);
+                           reader->record.endpoint, 
+                           reader->record.clusterId,
+                           attrId,
+                           reader->record.clusterMask,
+                           reader->record.manufacturerCode);
+
+  // lookup the attribute in our table.  Attributes kept in the attribute
+  // table are copied straight into the response buffer, after the space for
+  // their header, when they are sure to fit.
+  metadata = emAfFindClusterAttribute(reader, attrId);
+  if (metadata != NULL
+      && reader->foundLocation != NULL
+      && 4 + emberAfAttributeSize(metadata) < readLength) {
+    dataPtr = appResponseData + appResponseLength + 4;
+    dataPtrLength = emberAfAttributeSize(metadata);
+  }
+  status = emAfReadFoundAttribute(reader, dataPtr, dataPtrLength);
   if (status == EMBER_ZCL_STATUS_SUCCESS) {
+    dataType = metadata->attributeType;
     dataLen = (emberAfIsThisDataTypeAStringType(dataType)
-               ? emberAfStringLength(data) + 1
+               ? emberAfStringLength(dataPtr) + 1
                : emberAfGetDataSize(dataType));
     if (readLength < (4 + dataLen)) { // Not enough space for attribute.
       return;
@@ -452,7 +457,7 @@ void emberAfRetrieveAttributeAndCraftResponse(int8u endpoint,
     emberAfPutInt16uInResp(attrId);
     emberAfPutInt8uInResp(status);
     emberAfAttributesPrintln("READ: clus %2x, attr %2x failed %x",
-                             clusterId,
+                             reader->record.clusterId,
                              attrId,
                              status);
     emberAfAttributesFlush();
@@ -466,7 +471,20 @@ void emberAfRetrieveAttributeAndCraftResponse(int8u endpoint,
   emberAfPutInt8uInResp(EMBER_ZCL_STATUS_SUCCESS);
   emberAfPutInt8uInResp(dataType);
 
-  if ((appResponseLength + dataLen) < EMBER_AF_RESPONSE_BUFFER_LEN) {
+  if (dataPtr != data) {
+    // The data is already in place.
+#if (BIGENDIAN_CPU)
+    if (isThisDataTypeSentLittleEndianOTA(dataType)) {
+      int8u i;
+      for (i = 0; i < dataLen / 2; i++) {
+        int8u byte = dataPtr[i];
+        dataPtr[i] = dataPtr[dataLen - i - 1];
+        dataPtr[dataLen - i - 1] = byte;
+      }
+    }
+#endif //(BIGENDIAN_CPU)
+    appResponseLength += dataLen;
+  } else if ((appResponseLength + dataLen) < EMBER_AF_RESPONSE_BUFFER_LEN) {
 #if (BIGENDIAN_CPU)     
     // strings go over the air as length byte and then in human
     // readable format. These should not be flipped. Other attributes
@@ -486,12 +504,45 @@ void emberAfRetrieveAttributeAndCraftResponse(int8u endpoint,
   }
   
   emberAfAttributesPrintln("READ: clus %2x, attr %2x, dataLen: %x, OK",
-                           clusterId,
+                           reader->record.clusterId,
                            attrId,
                            dataLen);
   emberAfAttributesFlush();
 }
 
+void emberAfRetrieveAttributeAndCraftResponse(int8u endpoint,
+                                              EmberAfClusterId clusterId,
+                                              EmberAfAttributeId attrId,
+                                              int8u mask,
+                                              int16u manufacturerCode,
+                                              int16u readLength)
+{
+  EmAfClusterReader reader;
+  emAfFindClusterForRead(&reader, endpoint, clusterId, mask, manufacturerCode);
+  craftReadAttributeRecord(&reader, attrId, readLength);
+}
+
+// Adds a record to the response for each attribute ID in the list, which is
+// in the over-the-air format of a Read Attributes command.  The cluster is
+// found once for all of them.
+void emberAfRetrieveAttributesAndCraftResponse(int8u endpoint,
+                                               EmberAfClusterId clusterId,
+                                               int8u mask,
+                                               int16u manufacturerCode,
+                                               int8u *attrIds,
+                                               int16u attrIdsLength)
+{
+  EmAfClusterReader reader;
+  int16u index;
+  emAfFindClusterForRead(&reader, endpoint, clusterId, mask, manufacturerCode);
+  for (index = 0; index + 2 <= attrIdsLength; index += 2) {
+    craftReadAttributeRecord(&reader,
+                             emberAfGetInt16u(attrIds, index, attrIdsLength),
+                             (EMBER_AF_RESPONSE_BUFFER_LEN
+                              - appResponseLength));
+  }
+}
+
 // This function appends the attribute report fields for the given endpoint,
 // cluster, and attribute to the buffer starting at the index.  If there is
 // insufficient space in the buffer or an error occurs, buffer and bufIndex will
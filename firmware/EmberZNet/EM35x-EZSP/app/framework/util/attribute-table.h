@@ -30,6 +30,12 @@ void emberAfRetrieveAttributeAndCraftResponse(int8u endpoint,
                                               int8u mask,
                                               int16u manufacturerCode,
                                               int16u maxLength);
+void emberAfRetrieveAttributesAndCraftResponse(int8u endpoint,
+                                               EmberAfClusterId clusterId,
+                                               int8u mask,
+                                               int16u manufacturerCode,
+                                               int8u *attrIds,
+                                               int16u attrIdsLength);
 EmberAfStatus emberAfAppendAttributeReportFields(int8u endpoint,
                                                  EmberAfClusterId clusterId,
                                                  EmberAfAttributeId attributeId,
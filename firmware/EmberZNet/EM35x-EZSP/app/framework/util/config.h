@@ -178,6 +178,7 @@
 #define EZSP_APPLICATION_HAS_INCOMING_SENDER_EUI64_HANDLER
 #define EZSP_APPLICATION_HAS_TRUST_CENTER_JOIN_HANDLER
 #define EZSP_APPLICATION_HAS_BUTTON_HANDLER
+#define EZSP_APPLICATION_HAS_REMOTE_BINDING_HANDLER
 
 #if defined(EMBER_AF_PLUGIN_OTA_CLIENT_SIGNATURE_VERIFICATION_SUPPORT)
   #define EZSP_APPLICATION_HAS_DSA_VERIFY_HANDLER
@@ -89,25 +89,15 @@ boolean emAfProcessGlobalCommand(EmberAfClusterCommand *cmd)
       emberAfPutInt8uInResp(ZCL_READ_ATTRIBUTES_RESPONSE_COMMAND_ID);
 
       // This message contains N 2-byte attr IDs after the 3 byte ZCL header,
-      // for each one we need to look it up and make a response
-      while (msgIndex + 2 <= msgLen) {
-        // Get the attribute ID and store it in the response buffer
-        // least significant byte is first OTA
-        attrId = emberAfGetInt16u(message, msgIndex, msgLen);
-
-        // This function reads the attribute and creates the correct response
-        // in the response buffer
-        emberAfRetrieveAttributeAndCraftResponse(cmd->apsFrame->destinationEndpoint,
-                                                 clusterId,
-                                                 attrId,
-                                                 clientServerMask,
-                                                 cmd->mfgCode,
-                                                 (EMBER_AF_RESPONSE_BUFFER_LEN
-                                                  - appResponseLength));
-
-        // Go to next attrID
-        msgIndex += 2;
-      }
+      // for each one we need to look it up and make a response.  This
+      // function reads the attributes and creates the correct response in
+      // the response buffer, finding the cluster only once.
+      emberAfRetrieveAttributesAndCraftResponse(cmd->apsFrame->destinationEndpoint,
+                                                clusterId,
+                                                clientServerMask,
+                                                cmd->mfgCode,
+                                                message + msgIndex,
+                                                msgLen - msgIndex);
     }
     emberAfSendResponse();
     return TRUE;
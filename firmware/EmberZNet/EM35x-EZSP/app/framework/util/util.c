@@ -75,6 +75,12 @@ int8u emberAfApsRetryOverride = EMBER_AF_RETRY_OVERRIDE_NONE;
 // Holds the response type
 int8u emberAfResponseType = ZCL_UTIL_RESP_NORMAL;
 
+#ifdef EMBER_AF_PLUGIN_ZCL_BENCHMARK
+// Set while the ZCL Benchmark plugin replays frames, so that responses
+// and any other messages the replayed frames cause are built but not sent.
+boolean emAfSuppressSends = FALSE;
+#endif
+
 static EmberAfInterpanHeader interpanResponseHeader;
 
 #if EMBER_AF_PLUGIN_ADDRESS_TABLE_SIZE != 0
@@ -106,6 +112,8 @@ static TickFunction* PGM internalTickFunctions[] = {
 
   platformTick,
 
+  emAfSendQueuedSignedMessages,
+
   NULL            // terminator, must be last
 };
 
@@ -296,6 +304,11 @@ void emberAfTick(void)
       // Wait until ECC operations are done.  Don't allow
       // any of the clusters to send messages.  This is necessary
       // on host or SOC application.
+#if defined(EZSP_HOST)
+      // The host still waits for input from the NCP, the CLI and its other
+      // file descriptors, which sends nothing to the NCP.
+      platformTick();
+#endif
       return;
     }
 
@@ -589,6 +602,12 @@ EmberStatus emberAfSendResponse(void)
     return EMBER_SUCCESS;
   }
 
+#ifdef EMBER_AF_PLUGIN_ZCL_BENCHMARK
+  if (emAfSuppressSends) {
+    return EMBER_SUCCESS;
+  }
+#endif
+
   if (emberAfApsRetryOverride == EMBER_AF_RETRY_OVERRIDE_SET) {
     emberAfResponseApsFrame.options |= EMBER_APS_OPTION_RETRY;
   } else if (emberAfApsRetryOverride == EMBER_AF_RETRY_OVERRIDE_UNSET) {
@@ -121,5 +121,8 @@ boolean emAfProcessGlobalCommand(EmberAfClusterCommand *cmd);
 boolean emAfProcessClusterSpecificCommand(EmberAfClusterCommand *cmd);
 
 extern int8u emberAfResponseType;
+#ifdef EMBER_AF_PLUGIN_ZCL_BENCHMARK
+extern boolean emAfSuppressSends;
+#endif
 
 #endif // __AF_UTIL_H__
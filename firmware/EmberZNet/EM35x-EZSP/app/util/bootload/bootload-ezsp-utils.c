@@ -1340,7 +1340,7 @@ static boolean bootloadSendImage(int8u type)
 static void sendRadioMessage(int8u messageType, boolean isBroadcast)
 {
   // allow space for the longest possible message
-  int8u length=0, index, i, startByte, data, iMax;
+  int8u length=0, index, i, startByte, iMax;
   int16u crc = 0x0000;
 
 #ifndef GATEWAY_APP
@@ -1402,11 +1402,9 @@ static void sendRadioMessage(int8u messageType, boolean isBroadcast)
     } else {
       startByte = 64;
     }
-    for(i = index; i<(iMax + index); ++i) {
-      data = xmodemBlock[startByte++];
-      bootloadBuffer[i] = data;
-      crc = halCommonCrc16(data, crc);
-    }
+    MEMCOPY(bootloadBuffer + index, xmodemBlock + startByte, iMax);
+    crc = halCommonCrc16Block(xmodemBlock + startByte, iMax, crc);
+    i = index + iMax;
     // Include crc in the packet
     bootloadBuffer[i++] = HIGH_BYTE(crc);
     bootloadBuffer[i++] = LOW_BYTE(crc);
@@ -16,6 +16,10 @@
 // the error (such as the command ID, index EZSP_FRAME_ID_INDEX).
 extern int8u* ezspFrameContents;
 
+// The contents of the EZSP response or callback frame received most recently.
+// This may point to the same buffer as ezspFrameContents.
+extern int8u* ezspResponseContents;
+
 // This pointer steps through the received frame as the contents are read.
 extern int8u* ezspReadPointer;
 
@@ -39,10 +39,38 @@
  * number of packet buffers available on the ncp, because this
  * in turn is the maximum number of callbacks that could be received between
  * commands.  In reality a value of 20 is a generous allocation.
+ * Hosts that must absorb long callback bursts may raise it as far as a
+ * few thousand: the ASH queue and free list operations take constant time,
+ * so a larger pool costs memory but no extra processing per tick.
  */
   #define EZSP_HOST_ASH_RX_POOL_SIZE 20
 #endif
 
+#if EZSP_HOST_ASH_RX_POOL_SIZE > 0xFFF0
+  #error "EZSP_HOST_ASH_RX_POOL_SIZE must fit an ASH queue length (int16u)"
+#endif
+
+#ifndef EZSP_HOST_MAX_PENDING_COMMANDS
+/** @brief The maximum number of asynchronous EZSP commands that can be
+ * waiting for responses at the same time.
+ *
+ * Commands sent with ::ezspSendAsyncCommand() beyond this number wait for
+ * the oldest outstanding command to complete.  For UART hosts a value equal
+ * to the ASH transmit window (txK, 3 by default) keeps the window full.
+ * The SPI protocol carries only one command per transaction, so SPI hosts,
+ * and any host that does not define EZSP_UART, default to 1.
+ */
+  #if defined(EZSP_UART) && !defined(EZSP_SPI)
+    #define EZSP_HOST_MAX_PENDING_COMMANDS 3
+  #else
+    #define EZSP_HOST_MAX_PENDING_COMMANDS 1
+  #endif
+#endif
+
+#if EZSP_HOST_MAX_PENDING_COMMANDS < 1 || EZSP_HOST_MAX_PENDING_COMMANDS > 255
+  #error "EZSP_HOST_MAX_PENDING_COMMANDS must be between 1 and 255"
+#endif
+
 #ifndef EZSP_HOST_FORM_AND_JOIN_BUFFER_SIZE
 /** @brief The size of the buffer for caching data during scans.
  *
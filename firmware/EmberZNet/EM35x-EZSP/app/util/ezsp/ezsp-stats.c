@@ -0,0 +1,345 @@
+// File: ezsp-stats.c
+//
+// Description: EZSP latency, callback and ASH queue depth statistics for UART
+// hosts. See ezsp-stats.h.
+//
+// Copyright 2010 by Ember Corporation. All rights reserved.                *80*
+
+#include PLATFORM_HEADER
+
+#include <time.h>
+
+#include "stack/include/ember-types.h"
+
+#include "hal/hal.h"
+#include "app/util/ezsp/ezsp-protocol.h"
+#include "app/util/ezsp/ezsp-enum-decode.h"
+#include "app/util/ezsp/ezsp-stats.h"
+
+//------------------------------------------------------------------------------
+// Preprocessor definitions
+
+#define LINEAR_BUCKETS      16    // one microsecond wide
+#define SUB_BUCKETS         4     // per power of two above that
+#define SUB_BUCKET_BITS     2
+#define FIRST_LOG_EXPONENT  4     // log2(LINEAR_BUCKETS)
+#define HISTOGRAM_BUCKETS   (LINEAR_BUCKETS                                 \
+                             + (32 - FIRST_LOG_EXPONENT) * SUB_BUCKETS)
+
+#define NO_SLOT             0xFF
+
+// Outstanding commands are kept in a ring, indexed by an int8u.
+#define SENT_RING_SIZE      256
+
+enum {
+  QUEUE_RX,
+  QUEUE_TX,
+  QUEUE_RETX,
+  QUEUE_COUNT
+};
+
+//------------------------------------------------------------------------------
+// Types
+
+typedef struct {
+  int8u frameId;
+  int32u count;
+  int32u minUs;
+  int32u maxUs;
+  int32u buckets[HISTOGRAM_BUCKETS];
+} LatencyHistogram;
+
+typedef struct {
+  int8u frameId;
+  int32u sentUs;
+} SentCommand;
+
+typedef struct {
+  int16u current;
+  int16u max;
+  int32u total;                       // sum of the samples
+} QueueDepth;
+
+//------------------------------------------------------------------------------
+// Local Variables
+
+static LatencyHistogram histograms[EZSP_STATS_MAX_FRAME_IDS];
+static int8u histogramCount;
+static int8u slotByFrameId[256];      // index into histograms, or NO_SLOT
+static boolean slotsInitialized = FALSE;
+static int32u untimedCommands;        // commands with no histogram slot
+
+static SentCommand sentCommands[SENT_RING_SIZE];
+static int8u sentHead;
+static int16u sentCount;
+static int32u startedUs;
+
+static int32u callbackCounts[256];
+
+static QueueDepth queueDepths[QUEUE_COUNT];
+static int32u queueSamples;
+static int32u queueWindowStartMs;
+
+static FILE *logFile = NULL;
+static int32u logIntervalMs;
+static int32u logLastMs;
+
+static const char * const queueNames[QUEUE_COUNT] =
+  { "rxQueue", "txQueue", "reTxQueue" };
+
+//------------------------------------------------------------------------------
+// Forward Declarations
+
+static int32u nowUs(void);
+static int8u bucketIndex(int32u us);
+static int32u bucketUpperBound(int8u index);
+static int32u percentile(LatencyHistogram *histogram, int16u perThousand);
+static void clearQueueDepths(void);
+
+//------------------------------------------------------------------------------
+// Recording
+
+void ezspStatsCommandStarted(void)
+{
+  startedUs = nowUs();
+}
+
+void ezspStatsCommandSent(int8u frameId)
+{
+  SentCommand *command;
+  if (sentCount == SENT_RING_SIZE) {
+    return;
+  }
+  command = &sentCommands[(int8u)(sentHead + sentCount)];
+  command->frameId = frameId;
+  command->sentUs = startedUs;
+  sentCount++;
+}
+
+void ezspStatsFrameReceived(int8u frameId, boolean isResponse)
+{
+  SentCommand *command;
+  LatencyHistogram *histogram;
+  int8u slot;
+  int32u latencyUs;
+
+  if (!isResponse || sentCount == 0) {
+    callbackCounts[frameId]++;
+    return;
+  }
+  command = &sentCommands[sentHead];
+  sentHead++;
+  sentCount--;
+  latencyUs = nowUs() - command->sentUs;
+
+  // The response to the callback command is the callback itself.
+  if (command->frameId == EZSP_CALLBACK && frameId != EZSP_NO_CALLBACKS) {
+    callbackCounts[frameId]++;
+  }
+
+  if (!slotsInitialized) {
+    ezspStatsClear();
+  }
+  slot = slotByFrameId[command->frameId];
+  if (slot == NO_SLOT) {
+    if (histogramCount == EZSP_STATS_MAX_FRAME_IDS) {
+      untimedCommands++;
+      return;
+    }
+    slot = histogramCount++;
+    slotByFrameId[command->frameId] = slot;
+    histograms[slot].frameId = command->frameId;
+    histograms[slot].minUs = 0xFFFFFFFFUL;
+  }
+  histogram = &histograms[slot];
+  histogram->count++;
+  histogram->buckets[bucketIndex(latencyUs)]++;
+  if (latencyUs < histogram->minUs) {
+    histogram->minUs = latencyUs;
+  }
+  if (latencyUs > histogram->maxUs) {
+    histogram->maxUs = latencyUs;
+  }
+}
+
+void ezspStatsCommandsLost(void)
+{
+  sentCount = 0;
+}
+
+void ezspStatsTick(int16u rxQueueDepth,
+                   int16u txQueueDepth,
+                   int16u reTxQueueDepth)
+{
+  int16u depths[QUEUE_COUNT];
+  int32u now;
+  int8u i;
+
+  depths[QUEUE_RX] = rxQueueDepth;
+  depths[QUEUE_TX] = txQueueDepth;
+  depths[QUEUE_RETX] = reTxQueueDepth;
+  for (i = 0; i < QUEUE_COUNT; i++) {
+    queueDepths[i].current = depths[i];
+    queueDepths[i].total += depths[i];
+    if (depths[i] > queueDepths[i].max) {
+      queueDepths[i].max = depths[i];
+    }
+  }
+  queueSamples++;
+
+  if (logFile != NULL) {
+    now = halCommonGetInt32uMillisecondTick();
+    if (now - logLastMs >= logIntervalMs) {
+      logLastMs = now;
+      ezspStatsPrint(logFile);
+      fflush(logFile);
+      clearQueueDepths();
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Reporting
+
+void ezspStatsPrint(FILE *out)
+{
+  LatencyHistogram *histogram;
+  int32u now = halCommonGetInt32uMillisecondTick();
+  char title[40];
+  int16u i;
+
+  fprintf(out, "EZSP statistics at %u ms\n", now);
+  fprintf(out, "%-28s %10s %8s %8s %8s %8s %8s\n", "Command latency (us)",
+          "count", "min", "p50", "p90", "p99", "max");
+  for (i = 0; i < histogramCount; i++) {
+    histogram = &histograms[i];
+    fprintf(out, "%-28.28s %10u %8u %8u %8u %8u %8u\n",
+            decodeFrameId(histogram->frameId),
+            histogram->count,
+            histogram->minUs,
+            percentile(histogram, 500),
+            percentile(histogram, 900),
+            percentile(histogram, 990),
+            histogram->maxUs);
+  }
+  if (untimedCommands != 0) {
+    fprintf(out, "%-28s %10u\n", "(not timed)", untimedCommands);
+  }
+
+  fprintf(out, "%-28s %10s\n", "Callbacks", "count");
+  for (i = 0; i < 256; i++) {
+    if (callbackCounts[i] != 0) {
+      fprintf(out, "%-28.28s %10u\n", decodeFrameId(i), callbackCounts[i]);
+    }
+  }
+
+  sprintf(title, "ASH queue depth over %u ms", now - queueWindowStartMs);
+  fprintf(out, "%-28s %10s %8s %8s\n", title, "now", "max", "mean");
+  for (i = 0; i < QUEUE_COUNT; i++) {
+    fprintf(out, "%-28s %10u %8u %5u.%02u\n",
+            queueNames[i],
+            queueDepths[i].current,
+            queueDepths[i].max,
+            (queueSamples == 0
+             ? 0 : queueDepths[i].total / queueSamples),
+            (queueSamples == 0
+             ? 0 : (queueDepths[i].total % queueSamples) * 100 / queueSamples));
+  }
+}
+
+void ezspStatsClear(void)
+{
+  MEMSET(histograms, 0, sizeof(histograms));
+  MEMSET(slotByFrameId, NO_SLOT, sizeof(slotByFrameId));
+  MEMSET(callbackCounts, 0, sizeof(callbackCounts));
+  histogramCount = 0;
+  untimedCommands = 0;
+  slotsInitialized = TRUE;
+  clearQueueDepths();
+}
+
+boolean ezspStatsLogToFile(const char *fileName, int32u intervalMs)
+{
+  if (logFile != NULL) {
+    fclose(logFile);
+    logFile = NULL;
+  }
+  if (intervalMs == 0) {
+    return TRUE;
+  }
+  logFile = fopen(fileName, "a");
+  if (logFile == NULL) {
+    return FALSE;
+  }
+  logIntervalMs = intervalMs;
+  logLastMs = halCommonGetInt32uMillisecondTick();
+  clearQueueDepths();
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+// Utility functions
+
+// A monotonic clock, so that setting the time of day cannot distort the
+// latencies.  Only differences are used, so wrapping does not matter.
+static int32u nowUs(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int32u)(now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+static int8u bucketIndex(int32u us)
+{
+  int8u exponent = 31;
+  if (us < LINEAR_BUCKETS) {
+    return (int8u)us;
+  }
+  while ((us & BIT32(exponent)) == 0) {
+    exponent--;
+  }
+  return (LINEAR_BUCKETS
+          + (exponent - FIRST_LOG_EXPONENT) * SUB_BUCKETS
+          + ((us >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1)));
+}
+
+static int32u bucketUpperBound(int8u index)
+{
+  int8u exponent;
+  int8u subBucket;
+  if (index < LINEAR_BUCKETS) {
+    return index;
+  }
+  exponent = FIRST_LOG_EXPONENT + (index - LINEAR_BUCKETS) / SUB_BUCKETS;
+  subBucket = (index - LINEAR_BUCKETS) % SUB_BUCKETS;
+  return (((int32u)(SUB_BUCKETS + subBucket + 1) << (exponent - SUB_BUCKET_BITS))
+          - 1);
+}
+
+// Returns the upper bound of the bucket holding the given percentile, or the
+// maximum if that is lower.
+static int32u percentile(LatencyHistogram *histogram, int16u perThousand)
+{
+  // In 64 bits, since a long-running host can record billions of samples.
+  int32u rank = (int32u)(((int64u)histogram->count * perThousand + 999)
+                         / 1000);
+  int32u seen = 0;
+  int32u bound;
+  int8u i;
+
+  for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= rank && seen != 0) {
+      bound = bucketUpperBound(i);
+      return (bound < histogram->maxUs) ? bound : histogram->maxUs;
+    }
+  }
+  return histogram->maxUs;
+}
+
+static void clearQueueDepths(void)
+{
+  MEMSET(queueDepths, 0, sizeof(queueDepths));
+  queueSamples = 0;
+  queueWindowStartMs = halCommonGetInt32uMillisecondTick();
+}
@@ -0,0 +1,59 @@
+// File: ezsp-stats.h
+//
+// Description: EZSP instrumentation for UART hosts. Keeps a latency histogram
+// for each EZSP command frame ID, counts callbacks by frame ID, and tracks the
+// depths of the ASH queues. The statistics can be printed at any time and
+// written to a file periodically.
+//
+// The histograms are log-linear: exact below 16 microseconds, and four
+// buckets for each power of two above that, so every latency is known to
+// within 25% however long it is.
+//
+// The serial interface (serial-interface-uart.c) calls the ezspStats...Sent,
+// ...Received and ...Tick functions; applications only need the others.
+//
+// Copyright 2010 by Ember Corporation. All rights reserved.                *80*
+
+#ifndef __EZSP_STATS_H__
+#define __EZSP_STATS_H__
+
+#include <stdio.h>
+
+// The number of different command frame IDs that get their own histogram.
+// Commands beyond this are counted but not timed.
+#ifndef EZSP_STATS_MAX_FRAME_IDS
+  #define EZSP_STATS_MAX_FRAME_IDS 48
+#endif
+
+// Notes the time at which a command starts to be sent.
+void ezspStatsCommandStarted(void);
+
+// Records that the command started last has been sent. Responses must come
+// back in the order the commands were sent, as they do with ASH.
+void ezspStatsCommandSent(int8u frameId);
+
+// Records the response to the oldest command sent, or a callback if no
+// command is outstanding.
+void ezspStatsFrameReceived(int8u frameId, boolean isResponse);
+
+// Forgets the outstanding commands, when their responses will not come.
+void ezspStatsCommandsLost(void);
+
+// Samples the ASH queue depths and writes the statistics to the log file
+// when the logging interval has passed.
+void ezspStatsTick(int16u rxQueueDepth,
+                   int16u txQueueDepth,
+                   int16u reTxQueueDepth);
+
+// Prints the statistics.
+void ezspStatsPrint(FILE *out);
+
+// Clears all of the statistics.
+void ezspStatsClear(void);
+
+// Appends the statistics to a file every intervalMs milliseconds, starting
+// now. The queue depths printed each time are for the preceding interval.
+// An interval of 0 stops logging. Returns FALSE if the file cannot be opened.
+boolean ezspStatsLogToFile(const char *fileName, int32u intervalMs);
+
+#endif // __EZSP_STATS_H__
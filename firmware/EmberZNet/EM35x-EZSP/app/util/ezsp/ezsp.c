@@ -17,6 +17,11 @@
 #include "app/util/ezsp/ezsp.h"
 #include "app/util/ezsp/serial-interface.h"
 #include "app/util/ezsp/ezsp-frame-utilities.h"
+#include "app/util/ezsp/ezsp-host-configuration-defaults.h"
+
+#ifdef EZSP_AES_MMO_ON_HOST
+  #include "hal/micro/aes.h"
+#endif
 
 #ifdef EZSP_UART
   #include "app/ezsp-uart-host/ash-host-priv.h"
@@ -36,7 +41,9 @@
 
 static void startCommand(int8u command);
 static void sendCommand(void);
+static void waitForPendingCommands(int8u limit);
 static void callbackDispatch(void);
+static void dispatchCallback(void);
 static void callbackPointerInit(void);
 static int8u *fetchInt8uPointer(int8u length);
 
@@ -65,18 +72,39 @@ int8u ezspApplicationNetworkIndex = 0;
 int8u ezspCallbackNetworkIndex = 0;
 
 // Some callbacks from EZSP to the application include a pointer parameter. For
-// example, messageContents in ezspIncomingMessageHandler(). Copying the
-// callback and then giving the application a pointer to this copy means it is
-// safe for the application to call EZSP functions inside the callback. To save
-// RAM, the application can define EZSP_DISABLE_CALLBACK_COPY. The application
-// must then not read from the pointer after calling an EZSP function inside the
-// callback.
+// example, messageContents in ezspIncomingMessageHandler(). The pointer must
+// stay valid if the application calls EZSP functions inside the callback.
+// Callbacks dispatched by ezspTick() are decoded in place if the serial
+// protocol can hold on to the frame until the handler returns (see
+// serialHoldResponse()). Otherwise the callback is copied, and the application
+// is given a pointer to the copy. To save RAM, the application can define
+// EZSP_DISABLE_CALLBACK_COPY. The application must then not read from a pointer
+// into a copied callback after calling an EZSP function inside the callback.
 #ifndef EZSP_DISABLE_CALLBACK_COPY
 static int8u ezspCallbackStorage[EZSP_MAX_FRAME_LENGTH];
 #endif
 
+// Set by dispatchCallback() to have callbackPointerInit() hold the frame, and
+// the frame held for the callback being dispatched.
+static boolean holdCallbackFrame = FALSE;
+static int8u *heldCallbackFrame = NULL;
+
 boolean ncpHasCallbacks;
 
+// Asynchronous commands that are waiting for their responses, oldest first.
+// The NCP answers commands in the order it receives them, so the next
+// response always belongs to the command at the head of the queue.
+typedef struct {
+  int8u sequence;
+  int8u frameId;
+  EzspResponseHandler *handler;
+  void *context;
+} PendingCommand;
+
+static PendingCommand pendingCommands[EZSP_HOST_MAX_PENDING_COMMANDS];
+static int8u pendingHead = 0;
+static int8u pendingCount = 0;
+
 //------------------------------------------------------------------------------
 // Retrieving the new version info
 
@@ -142,6 +170,70 @@ void emberAesMmoHashInit(EmberAesMmoHashContext *context)
   MEMSET(context, 0, sizeof(EmberAesMmoHashContext));
 }
 
+#ifdef EZSP_AES_MMO_ON_HOST
+
+// The hash is worked out on the host instead of being sent to the NCP 255
+// bytes at a time.  The rules match the NCP's: an update must be a whole
+// number of blocks, and the message can be at most 2^32 - 1 bits long.
+
+#define AES_MMO_MAX_BYTES 0x1FFFFFFFUL
+// Messages shorter than this many bytes end in a 16-bit bit count.
+#define AES_MMO_SHORT_BYTES 8192
+
+static EmberStatus aesMmoHash(EmberAesMmoHashContext *context,
+                              boolean finalize,
+                              int32u length,
+                              int8u *data)
+{
+  int8u last[2 * HAL_AES_BLOCK_SIZE];
+  int32u blocks = length / HAL_AES_BLOCK_SIZE;
+  int8u remainder = (int8u)(length % HAL_AES_BLOCK_SIZE);
+  int32u bits;
+  int8u lastLength;
+
+  if (!finalize && remainder != 0) {
+    return EMBER_INVALID_CALL;
+  }
+  if (context->length > AES_MMO_MAX_BYTES
+      || length > AES_MMO_MAX_BYTES - context->length) {
+    return EMBER_INDEX_OUT_OF_RANGE;
+  }
+
+  halCommonAesMmoHashBlocks(context->result, data, blocks);
+  context->length += length;
+  if (!finalize) {
+    return EMBER_SUCCESS;
+  }
+
+  // The message is padded with a one bit, then zeros, then its length in
+  // bits, to a whole number of blocks.
+  bits = context->length << 3;
+  MEMSET(last, 0, sizeof(last));
+  MEMCOPY(last, data + blocks * HAL_AES_BLOCK_SIZE, remainder);
+  last[remainder] = 0x80;
+  if (context->length < AES_MMO_SHORT_BYTES) {
+    lastLength = (remainder < HAL_AES_BLOCK_SIZE - 2
+                  ? HAL_AES_BLOCK_SIZE
+                  : 2 * HAL_AES_BLOCK_SIZE);
+    last[lastLength - 2] = (int8u)(bits >> 8);
+    last[lastLength - 1] = (int8u)bits;
+  } else {
+    lastLength = (remainder < HAL_AES_BLOCK_SIZE - 6
+                  ? HAL_AES_BLOCK_SIZE
+                  : 2 * HAL_AES_BLOCK_SIZE);
+    last[lastLength - 6] = (int8u)(bits >> 24);
+    last[lastLength - 5] = (int8u)(bits >> 16);
+    last[lastLength - 4] = (int8u)(bits >> 8);
+    last[lastLength - 3] = (int8u)bits;
+  }
+  halCommonAesMmoHashBlocks(context->result,
+                            last,
+                            lastLength / HAL_AES_BLOCK_SIZE);
+  return EMBER_SUCCESS;
+}
+
+#else // EZSP_AES_MMO_ON_HOST
+
 // Here we convert the normal Ember AES hash call to the specialized EZSP call.
 // This came about because we cannot pass a block of data that is
 // both input and output into EZSP.  The block must be broken up into two
@@ -170,6 +262,8 @@ static EmberStatus aesMmoHash(EmberAesMmoHashContext *context,
   return status;
 }
 
+#endif // EZSP_AES_MMO_ON_HOST
+
 EmberStatus emberAesMmoHashUpdate(EmberAesMmoHashContext *context,
                                   int32u length,
                                   int8u *data)
@@ -430,6 +524,9 @@ EmberLeaveReason emberGetLastLeaveReason(EmberNodeId* id)
 
 static void startCommand(int8u command)
 {
+  // The caller takes the next response to be its own, so any asynchronous
+  // responses still to come must be collected first.
+  waitForPendingCommands(0);
   ezspWritePointer = ezspFrameContents + EZSP_PARAMETERS_INDEX;
   serialSetCommandByte(EZSP_FRAME_ID_INDEX, command);
 }
@@ -437,13 +534,39 @@ static void startCommand(int8u command)
 enum {
   RESPONSE_SUCCESS,
   RESPONSE_WAITING,
-  RESPONSE_ERROR
+  RESPONSE_ERROR,
+  RESPONSE_HANDLED    // passed to the handler of an asynchronous command
 };
 
+static void retireCommand(PendingCommand *command)
+{
+  *command = pendingCommands[pendingHead];
+  pendingHead = (pendingHead + 1) % EZSP_HOST_MAX_PENDING_COMMANDS;
+  pendingCount--;
+}
+
+// Returns the position in the queue of the pending command with the given
+// sequence number, or pendingCount if there is none.
+static int8u findPendingCommand(int8u sequence)
+{
+  int8u i;
+  for (i = 0; i < pendingCount; i++) {
+    if (pendingCommands[(pendingHead + i) % EZSP_HOST_MAX_PENDING_COMMANDS]
+        .sequence == sequence) {
+      break;
+    }
+  }
+  return i;
+}
+
 static int8u responseReceived(void)
 {
   EzspStatus status;
   int8u responseFrameControl;
+  PendingCommand retired[EZSP_HOST_MAX_PENDING_COMMANDS];
+  int8u retiredCount = 0;
+  int8u lostCount = 0;
+  int8u i;
 
   status = serialResponseReceived();
 
@@ -452,7 +575,7 @@ static int8u responseReceived(void)
     return RESPONSE_WAITING;
   }
 
-  ezspReadPointer = ezspFrameContents + EZSP_PARAMETERS_INDEX;
+  ezspReadPointer = ezspResponseContents + EZSP_PARAMETERS_INDEX;
 
   if (status == EZSP_SUCCESS) {
     responseFrameControl = serialGetResponseByte(EZSP_FRAME_CONTROL_INDEX);
@@ -478,19 +601,55 @@ static int8u responseReceived(void)
     ezspCallbackNetworkIndex =
         (responseFrameControl & EZSP_FRAME_CONTROL_NETWORK_INDEX_MASK)
          >> EZSP_FRAME_CONTROL_NETWORK_INDEX_OFFSET;
+
+    // While asynchronous commands are outstanding the serial protocol holds
+    // back callbacks, so this is the response to one of them.  Responses come
+    // back in order, so the commands sent before the one it answers have lost
+    // theirs.  Only those commands fail; the pipeline carries on.
+    if (pendingCount > 0) {
+      lostCount = findPendingCommand(serialGetResponseByte(EZSP_SEQUENCE_INDEX));
+      if (lostCount == pendingCount) {
+        // A stale response to a command that has already been given up on.
+        EZSP_UART_TRACE("responseReceived(): no command for sequence 0x%x",
+                        serialGetResponseByte(EZSP_SEQUENCE_INDEX));
+        return RESPONSE_WAITING;
+      }
+      for (i = 0; i <= lostCount; i++) {
+        retireCommand(&retired[retiredCount++]);
+      }
+      serialResponsesLost(lostCount);
+    }
+  } else {
+    // The serial protocol has given up on any responses still to come.
+    while (pendingCount > 0) {
+      retireCommand(&retired[retiredCount++]);
+    }
   }
   if (status != EZSP_SUCCESS) {
     EZSP_UART_TRACE("responseReceived(): ezspErrorHandler(): 0x%x", status);
     ezspErrorHandler(status);
+  }
+  // The handlers are called last, as they may send further commands.
+  for (i = 0; i < retiredCount; i++) {
+    if (retired[i].handler != NULL) {
+      retired[i].handler((i < lostCount ? EZSP_ERROR_NO_RESPONSE : status),
+                         retired[i].frameId,
+                         retired[i].context);
+    }
+  }
+  if (status != EZSP_SUCCESS) {
     return RESPONSE_ERROR;
+  } else if (retiredCount > 0) {
+    return RESPONSE_HANDLED;
   } else {
     return RESPONSE_SUCCESS;
   }
 }
 
-static void sendCommand(void)
+// Fills in the frame header of the current command and passes it to the
+// serial protocol.
+static EzspStatus transmitCommand(void)
 {
-  EzspStatus status;
   int16u length = ezspWritePointer - ezspFrameContents;
   serialSetCommandByte(EZSP_SEQUENCE_INDEX, ezspSequence);
   ezspSequence++;
@@ -500,31 +659,111 @@ static void sendCommand(void)
                         | ezspApplicationNetworkIndex // we always set the network index in the
                           << EZSP_FRAME_CONTROL_NETWORK_INDEX_OFFSET)); // ezsp frame control.
   if (length > EZSP_MAX_FRAME_LENGTH) {
-    EZSP_UART_TRACE("sendCommand(): ezspErrorHandler(): EZSP_ERROR_COMMAND_TOO_LONG");
-    ezspErrorHandler(EZSP_ERROR_COMMAND_TOO_LONG);
-    return;
+    return EZSP_ERROR_COMMAND_TOO_LONG;
   }
   serialSetCommandLength(length);
+  return serialSendCommand();
+}
+
+static void sendCommand(void)
+{
+  EzspStatus status;
   // Ensure that a second command is not sent before the response to the first
   // command has been processed.
   assert(!sendingCommand);
-  sendingCommand = TRUE;
-  status = serialSendCommand();
+  status = transmitCommand();
   if (status == EZSP_SUCCESS) {
+    sendingCommand = TRUE;
     while (responseReceived() == RESPONSE_WAITING) {
       ezspWaitingForResponse();
     }
+    sendingCommand = FALSE;
   } else {
     EZSP_UART_TRACE("sendCommand(): ezspErrorHandler(): 0x%x", status);
     ezspErrorHandler(status);
   }
-  sendingCommand = FALSE;
+}
+
+// Collects responses until no more than limit asynchronous commands are
+// outstanding.
+static void waitForPendingCommands(int8u limit)
+{
+  while (pendingCount > limit) {
+    if (responseReceived() == RESPONSE_WAITING) {
+      ezspWaitingForResponse();
+    }
+  }
+}
+
+void ezspStartAsyncCommand(int8u frameId)
+{
+  waitForPendingCommands(EZSP_HOST_MAX_PENDING_COMMANDS - 1);
+  ezspWritePointer = ezspFrameContents + EZSP_PARAMETERS_INDEX;
+  serialSetCommandByte(EZSP_FRAME_ID_INDEX, frameId);
+}
+
+EzspStatus ezspSendAsyncCommand(EzspResponseHandler *handler, void *context)
+{
+  EzspStatus status;
+  PendingCommand *command;
+  assert(!sendingCommand);
+  assert(pendingCount < EZSP_HOST_MAX_PENDING_COMMANDS);
+  status = transmitCommand();
+  if (status == EZSP_SUCCESS) {
+    command = &pendingCommands[(pendingHead + pendingCount)
+                               % EZSP_HOST_MAX_PENDING_COMMANDS];
+    command->sequence = ezspFrameContents[EZSP_SEQUENCE_INDEX];
+    command->frameId = ezspFrameContents[EZSP_FRAME_ID_INDEX];
+    command->handler = handler;
+    command->context = context;
+    pendingCount++;
+  } else {
+    EZSP_UART_TRACE("ezspSendAsyncCommand(): 0x%x", status);
+  }
+  return status;
+}
+
+int8u ezspPendingCommandCount(void)
+{
+  return pendingCount;
+}
+
+// Dispatches the callback just received by ezspTick(), decoding it in place if
+// possible. A handler may itself call ezspTick(), so the frame held for an
+// enclosing callback is put back afterwards.
+static void dispatchCallback(void)
+{
+  int8u *enclosingFrame = heldCallbackFrame;
+  heldCallbackFrame = NULL;
+  holdCallbackFrame = TRUE;
+  callbackDispatch();
+  if (heldCallbackFrame != NULL) {
+    serialReleaseResponse(heldCallbackFrame);
+  }
+  heldCallbackFrame = enclosingFrame;
 }
 
 static void callbackPointerInit(void)
 {
 #ifndef EZSP_DISABLE_CALLBACK_COPY
-  MEMCOPY(ezspCallbackStorage, ezspFrameContents, EZSP_MAX_FRAME_LENGTH);
+  int8u length;
+#endif
+  // Only the callback being dispatched by ezspTick() is held. One returned by
+  // ezspCallback() has no point at which it could be released.
+  if (holdCallbackFrame) {
+    holdCallbackFrame = FALSE;
+    heldCallbackFrame = serialHoldResponse();
+    if (heldCallbackFrame != NULL) {
+      ezspReadPointer = heldCallbackFrame + EZSP_PARAMETERS_INDEX;
+      return;
+    }
+  }
+#ifndef EZSP_DISABLE_CALLBACK_COPY
+  length = serialGetResponseLength();
+  if (length > EZSP_MAX_FRAME_LENGTH) {
+    length = EZSP_MAX_FRAME_LENGTH;
+  }
+  MEMCOPY(ezspCallbackStorage, ezspResponseContents, length);
   ezspReadPointer = ezspCallbackStorage + EZSP_PARAMETERS_INDEX;
 #endif
 }
@@ -538,11 +777,17 @@ static int8u *fetchInt8uPointer(int8u length)
 
 void ezspTick(void)
 {
-  int8u count = serialPendingResponseCount() + 1;
+  int16u count = serialPendingResponseCount() + 1;
+  int8u result;
   // Ensure that we are not being called from within a command.
   assert(!sendingCommand);
-  while (count > 0 && responseReceived() == RESPONSE_SUCCESS) {
-    callbackDispatch();
+  while (count > 0) {
+    result = responseReceived();
+    if (result == RESPONSE_SUCCESS) {
+      dispatchCallback();
+    } else if (result != RESPONSE_HANDLED) {
+      break;
+    }
     count--;
   }
   simulatedTimePasses();
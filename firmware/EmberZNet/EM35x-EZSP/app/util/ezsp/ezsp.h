@@ -56,6 +56,48 @@ void ezspErrorHandler(EzspStatus status);
 // EM260.
 void ezspClose(void);
 
+//----------------------------------------------------------------
+// Asynchronous commands
+//
+// Commands can also be sent without waiting for their responses, so that
+// several of them are in the serial protocol's transmit window at once.
+// A command is built by calling ezspStartAsyncCommand() with the frame ID,
+// appending the command parameters with the appendInt8u(), appendInt16u(),
+// ... functions from ezsp-frame-utilities.h in the order given in the
+// datasheet, and then calling ezspSendAsyncCommand(). Each response is matched
+// to its command by the EZSP sequence number and passed to the handler given
+// when the command was sent.
+//
+// Handlers are called from ezspTick(), or when a later command has to wait
+// for earlier responses: any of the blocking functions waits for all
+// outstanding asynchronous commands before sending its own command. Up to
+// EZSP_HOST_MAX_PENDING_COMMANDS commands can be outstanding.
+
+// Called with the result of an asynchronous command. If status is EZSP_SUCCESS
+// the handler reads the response parameters with fetchInt8u(), fetchInt16u(),
+// ..., in the order given in the datasheet. The response is only available
+// until the handler calls another EZSP function or returns. Any other status
+// means that the command failed and there is no response to read; the error
+// has also been passed to ezspErrorHandler().
+typedef void (EzspResponseHandler)(EzspStatus status,
+                                   int8u frameId,
+                                   void *context);
+
+// Starts building an asynchronous command. If the maximum number of commands
+// are already outstanding this first waits for the oldest one to complete.
+void ezspStartAsyncCommand(int8u frameId);
+
+// Sends the command built since the call to ezspStartAsyncCommand() and returns
+// without waiting for the response. Returns EZSP_SUCCESS if the command was
+// sent, in which case the handler will be called exactly once. Any other
+// return value means that the command was not sent and the handler will not
+// be called.
+EzspStatus ezspSendAsyncCommand(EzspResponseHandler *handler, void *context);
+
+// Returns the number of asynchronous commands whose handlers have not yet been
+// called.
+int8u ezspPendingCommandCount(void);
+
 //----------------------------------------------------------------
 // Functions with special handling
 
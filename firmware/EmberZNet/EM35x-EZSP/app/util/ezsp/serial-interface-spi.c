@@ -25,6 +25,7 @@
 
 static boolean waitingForResponse = FALSE;
 int8u *ezspFrameContents;
+int8u *ezspResponseContents;
 int8u *ezspFrameLengthLocation;
 
 //------------------------------------------------------------------------------
@@ -34,6 +35,7 @@ EzspStatus ezspInit(void)
 {
   ezspFrameLengthLocation = halNcpFrame;
   ezspFrameContents = halNcpFrame + 1;
+  ezspResponseContents = ezspFrameContents;
   return halNcpHardReset();
 }
 
@@ -56,7 +58,7 @@ void ezspClose(void)
   // Nothing to do.
 }
 
-int8u serialPendingResponseCount(void)
+int16u serialPendingResponseCount(void)
 {
   return 0;
 }
@@ -75,8 +77,28 @@ EzspStatus serialResponseReceived(void)
   }
 }
 
+// The one SPI frame buffer is reused for the next command, so callbacks
+// must be copied.
+int8u *serialHoldResponse(void)
+{
+  return NULL;
+}
+
+void serialReleaseResponse(int8u *frame)
+{
+}
+
+void serialResponsesLost(int8u count)
+{
+  // Only one command is ever outstanding, so there is nothing to forget.
+}
+
 EzspStatus serialSendCommand()
 {
+  // The SPI protocol carries one command at a time.
+  if (waitingForResponse) {
+    return EZSP_SPI_WAITING_FOR_RESPONSE;
+  }
   halNcpSendCommand();
   waitingForResponse = TRUE;
   return EZSP_SUCCESS;
@@ -20,6 +20,11 @@
 #include "app/ezsp-uart-host/ash-host-priv.h"
 #include "app/ezsp-uart-host/ash-host-queues.h"
 #include "app/util/ezsp/ezsp-frame-utilities.h"
+#include "app/util/ezsp/ezsp-stats.h"
+#ifdef ASH_HOST_THREAD
+  #include "app/util/ezsp/ezsp-host-configuration-defaults.h"
+  #include "app/ezsp-uart-host/ash-host-thread.h"
+#endif
 
 #define elapsedTimeInt16u(oldTime, newTime)      \
   ((int16u) ((int16u)(newTime) - (int16u)(oldTime)))
@@ -27,7 +32,9 @@
 //------------------------------------------------------------------------------
 // Global Variables
 
-static boolean waitingForResponse = FALSE;
+// The number of commands sent whose responses have not yet been collected,
+// and when the oldest of them started waiting.
+static int8u responsesOutstanding = 0;
 static int16u waitStartTime;
 #define WAIT_FOR_RESPONSE_TIMEOUT (ASH_MAX_TIMEOUTS * ashReadConfig(ackTimeMax))
 
@@ -36,6 +43,60 @@ int8u *ezspFrameLengthLocation = &ezspFrameLength;
 static int8u ezspFrameContentsStorage[EZSP_MAX_FRAME_LENGTH];
 int8u *ezspFrameContents = ezspFrameContentsStorage;
 
+// Received frames are read where ASH put them rather than being copied.
+// ezspResponseContents points into responseBuffer, which is freed when the
+// next frame is received, unless serialHoldResponse() has moved it to
+// heldBuffers to be freed by serialReleaseResponse().
+#define MAX_HELD_RESPONSES 4
+int8u *ezspResponseContents = ezspFrameContentsStorage;
+static AshBuffer *responseBuffer = NULL;
+static AshBuffer *heldBuffers[MAX_HELD_RESPONSES];
+static int8u heldCount = 0;
+
+#ifdef ASH_HOST_THREAD
+// When ASH runs in its own thread, rxQueue and rxFree belong to that thread.
+// Received frames are moved to a queue of this thread's own, so that
+// callbacks can still be held back while waiting for a response.
+static AshQueue responseQueue;
+static AshFreeList responseFree;
+static AshBuffer responsePool[EZSP_HOST_ASH_RX_POOL_SIZE];
+#define ezspRxQueue responseQueue
+#define ezspRxFree  responseFree
+
+static void initResponseQueue(void)
+{
+  AshBuffer *buffer;
+  responseQueue.head = responseQueue.tail = NULL;
+  responseQueue.length = 0;
+  responseFree.link = NULL;
+  responseFree.length = 0;
+  for (buffer = responsePool;
+       buffer < &responsePool[EZSP_HOST_ASH_RX_POOL_SIZE];
+       buffer++) {
+    ashFreeBuffer(&responseFree, buffer);
+  }
+}
+
+// Moves frames received by the I/O thread into responseQueue.
+static EzspStatus collectResponses(void)
+{
+  EzspStatus status;
+  AshBuffer *buffer;
+  while ((buffer = ashAllocBuffer(&responseFree)) != NULL) {
+    status = ashThreadReceive(&buffer->len, buffer->data);
+    if (status != EZSP_SUCCESS) {
+      ashFreeBuffer(&responseFree, buffer);
+      return status;
+    }
+    ashAddQueueTail(&responseQueue, buffer);
+  }
+  return EZSP_SUCCESS;
+}
+#else
+#define ezspRxQueue rxQueue
+#define ezspRxFree  rxFree
+#endif
+
 //------------------------------------------------------------------------------
 // Serial Interface Downwards
 
@@ -43,6 +104,13 @@ EzspStatus ezspInit(void)
 {
   EzspStatus status;
   int8u i;
+#ifdef ASH_HOST_THREAD
+  ashThreadStop();
+#endif
+  // The receive buffers are about to be reinitialized, which frees them all.
+  ezspResponseContents = ezspFrameContentsStorage;
+  responseBuffer = NULL;
+  heldCount = 0;
   for (i = 0; i < 5; i++) {
     status = ashResetNcp();
     if (status != EZSP_SUCCESS) {
@@ -50,6 +118,10 @@ EzspStatus ezspInit(void)
     }
     status = ashStart();
     if (status == EZSP_SUCCESS) {
+#ifdef ASH_HOST_THREAD
+      initResponseQueue();
+      status = ashThreadStart();
+#endif
       return status;
     }
   }
@@ -65,12 +137,19 @@ boolean ezspCallbackPending(void)
 
 void ezspClose(void)
 {
+#ifdef ASH_HOST_THREAD
+  ashThreadStop();
+#endif
   ashSerialClose();
 }
 
 static boolean checkConnection(void)
 {
+#ifdef ASH_HOST_THREAD
+  boolean connected = ashThreadIsConnected();
+#else
   boolean connected = ashIsConnected();
+#endif
   if (!connected) {
     // Attempt to restore the connection. This will reset the EM260.
     ezspClose();
@@ -79,9 +158,13 @@ static boolean checkConnection(void)
   return connected;
 }
 
-int8u serialPendingResponseCount(void)
+int16u serialPendingResponseCount(void)
 {
+#ifdef ASH_HOST_THREAD
+  return ashQueueLength(&responseQueue) + ashThreadReceiveCount();
+#else
   return ashQueueLength(&rxQueue);
+#endif
 }
 
 EzspStatus serialResponseReceived(void)
@@ -93,6 +176,15 @@ EzspStatus serialResponseReceived(void)
     ashTraceEzspVerbose("serialResponseReceived(): EZSP_ASH_NOT_CONNECTED");
     return EZSP_ASH_NOT_CONNECTED;
   }
+#ifdef ASH_HOST_THREAD
+  status = collectResponses();
+  if (status != EZSP_SUCCESS
+      && status != EZSP_ASH_NO_RX_DATA) {
+    ashTraceEzspVerbose("serialResponseReceived(): ashThreadReceive(): 0x%x",
+                        status);
+    return status;
+  }
+#else
   ashSendExec();
   status = ashReceiveExec();
   if (status != EZSP_SUCCESS
@@ -102,48 +194,71 @@ EzspStatus serialResponseReceived(void)
                         status);
     return status;
   }
-  if (waitingForResponse
+#endif
+#ifdef ASH_HOST_THREAD
+  // txQueue and reTxQueue belong to the I/O thread, which publishes their
+  // depths after each pass.
+  ezspStatsTick(serialPendingResponseCount(),
+                ashThreadTxQueueLength(),
+                ashThreadReTxQueueLength());
+#else
+  ezspStatsTick(serialPendingResponseCount(),
+                ashQueueLength(&txQueue),
+                ashQueueLength(&reTxQueue));
+#endif
+  if (responsesOutstanding > 0
       && elapsedTimeInt16u(waitStartTime, halCommonGetInt16uMillisecondTick())
          > WAIT_FOR_RESPONSE_TIMEOUT) {
-    waitingForResponse = FALSE;
+    responsesOutstanding = 0;
+    ezspStatsCommandsLost();
     ashTraceEzspFrameId("no response", ezspFrameContents);
     ashTraceEzspVerbose("serialResponseReceived(): EZSP_ERROR_NO_RESPONSE");
     return EZSP_ERROR_NO_RESPONSE;
   }
   status = EZSP_ASH_NO_RX_DATA;
-  buffer = ashQueuePrecedingEntry(&rxQueue, NULL);
+  buffer = ashQueuePrecedingEntry(&ezspRxQueue, NULL);
   while (buffer != NULL) {
     // While we are waiting for a response to a command, we use the asynch
     // callback flag to ignore asynchronous callbacks. This allows our caller
     // to assume that no callbacks will appear between sending a command and
     // receiving its response.
-    if (waitingForResponse
+    if (responsesOutstanding > 0
         && (buffer->data[EZSP_FRAME_CONTROL_INDEX]
             & EZSP_FRAME_CONTROL_ASYNCH_CB)
          ) {
-      if (ashFreeListLength(&rxFree) == 0) {
+      if (ashFreeListLength(&ezspRxFree) == 0) {
         dropBuffer = buffer;
       }
-      buffer = ashQueuePrecedingEntry(&rxQueue, buffer);
+      buffer = ashQueuePrecedingEntry(&ezspRxQueue, buffer);
     } else {
       ashTraceEzspVerbose("serialResponseReceived(): ID=0x%x Seq=0x%x Buffer=%u",
                           buffer->data[EZSP_FRAME_ID_INDEX],
                           buffer->data[EZSP_SEQUENCE_INDEX],
                           buffer);
-      ashRemoveQueueEntry(&rxQueue, buffer);
-      memcpy(ezspFrameContents, buffer->data, buffer->len);  
+      ashRemoveQueueEntry(&ezspRxQueue, buffer);
       ashTraceEzspFrameId("got response", buffer->data);
+      if (responseBuffer != NULL) {
+        ashFreeBuffer(&ezspRxFree, responseBuffer);
+        ashTraceEzspVerbose("serialResponseReceived(): ashFreeBuffer(): %u",
+                            responseBuffer);
+      }
+      responseBuffer = buffer;
+      ezspResponseContents = buffer->data;
       ezspFrameLength = buffer->len;
-      ashFreeBuffer(&rxFree, buffer);
-      ashTraceEzspVerbose("serialResponseReceived(): ashFreeBuffer(): %u", buffer);
+      ezspStatsFrameReceived(buffer->data[EZSP_FRAME_ID_INDEX],
+                             (responsesOutstanding > 0));
       buffer = NULL;
       status = EZSP_SUCCESS;
-      waitingForResponse = FALSE;
+      if (responsesOutstanding > 0) {
+        // Responses arrive in order, so start timing the next command.
+        responsesOutstanding--;
+        waitStartTime = halCommonGetInt16uMillisecondTick();
+      }
     }
   }
   if (dropBuffer != NULL) {
-    ashRemoveQueueEntry(&rxQueue, dropBuffer);
-    ashFreeBuffer(&rxFree, dropBuffer);
+    ashRemoveQueueEntry(&ezspRxQueue, dropBuffer);
+    ashFreeBuffer(&ezspRxFree, dropBuffer);
     ashTraceEzspFrameId("dropping", dropBuffer->data);
     ashTraceEzspVerbose("serialResponseReceived(): ashFreeBuffer(): drop %u", dropBuffer);
     ashTraceEzspVerbose("serialResponseReceived(): ezspErrorHandler(): EZSP_ERROR_QUEUE_FULL");
@@ -152,6 +267,46 @@ EzspStatus serialResponseReceived(void)
   return status;
 }
 
+int8u *serialHoldResponse(void)
+{
+  if (responseBuffer == NULL || heldCount == MAX_HELD_RESPONSES) {
+    return NULL;
+  }
+  heldBuffers[heldCount++] = responseBuffer;
+  responseBuffer = NULL;
+  return ezspResponseContents;
+}
+
+void serialReleaseResponse(int8u *frame)
+{
+  int8u i;
+  for (i = 0; i < heldCount; i++) {
+    if (heldBuffers[i]->data == frame) {
+      ashFreeBuffer(&ezspRxFree, heldBuffers[i]);
+      heldCount--;
+      heldBuffers[i] = heldBuffers[heldCount];
+      if (ezspResponseContents == frame) {
+        ezspResponseContents = ezspFrameContentsStorage;
+      }
+      return;
+    }
+  }
+}
+
+void serialResponsesLost(int8u count)
+{
+  if (count == 0) {
+    return;
+  }
+  responsesOutstanding = (count < responsesOutstanding
+                          ? responsesOutstanding - count
+                          : 0);
+  // The latency of the commands still outstanding can no longer be matched
+  // to their responses.
+  ezspStatsCommandsLost();
+  ashTraceEzspVerbose("serialResponsesLost(): %u", count);
+}
+
 EzspStatus serialSendCommand()
 {
   EzspStatus status;
@@ -160,16 +315,24 @@ EzspStatus serialSendCommand()
     return EZSP_ASH_NOT_CONNECTED;
   }
   ashTraceEzspFrameId("send command", ezspFrameContents);
+  ezspStatsCommandStarted();
+#ifdef ASH_HOST_THREAD
+  status = ashThreadSend(ezspFrameLength, ezspFrameContents);
+#else
   status = ashSend(ezspFrameLength, ezspFrameContents);
+#endif
   if (status != EZSP_SUCCESS) {
     ashTraceEzspVerbose("serialSendCommand(): ashSend(): 0x%x", status);
     return status;
   }
-  waitingForResponse = TRUE;
   ashTraceEzspVerbose("serialSendCommand(): ID=0x%x Seq=0x%x",
                       ezspFrameContents[EZSP_FRAME_ID_INDEX],
                       ezspFrameContents[EZSP_SEQUENCE_INDEX]);
-  waitStartTime = halCommonGetInt16uMillisecondTick();
+  if (responsesOutstanding == 0) {
+    waitStartTime = halCommonGetInt16uMillisecondTick();
+  }
+  responsesOutstanding++;
+  ezspStatsCommandSent(ezspFrameContents[EZSP_FRAME_ID_INDEX]);
   return status;
 }
 
@@ -177,10 +340,15 @@ EzspStatus serialSendCommand()
 
 boolean ezspOkToSleep(void)
 {
+#ifdef ASH_HOST_THREAD
+  // The I/O thread owns the ASH state that decides this.
+  return FALSE;
+#else
   return 
     ( ncpSleepEnabled
       && (ezspSleepMode != EZSP_FRAME_CONTROL_IDLE)
       && ashOkToSleep() );
+#endif
 }
 
 void ezspEnableNcpSleep(boolean enable)
@@ -207,6 +375,10 @@ EzspStatus serialTestFlowControl(void)
 {
   int8u buffer[ECHO_MAX_DATA_LENGTH];
   int8u rnum;
+#ifdef ASH_HOST_THREAD
+  AshCount before;
+  AshCount after;
+#endif
 
   // Construct the largest possible echo command frame, in which every data byte
   // is preceded by an escape byte, by setting all data to the ASH_FLAG value.
@@ -222,10 +394,21 @@ EzspStatus serialTestFlowControl(void)
   // Use delay command to have the NCP pause before reading the next command,
   // then see if the frame had to be retransmitted due to buffer overflow.
   ezspDelayTest(100);   // wait 100 milliseconds before reading next command
+#ifdef ASH_HOST_THREAD
+  // ashCount belongs to the I/O thread.
+  ashThreadReadCounters(&before);
+  (void)ezspEcho(ECHO_MAX_DATA_LENGTH, buffer, buffer);
+  ezspTick();
+  ashThreadReadCounters(&after);
+  return (after.txReDataFrames == before.txReDataFrames)
+         ? EZSP_SUCCESS
+         : EZSP_ASH_HOST_FATAL_ERROR;
+#else
   ashCount.txReDataFrames = 0;
   (void)ezspEcho(ECHO_MAX_DATA_LENGTH, buffer, buffer);
   ezspTick();
   return (ashCount.txReDataFrames == 0) ? EZSP_SUCCESS 
                                         : EZSP_ASH_HOST_FATAL_ERROR;
+#endif
 }
 #endif //TRAINING_GATEWAY
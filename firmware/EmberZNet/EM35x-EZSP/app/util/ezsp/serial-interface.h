@@ -9,7 +9,7 @@
 #define __SERIAL_INTERFACE_H__
 
 // Macros for reading and writing frame bytes.
-#define serialGetResponseByte(index)      (ezspFrameContents[(index)])
+#define serialGetResponseByte(index)      (ezspResponseContents[(index)])
 #define serialSetCommandByte(index, data) (ezspFrameContents[(index)] = (data))
 
 // The length of the current EZSP frame.  The higher layer writes this when
@@ -23,7 +23,7 @@ extern int8u *ezspFrameLengthLocation;
 // Returns the number of EZSP responses that have been received by the serial
 // protocol and are ready to be collected by the EZSP layer via
 // serialResponseReceived().
-int8u serialPendingResponseCount(void);
+int16u serialPendingResponseCount(void);
 
 // Checks whether a new EZSP response frame has been received. Returns
 // EZSP_SUCCESS if a new response has been received. Returns
@@ -32,9 +32,28 @@ int8u serialPendingResponseCount(void);
 // by the serial protocol layer.
 EzspStatus serialResponseReceived(void);
 
+// Keeps the frame most recently received by serialResponseReceived() where the
+// serial protocol put it, so that a callback can be decoded in place. The
+// frame stays valid, even while further commands are sent and responses
+// received, until it is passed to serialReleaseResponse(). Returns NULL if the
+// serial protocol cannot do this, in which case the caller must copy the
+// frame instead.
+int8u *serialHoldResponse(void);
+
+// Releases a frame kept by serialHoldResponse().
+void serialReleaseResponse(int8u *frame);
+
+// Tells the serial protocol that the responses to this many of the oldest
+// outstanding commands will never arrive, because a response to a later
+// command has been received.
+void serialResponsesLost(int8u count);
+
 // Sends the current EZSP command frame. Returns EZSP_SUCCESS if the command was
 // sent successfully. Any other return value means that an error has been
-// detected by the serial protocol layer.
+// detected by the serial protocol layer. The UART protocol accepts further
+// commands before the first response has been collected, and returns the
+// responses in the order the commands were sent; the SPI protocol returns
+// EZSP_SPI_WAITING_FOR_RESPONSE in that case.
 EzspStatus serialSendCommand(void);
 
 // Set when the ncp has indicated it has a pending callback by seting the
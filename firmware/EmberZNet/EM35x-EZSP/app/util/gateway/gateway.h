@@ -30,6 +30,23 @@ EmberStatus gatewayCliInit(PGM_P cliPrompt,
 void gatewayWaitForEvents(void);
 void gatewayWaitForEventsWithTimeout(int32u timeoutMs);
 
+// Counts of the times gatewayWaitForEventsWithTimeout() has put the gateway
+// to sleep, and what woke it up.
+typedef struct {
+  int32u waits;
+  int32u fdWakeups;         // input arrived on a watched file descriptor
+  int32u timerWakeups;      // the timeout expired
+  int32u fdRegistrations;   // epoll_ctl() calls to add or remove descriptors
+  int32u elapsedMs;         // time since the first wait
+} GatewayWakeupCounts;
+
+const GatewayWakeupCounts *gatewayGetWakeupCounts(void);
+void gatewayPrintWakeupCounts(void);
+
+// Called when a file descriptor the gateway may be watching is closed, so
+// that the next wait registers the watched descriptors again.
+void gatewayWatchedFdClosed(int fd);
+
 // The difference in seconds between the ZigBee Epoch: January 1st, 2000
 // and the Unix Epoch: January 1st 1970.
 #define UNIX_ZIGBEE_EPOCH_DELTA (int32u)94668800UL
@@ -387,6 +387,7 @@ void emberSerialCleanup(void)
       int status;
       close(DATA_READER(port));
       close(CONTROL_WRITER(port));
+      gatewayWatchedFdClosed(DATA_READER(port));
       DATA_READER(port) = INVALID_FD;
       CONTROL_WRITER(port) = INVALID_FD;
       debugPrint("Waiting for child on port %d to terminate.\n", port);
@@ -421,6 +422,8 @@ static void parentCleanupAfterChildDied(void)
   childPid[childPort] = INVALID_PID;
   close(DATA_READER(childPort));
   close(CONTROL_WRITER(childPort));
+  // The next connection's reader may get the same descriptor number.
+  gatewayWatchedFdClosed(DATA_READER(childPort));
   DATA_READER(childPort) = INVALID_FD;
   CONTROL_WRITER(childPort) = INVALID_FD;
   // BugzId:12928 Parent needs to close its socket too
@@ -0,0 +1,67 @@
+/** @file hal/micro/aes.h
+ * See @ref aes for detailed documentation.
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.-->
+ */
+
+#ifndef __AES_H__
+#define __AES_H__
+
+/** @addtogroup aes
+ * @brief Software AES-128 for hosts, which otherwise ask the network
+ * coprocessor to do their AES work. See aes.h for source code.
+ *
+ * On x86 processors with the AES instructions these are used instead of
+ * the lookup tables.
+ *@{
+ */
+
+/** @brief The size in bytes of an AES-128 key and of a block.
+ */
+#define HAL_AES_BLOCK_SIZE 16
+
+/** @brief Encrypts a single block with AES-128.
+ *
+ * @param key         The 16-byte key.
+ *
+ * @param input       The 16-byte block to encrypt.
+ *
+ * @param output      Where to write the encrypted block.  This may be the
+ * same as input.
+ */
+void halCommonAesEncrypt(const int8u *key, const int8u *input, int8u *output);
+
+/** @brief Runs whole blocks through the Matyas-Meyer-Oseas compression
+ * function used by the ZigBee AES-MMO hash.
+ *
+ * For each block M the hash H becomes E(H, M) xor M, where E(H, M) is M
+ * encrypted with H as the key.  Padding the message is left to the caller.
+ *
+ * @param hash        The 16-byte hash, updated in place.
+ *
+ * @param data        The blocks to hash.
+ *
+ * @param blockCount  The number of 16-byte blocks of data.
+ */
+void halCommonAesMmoHashBlocks(int8u *hash,
+                               const int8u *data,
+                               int32u blockCount);
+
+/** @brief Returns TRUE if the processor's AES instructions are being used.
+ */
+boolean halCommonAesUsingHardware(void);
+
+/** @brief Turns the use of the processor's AES instructions on or off, for
+ * comparing the two.  They are used by default whenever they are available.
+ *
+ * @param enable  FALSE to use the lookup tables even if the processor has
+ * AES instructions.
+ *
+ * @return TRUE if the AES instructions are now in use.
+ */
+boolean halCommonAesEnableHardware(boolean enable);
+
+/**@}  // end of AES Functions
+ */
+
+#endif //__AES_H__
@@ -27,6 +27,22 @@
  */
 int16u halCommonCrc16(int8u newByte, int16u prevResult);
 
+/** @brief Calculates 16-bit cyclic redundancy code (CITT CRC 16) over
+ * a block of data.
+ *
+ * Gives the same result as calling halCommonCrc16() for each byte in turn,
+ * but on hosts processes eight bytes at a time.
+ *
+ * @param data        The data to be run through CRC.
+ *
+ * @param length      The number of bytes of data.
+ *
+ * @param prevResult  The previous CRC result.
+ *
+ * @return The new CRC result.
+ */
+int16u halCommonCrc16Block(const int8u *data, int16u length, int16u prevResult);
+
 
 /** @brief Calculates 32-bit cyclic redundancy code
  *
@@ -45,6 +61,21 @@ int16u halCommonCrc16(int8u newByte, int16u prevResult);
  */
 int32u halCommonCrc32(int8u newByte, int32u prevResult);
 
+/** @brief Calculates 32-bit cyclic redundancy code over a block of data.
+ *
+ * Gives the same result as calling halCommonCrc32() for each byte in turn,
+ * but on hosts processes eight bytes at a time.
+ *
+ * @param data          The data to be run through CRC.
+ *
+ * @param length        The number of bytes of data.
+ *
+ * @param prevResult    The previous CRC result.
+ *
+ * @return The new CRC result.
+ */
+int32u halCommonCrc32Block(const int8u *data, int32u length, int32u prevResult);
+
 // Commonly used initial and expected final CRC32 values
 #define INITIAL_CRC             0xFFFFFFFFL
 #define CRC32_START             INITIAL_CRC
@@ -0,0 +1,315 @@
+/** @file hal/micro/generic/aes.c
+ *  @brief  Software AES-128 encryption for hosts.
+ *
+ * The tables follow FIPS-197.  On x86 processors that have them, the AES
+ * instructions are used instead; define HAL_AES_NO_HARDWARE to leave them
+ * out.
+ *
+ * <!-- Copyright 2010 by Ember Corporation. All rights reserved.       *80*-->
+ */
+
+#include PLATFORM_HEADER
+#include "hal/micro/aes.h"
+
+#if defined(__GNUC__)                                   \
+    && (defined(__x86_64__) || defined(__i386__))       \
+    && !defined(HAL_AES_NO_HARDWARE)
+  #define HAL_AES_HARDWARE
+  #include <cpuid.h>
+  #include <wmmintrin.h>
+  #define AES_TARGET __attribute__((target("aes,sse2")))
+#endif
+
+#define ROUNDS 10
+#define ROUND_KEY_WORDS (4 * (ROUNDS + 1))
+
+static const int8u sbox[256] = {
+  0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5,
+  0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+  0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0,
+  0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+  0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC,
+  0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+  0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A,
+  0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+  0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0,
+  0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+  0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B,
+  0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+  0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85,
+  0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+  0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5,
+  0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+  0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17,
+  0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+  0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88,
+  0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+  0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C,
+  0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+  0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9,
+  0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+  0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6,
+  0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+  0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E,
+  0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+  0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94,
+  0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+  0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68,
+  0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+static const int8u roundConstants[ROUNDS] = {
+  0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36
+};
+
+// Each round's SubBytes, ShiftRows and MixColumns of one byte, for the byte's
+// four positions in a column.  Built from the S-box on first use.
+static int32u te0[256];
+static int32u te1[256];
+static int32u te2[256];
+static int32u te3[256];
+static boolean tablesBuilt = FALSE;
+
+#ifdef HAL_AES_HARDWARE
+static boolean hardwareChecked = FALSE;
+static boolean hardwarePresent = FALSE;
+static boolean hardwareEnabled = TRUE;
+#endif
+
+#define ROTATE_RIGHT_8(x) (((x) >> 8) | ((x) << 24))
+
+#define GET_WORD(p)                                           \
+  (((int32u)(p)[0] << 24) | ((int32u)(p)[1] << 16)            \
+   | ((int32u)(p)[2] << 8) | (int32u)(p)[3])
+
+#define PUT_WORD(p, w)                        \
+  do {                                        \
+    (p)[0] = (int8u)((w) >> 24);              \
+    (p)[1] = (int8u)((w) >> 16);              \
+    (p)[2] = (int8u)((w) >> 8);               \
+    (p)[3] = (int8u)(w);                      \
+  } while (0)
+
+#define SUB_WORD(w)                                   \
+  (((int32u)sbox[(w) >> 24] << 24)                    \
+   | ((int32u)sbox[((w) >> 16) & 0xFF] << 16)         \
+   | ((int32u)sbox[((w) >> 8) & 0xFF] << 8)           \
+   | (int32u)sbox[(w) & 0xFF])
+
+static void buildTables(void)
+{
+  int16u i;
+  for (i = 0; i < 256; i++) {
+    int8u s = sbox[i];
+    int8u s2 = (int8u)((s << 1) ^ ((s & 0x80) ? 0x1B : 0));
+    int32u t = (((int32u)s2 << 24)
+                | ((int32u)s << 16)
+                | ((int32u)s << 8)
+                | (int32u)(s2 ^ s));
+    te0[i] = t;
+    te1[i] = ROTATE_RIGHT_8(t);
+    te2[i] = ROTATE_RIGHT_8(te1[i]);
+    te3[i] = ROTATE_RIGHT_8(te2[i]);
+  }
+  tablesBuilt = TRUE;
+}
+
+static void expandKey(const int8u *key, int32u *roundKey)
+{
+  int8u i;
+  for (i = 0; i < 4; i++) {
+    roundKey[i] = GET_WORD(key + 4 * i);
+  }
+  for (i = 4; i < ROUND_KEY_WORDS; i++) {
+    int32u word = roundKey[i - 1];
+    if ((i & 3) == 0) {
+      word = ((word << 8) | (word >> 24));
+      word = SUB_WORD(word) ^ ((int32u)roundConstants[i / 4 - 1] << 24);
+    }
+    roundKey[i] = roundKey[i - 4] ^ word;
+  }
+}
+
+static void encryptSoftware(const int8u *key,
+                            const int8u *input,
+                            int8u *output)
+{
+  int32u roundKey[ROUND_KEY_WORDS];
+  const int32u *rk = roundKey;
+  int32u s0, s1, s2, s3;
+  int32u t0, t1, t2, t3;
+  int8u round;
+
+  if (!tablesBuilt) {
+    buildTables();
+  }
+  expandKey(key, roundKey);
+
+  s0 = GET_WORD(input) ^ rk[0];
+  s1 = GET_WORD(input + 4) ^ rk[1];
+  s2 = GET_WORD(input + 8) ^ rk[2];
+  s3 = GET_WORD(input + 12) ^ rk[3];
+
+  for (round = 1; round < ROUNDS; round++) {
+    rk += 4;
+    t0 = (te0[s0 >> 24] ^ te1[(s1 >> 16) & 0xFF]
+          ^ te2[(s2 >> 8) & 0xFF] ^ te3[s3 & 0xFF] ^ rk[0]);
+    t1 = (te0[s1 >> 24] ^ te1[(s2 >> 16) & 0xFF]
+          ^ te2[(s3 >> 8) & 0xFF] ^ te3[s0 & 0xFF] ^ rk[1]);
+    t2 = (te0[s2 >> 24] ^ te1[(s3 >> 16) & 0xFF]
+          ^ te2[(s0 >> 8) & 0xFF] ^ te3[s1 & 0xFF] ^ rk[2]);
+    t3 = (te0[s3 >> 24] ^ te1[(s0 >> 16) & 0xFF]
+          ^ te2[(s1 >> 8) & 0xFF] ^ te3[s2 & 0xFF] ^ rk[3]);
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  // The last round has no MixColumns.
+  rk += 4;
+  t0 = (((int32u)sbox[s0 >> 24] << 24)
+        | ((int32u)sbox[(s1 >> 16) & 0xFF] << 16)
+        | ((int32u)sbox[(s2 >> 8) & 0xFF] << 8)
+        | (int32u)sbox[s3 & 0xFF]) ^ rk[0];
+  t1 = (((int32u)sbox[s1 >> 24] << 24)
+        | ((int32u)sbox[(s2 >> 16) & 0xFF] << 16)
+        | ((int32u)sbox[(s3 >> 8) & 0xFF] << 8)
+        | (int32u)sbox[s0 & 0xFF]) ^ rk[1];
+  t2 = (((int32u)sbox[s2 >> 24] << 24)
+        | ((int32u)sbox[(s3 >> 16) & 0xFF] << 16)
+        | ((int32u)sbox[(s0 >> 8) & 0xFF] << 8)
+        | (int32u)sbox[s1 & 0xFF]) ^ rk[2];
+  t3 = (((int32u)sbox[s3 >> 24] << 24)
+        | ((int32u)sbox[(s0 >> 16) & 0xFF] << 16)
+        | ((int32u)sbox[(s1 >> 8) & 0xFF] << 8)
+        | (int32u)sbox[s2 & 0xFF]) ^ rk[3];
+  PUT_WORD(output, t0);
+  PUT_WORD(output + 4, t1);
+  PUT_WORD(output + 8, t2);
+  PUT_WORD(output + 12, t3);
+}
+
+#ifdef HAL_AES_HARDWARE
+
+static boolean hardwareAvailable(void)
+{
+  if (!hardwareChecked) {
+    unsigned int eax, ebx, ecx, edx;
+    hardwarePresent = (__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+                       && (ecx & bit_AES) != 0
+                       && (edx & bit_SSE2) != 0);
+    hardwareChecked = TRUE;
+  }
+  return (hardwarePresent && hardwareEnabled);
+}
+
+// One step of the key schedule.  The assist word holds
+// SubWord(RotWord(w3)) xor rcon in its top lane.
+AES_TARGET static __m128i expandKeyStep(__m128i key, __m128i assist)
+{
+  assist = _mm_shuffle_epi32(assist, 0xFF);
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, assist);
+}
+
+// The round constant must be an immediate, so each round is spelled out.
+#define ENCRYPT_ROUND(rcon)                                             \
+  do {                                                                  \
+    key = expandKeyStep(key, _mm_aeskeygenassist_si128(key, (rcon)));   \
+    state = _mm_aesenc_si128(state, key);                               \
+  } while (0)
+
+// The key schedule is worked out alongside the rounds, since AES-MMO uses
+// every key only once.
+AES_TARGET static __m128i encryptHardware(__m128i key, __m128i block)
+{
+  __m128i state = _mm_xor_si128(block, key);
+  ENCRYPT_ROUND(0x01);
+  ENCRYPT_ROUND(0x02);
+  ENCRYPT_ROUND(0x04);
+  ENCRYPT_ROUND(0x08);
+  ENCRYPT_ROUND(0x10);
+  ENCRYPT_ROUND(0x20);
+  ENCRYPT_ROUND(0x40);
+  ENCRYPT_ROUND(0x80);
+  ENCRYPT_ROUND(0x1B);
+  key = expandKeyStep(key, _mm_aeskeygenassist_si128(key, 0x36));
+  return _mm_aesenclast_si128(state, key);
+}
+
+AES_TARGET static void mmoHashBlocksHardware(int8u *hash,
+                                             const int8u *data,
+                                             int32u blockCount)
+{
+  __m128i h = _mm_loadu_si128((const __m128i *)hash);
+  while (blockCount--) {
+    __m128i m = _mm_loadu_si128((const __m128i *)data);
+    h = _mm_xor_si128(encryptHardware(h, m), m);
+    data += HAL_AES_BLOCK_SIZE;
+  }
+  _mm_storeu_si128((__m128i *)hash, h);
+}
+
+AES_TARGET static void encryptBlockHardware(const int8u *key,
+                                            const int8u *input,
+                                            int8u *output)
+{
+  __m128i k = _mm_loadu_si128((const __m128i *)key);
+  __m128i m = _mm_loadu_si128((const __m128i *)input);
+  _mm_storeu_si128((__m128i *)output, encryptHardware(k, m));
+}
+
+#endif // HAL_AES_HARDWARE
+
+void halCommonAesEncrypt(const int8u *key, const int8u *input, int8u *output)
+{
+#ifdef HAL_AES_HARDWARE
+  if (hardwareAvailable()) {
+    encryptBlockHardware(key, input, output);
+    return;
+  }
+#endif
+  encryptSoftware(key, input, output);
+}
+
+void halCommonAesMmoHashBlocks(int8u *hash,
+                               const int8u *data,
+                               int32u blockCount)
+{
+  int8u encrypted[HAL_AES_BLOCK_SIZE];
+  int8u i;
+
+#ifdef HAL_AES_HARDWARE
+  if (hardwareAvailable()) {
+    mmoHashBlocksHardware(hash, data, blockCount);
+    return;
+  }
+#endif
+  while (blockCount--) {
+    encryptSoftware(hash, data, encrypted);
+    for (i = 0; i < HAL_AES_BLOCK_SIZE; i++) {
+      hash[i] = encrypted[i] ^ data[i];
+    }
+    data += HAL_AES_BLOCK_SIZE;
+  }
+}
+
+boolean halCommonAesUsingHardware(void)
+{
+#ifdef HAL_AES_HARDWARE
+  return hardwareAvailable();
+#else
+  return FALSE;
+#endif
+}
+
+boolean halCommonAesEnableHardware(boolean enable)
+{
+#ifdef HAL_AES_HARDWARE
+  hardwareEnabled = enable;
+#endif
+  return halCommonAesUsingHardware();
+}
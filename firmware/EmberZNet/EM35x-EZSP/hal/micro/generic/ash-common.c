@@ -55,6 +55,8 @@ static int16u decodeCrc;
 // Forward Declarations
 
 static int8u ashEncodeStuffByte(int8u byte);
+static int16u ashDecodePlainRun(const int8u *in, int16u len);
+static EzspStatus ashDecodeReservedByte(int8u byte);
 
 //------------------------------------------------------------------------------
 // Functions
@@ -188,6 +190,204 @@ EzspStatus ashDecodeByte(int8u byte, int8u *out, int8u *outLen)
   return status;
 }
 
+// The block decoder scans its input a word at a time for reserved bytes.
+// A word holding none of them is a run of plain bytes that needs no
+// per-byte interpretation.
+#define ONES_32         0x01010101UL
+#define HIGHS_32        0x80808080UL
+#define HAS_ZERO_BYTE(w)  (((w) - ONES_32) & ~(w) & HIGHS_32)
+#define HAS_BYTE(w, b)    HAS_ZERO_BYTE((w) ^ (ONES_32 * (b)))
+
+#ifdef EZSP_HOST
+  #define ashIsReservedByte(b)                                    \
+    (  ((b) == ASH_FLAG) || ((b) == ASH_ESC) || ((b) == ASH_CAN)  \
+    || ((b) == ASH_SUB)  || ((b) == ASH_XON) || ((b) == ASH_XOFF) )
+  #define ashWordHasReservedByte(w)                               \
+    (  HAS_BYTE(w, ASH_FLAG) | HAS_BYTE(w, ASH_ESC) | HAS_BYTE(w, ASH_CAN) \
+     | HAS_BYTE(w, ASH_SUB)  | HAS_BYTE(w, ASH_XON) | HAS_BYTE(w, ASH_XOFF) )
+#else
+  #define ashIsReservedByte(b)                                    \
+    (  ((b) == ASH_FLAG) || ((b) == ASH_ESC) || ((b) == ASH_CAN)  \
+    || ((b) == ASH_SUB) )
+  #define ashWordHasReservedByte(w)                               \
+    (  HAS_BYTE(w, ASH_FLAG) | HAS_BYTE(w, ASH_ESC) | HAS_BYTE(w, ASH_CAN) \
+     | HAS_BYTE(w, ASH_SUB) )
+#endif
+
+// Returns the number of bytes at the start of in[] that are not reserved.
+static int16u ashDecodePlainRun(const int8u *in, int16u len)
+{
+  int16u run = 0;
+  int32u word;
+
+  while (run + sizeof(word) <= len) {
+    MEMCOPY(&word, in + run, sizeof(word));
+    if (ashWordHasReservedByte(word)) {
+      break;
+    }
+    run += sizeof(word);
+  }
+  while (run < len && !ashIsReservedByte(in[run])) {
+    run++;
+  }
+  return run;
+}
+
+// A helper for ashDecodeBlock(), this handles a reserved byte exactly as
+// ashDecodeByte() does.
+static EzspStatus ashDecodeReservedByte(int8u byte)
+{
+  EzspStatus status = EZSP_ASH_IN_PROGRESS;
+
+  switch (byte) {
+  case ASH_FLAG:
+    if (decodeLen == 0) {
+      decodeFlip = 0;
+    } else if (decodeLen == 0xFF) {
+      status = EZSP_ASH_COMM_ERROR;
+    } else if (decodeCrc != ((int16u)decodeByte2 << 8) + decodeByte1) {
+      status = EZSP_ASH_BAD_CRC;
+    } else if (decodeLen < ASH_MIN_FRAME_WITH_CRC_LEN) {
+      status = EZSP_ASH_TOO_SHORT;
+    } else if (decodeLen > ASH_MAX_FRAME_WITH_CRC_LEN) {
+      status = EZSP_ASH_TOO_LONG;
+    } else {
+      status = EZSP_SUCCESS;
+    }
+    break;
+  case ASH_ESC:
+    decodeFlip = ASH_FLIP;
+    break;
+  case ASH_CAN:
+    status = EZSP_ASH_CANCELLED;
+    break;
+  case ASH_SUB:
+    decodeLen = 0xFF;
+    break;
+#ifdef EZSP_HOST
+  case ASH_XON:
+  case ASH_XOFF:
+    if (!ashReadConfig(rtsCts)) {
+      status = EZSP_ASH_ERROR_XON_XOFF;
+    }
+    break;
+#endif
+  default:
+    assert(FALSE);
+  }
+  return status;
+}
+
+EzspStatus ashDecodeBlock(const int8u *in,
+                          int16u inLen,
+                          int16u *inUsed,
+                          int8u *out,
+                          int16u outSpace,
+                          int8u *outLen)
+{
+  EzspStatus status = EZSP_ASH_IN_PROGRESS;
+  int16u i = 0;
+  int16u run;
+  int16u bulk;
+  int8u byte;
+
+  if (!ashDecodeInProgress) {
+    decodeLen = 0;
+    decodeByte1 = 0;
+    decodeByte2 = 0;
+    decodeFlip = 0;
+    decodeCrc = 0xFFFF;
+  }
+
+  while (i < inLen && status == EZSP_ASH_IN_PROGRESS) {
+    byte = in[i];
+    if (ashIsReservedByte(byte)) {
+      status = ashDecodeReservedByte(byte);
+      i++;
+      continue;
+    }
+
+    run = ashDecodePlainRun(in + i, inLen - i);
+
+    // Bulk path: with the two byte crc queue already full and the frame
+    // well short of its maximum length, every plain byte pushes exactly one
+    // byte out of the queue, so the output is the queue followed by the
+    // start of the run.
+    if (decodeFlip == 0
+        && decodeLen >= ASH_CRC_LEN
+        && decodeLen < ASH_MAX_FRAME_WITH_CRC_LEN) {
+      bulk = ASH_MAX_FRAME_WITH_CRC_LEN - decodeLen;
+      if (bulk > run) {
+        bulk = run;
+      }
+      if (out != NULL && bulk > outSpace) {
+        bulk = outSpace;
+      }
+      if (bulk == 0) {
+        break;                              // output space is full
+      }
+      decodeCrc = halCommonCrc16(decodeByte2, decodeCrc);
+      if (out != NULL) {
+        *out++ = decodeByte2;
+      }
+      if (bulk == 1) {
+        decodeByte2 = decodeByte1;
+      } else {
+        decodeCrc = halCommonCrc16(decodeByte1, decodeCrc);
+        if (out != NULL) {
+          *out++ = decodeByte1;
+          MEMCOPY(out, in + i, bulk - 2);
+          out += bulk - 2;
+        }
+        decodeCrc = halCommonCrc16Block(in + i, bulk - 2, decodeCrc);
+        decodeByte2 = in[i + bulk - 2];
+      }
+      decodeByte1 = in[i + bulk - 1];
+      decodeLen += bulk;
+      *outLen = decodeLen - ASH_CRC_LEN;
+      if (out != NULL) {
+        outSpace -= bulk;
+      }
+      i += bulk;
+      continue;
+    }
+
+    // Slow path: one plain byte at a time, as in ashDecodeByte(), while
+    // filling the crc queue, after an escape, or past the maximum length.
+    if (decodeLen < ASH_MAX_FRAME_WITH_CRC_LEN
+        && decodeLen + 1 > ASH_CRC_LEN
+        && out != NULL) {
+      if (outSpace == 0) {
+        break;                              // output space is full
+      }
+    }
+    byte ^= decodeFlip;
+    decodeFlip = 0;
+    if (decodeLen <= ASH_MAX_FRAME_WITH_CRC_LEN) {
+      ++decodeLen;
+    }
+    if (decodeLen > ASH_CRC_LEN) {
+      decodeCrc = halCommonCrc16(decodeByte2, decodeCrc);
+      if (decodeLen <= ASH_MAX_FRAME_WITH_CRC_LEN) {
+        if (out != NULL) {
+          *out++ = decodeByte2;
+          outSpace--;
+        }
+        *outLen = decodeLen - ASH_CRC_LEN;
+      }
+    }
+    decodeByte2 = decodeByte1;
+    decodeByte1 = byte;
+    i++;
+  }
+
+  if (i > 0) {
+    ashDecodeInProgress = (status == EZSP_ASH_IN_PROGRESS);
+  }
+  *inUsed = i;
+  return status;
+}
+
 int8u ashRandomizeArray(int8u seed, int8u *buf, int8u len)
 {
   if (seed == 0) {
@@ -66,6 +66,37 @@ int8u ashEncodeByte(int8u len, int8u byte, int8u *offset);
 */
 EzspStatus ashDecodeByte(int8u byte, int8u *out, int8u *outLen);
 
+/** @brief Decodes and validates an ASH frame from a block of received bytes.
+ * This produces exactly the same frames and status codes as passing the
+ * same bytes one at a time to ashDecodeByte(), and shares its decoder state,
+ * but scans for reserved bytes a word at a time and copies runs of
+ * unescaped bytes to the output in bulk.
+ * Decoding stops after the byte that completes or terminates a frame,
+ * when the input is exhausted, or before a byte that would be output
+ * when there is no output space left.
+ *
+ * @param in       pointer to the received bytes
+ *
+ * @param inLen    number of received bytes
+ *
+ * @param inUsed   pointer to where to write the number of bytes consumed
+ *
+ * @param out      pointer to where to write the next output byte, or NULL
+ * to discard the output while still decoding the frame
+ *
+ * @param outSpace number of bytes that may be written to out
+ *
+ * @param outLen   number of bytes output so far
+ *
+ * @return status of frame decoding, as for ashDecodeByte()
+*/
+EzspStatus ashDecodeBlock(const int8u *in,
+                          int16u inLen,
+                          int16u *inUsed,
+                          int8u *out,
+                          int16u outSpace,
+                          int8u *outLen);
+
 /** @brief Randomizes array contents by XORing with an 8-bit pseudo
  * random sequence. This reduces the likelihood that byte-stuffing will 
  * greatly increase the size of the payload. (This could happen if a DATA
@@ -40,6 +40,7 @@ DEFINES= \
   -DEMBER_SERIAL1_TX_QUEUE_SIZE=128 \
   -DEMBER_SERIAL1_RX_QUEUE_SIZE=64 \
   -DEZSP_HOST \
+  -DEZSP_AES_MMO_ON_HOST \
   -DEMBER_SERIAL0_DEBUG \
   -DAPP_SERIAL=1 \
   -DEZSP_APPLICATION_HAS_MFGLIB_HANDLER \
@@ -71,6 +72,7 @@ OPTIONS= \
   -O0
 
 APPLICATION_FILES= \
+  hal/micro/generic/aes.c \
   hal/micro/generic/ash-common.c \
   hal/micro/generic/buzzer-stub.c \
   hal/micro/generic/crc.c \
@@ -88,6 +90,7 @@ APPLICATION_FILES= \
   app/util/ezsp/ezsp-callbacks.c \
   app/util/ezsp/ezsp-enum-decode.c \
   app/util/ezsp/ezsp-frame-utilities.c \
+  app/util/ezsp/ezsp-stats.c \
   app/util/ezsp/ezsp-utils.c \
   app/util/ezsp/ezsp.c \
   app/util/ezsp/serial-interface-uart.c \
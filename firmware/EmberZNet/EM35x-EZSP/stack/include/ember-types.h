@@ -1183,6 +1183,18 @@ typedef int8u EmberTaskId;
      *  Units are determined by the event status. 
      */
     int16u timeToExecute;
+    /** The millisecond tick at which the event fires. */
+    int32u deadline;
+    /** The queue of the task this event belongs to, or NULL if the event
+     *  is not part of a task.  Set by ::emberTaskInit().
+     */
+    struct EmEventQueue *queue;
+    /** The event's position in its queue plus one, or zero if not queued. */
+    int16u queueIndex;
+    /** The event's index in its task's event array.  Set by
+     *  ::emberTaskInit().
+     */
+    int16u eventIndex;
   } EmberEventControl;
 #endif
 
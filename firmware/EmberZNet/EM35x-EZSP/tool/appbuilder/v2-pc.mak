@@ -42,6 +42,7 @@ DEFINES= \
   -DBOARD_HOST \
   -DCONFIGURATION_HEADER=\"app/framework/util/config.h\" \
   -DEZSP_HOST \
+  -DEZSP_AES_MMO_ON_HOST \
   -DGATEWAY_APP \
   -DZA_GENERATED_HEADER=\"$(APP_BUILDER_CONFIG_HEADER)\" \
   -DATTRIBUTE_STORAGE_CONFIGURATION=\"$(APP_BUILDER_STORAGE_FILE)\" \
@@ -116,6 +117,7 @@ APPLICATION_FILES= \
   app/util/ezsp/ezsp-callbacks.c \
   app/util/ezsp/ezsp-enum-decode.c \
   app/util/ezsp/ezsp-frame-utilities.c \
+  app/util/ezsp/ezsp-stats.c \
   app/util/ezsp/ezsp.c \
   app/util/ezsp/serial-interface-uart.c \
   app/util/serial/command-interpreter2.c \
@@ -123,6 +125,7 @@ APPLICATION_FILES= \
   app/util/serial/linux-serial.c \
   app/util/zigbee-framework/zigbee-device-common.c \
   app/util/zigbee-framework/zigbee-device-host.c \
+  _replace_halDirFromStackFs_/micro/generic/aes.c \
   _replace_halDirFromStackFs_/micro/generic/ash-common.c \
   _replace_halDirFromStackFs_/micro/generic/buzzer-stub.c \
   _replace_halDirFromStackFs_/micro/generic/crc.c \